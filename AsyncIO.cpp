@@ -0,0 +1,528 @@
+/*
+   Asynchronous File I/O Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "AsyncIO.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr unsigned RING_ENTRIES = 64;
+// A single read/write transfers at most ~2 GB; larger segments are split
+constexpr size_t MAX_TRANSFER = size_t(1) << 30;
+// user_data of the eventfd read; chunks use their (non-null) address
+constexpr uint64_t WAKE_TAG = 0;
+
+std::atomic<int>& defaultBackend() {
+    static std::atomic<int> backend{static_cast<int>(AsyncIO::Backend::Auto)};
+    return backend;
+}
+
+} // namespace
+
+struct AsyncIO::Request {
+    bool write = false;
+    std::string path;
+    uint64_t offset = 0;             // file offset of the first segment
+    std::vector<std::pair<unsigned char*, size_t>> segments;
+    Completion done;
+
+    // Owned by the I/O thread
+    int fd = -1;
+    size_t outstanding = 0;          // chunks still in the kernel or waiting for a slot
+    std::exception_ptr error;
+};
+
+// Raw io_uring setup: no liburing, only the kernel UAPI header
+struct AsyncIO::Ring {
+    int fd = -1;
+    unsigned char* sqMap = nullptr;
+    size_t sqMapSize = 0;
+    unsigned char* cqMap = nullptr;
+    size_t cqMapSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqEntries = 0;
+    unsigned sqLocalTail = 0;        // SQEs filled but not yet published
+
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned cqMask = 0;
+    unsigned cqEntries = 0;
+
+    explicit Ring(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            throw std::runtime_error(std::string("io_uring_setup failed: ") + std::strerror(errno));
+        }
+        // io_uring exists since 5.1, but IORING_OP_READ / WRITE and reads at
+        // the current position (the wake-up eventfd) only since 5.6; before
+        // that every request would complete with -EINVAL
+        if ((params.features & IORING_FEAT_RW_CUR_POS) == 0 || !supportsReadWrite()) {
+            ::close(fd);
+            fd = -1;
+            throw std::runtime_error("io_uring lacks read/write operations (needs Linux 5.6)");
+        }
+
+        sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap) {
+            sqMapSize = cqMapSize = std::max(sqMapSize, cqMapSize);
+        }
+        sqMap = mapRegion(sqMapSize, IORING_OFF_SQ_RING);
+        cqMap = singleMap ? sqMap : mapRegion(cqMapSize, IORING_OFF_CQ_RING);
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = reinterpret_cast<io_uring_sqe*>(mapRegion(sqesSize, IORING_OFF_SQES));
+
+        sqHead = reinterpret_cast<unsigned*>(sqMap + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned*>(sqMap + params.sq_off.tail);
+        sqArray = reinterpret_cast<unsigned*>(sqMap + params.sq_off.array);
+        sqMask = *reinterpret_cast<unsigned*>(sqMap + params.sq_off.ring_mask);
+        sqEntries = params.sq_entries;
+        sqLocalTail = *sqTail;
+
+        cqHead = reinterpret_cast<unsigned*>(cqMap + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cqMap + params.cq_off.tail);
+        cqes = reinterpret_cast<io_uring_cqe*>(cqMap + params.cq_off.cqes);
+        cqMask = *reinterpret_cast<unsigned*>(cqMap + params.cq_off.ring_mask);
+        cqEntries = params.cq_entries;
+    }
+
+    ~Ring() {
+        release();
+    }
+
+    Ring(const Ring& other) = delete;
+    Ring& operator=(const Ring& other) = delete;
+
+    // Whether the kernel reports IORING_OP_READ and IORING_OP_WRITE as supported
+    bool supportsReadWrite() const {
+        constexpr unsigned PROBE_OPS = 256;
+        alignas(io_uring_probe) unsigned char buffer[sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op)] = {};
+        auto* probe = reinterpret_cast<io_uring_probe*>(buffer);
+        if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, PROBE_OPS) < 0) {
+            return false;
+        }
+        auto supported = [probe](unsigned op) {
+            return op < probe->ops_len && (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+        };
+        return supported(IORING_OP_READ) && supported(IORING_OP_WRITE);
+    }
+
+    unsigned char* mapRegion(size_t size, off_t offset) {
+        void* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+        if (address == MAP_FAILED) {
+            int error = errno;
+            release();
+            throw std::runtime_error(std::string("Cannot map io_uring queue: ") + std::strerror(error));
+        }
+        return static_cast<unsigned char*>(address);
+    }
+
+    void release() {
+        if (sqes) ::munmap(sqes, sqesSize);
+        if (cqMap && cqMap != sqMap) ::munmap(cqMap, cqMapSize);
+        if (sqMap) ::munmap(sqMap, sqMapSize);
+        if (fd >= 0) ::close(fd);
+        sqes = nullptr;
+        cqMap = nullptr;
+        sqMap = nullptr;
+        fd = -1;
+    }
+
+    // Next free submission entry (zeroed), or nullptr while the queue is full
+    io_uring_sqe* nextSqe() {
+        unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+        if (sqLocalTail - head >= sqEntries) {
+            return nullptr;
+        }
+        unsigned index = sqLocalTail & sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqArray[index] = index;
+        ++sqLocalTail;
+        return sqe;
+    }
+
+    // Publish filled entries; returns how many the kernel has not consumed yet
+    unsigned publish() {
+        __atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+        return sqLocalTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    }
+
+    int enter(unsigned toSubmit, unsigned minComplete) {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete,
+                                          IORING_ENTER_GETEVENTS, nullptr, 0));
+    }
+};
+
+AsyncIO::AsyncIO(Backend backend)
+    : activeBackend(Backend::Blocking), stopping(false), wakeFd(-1), wakeValue(0) {
+    if (backend != Backend::Blocking) {
+        try {
+            ring = std::make_unique<Ring>(RING_ENTRIES);
+            wakeFd = ::eventfd(0, EFD_CLOEXEC);
+            if (wakeFd < 0) {
+                throw std::runtime_error(std::string("eventfd failed: ") + std::strerror(errno));
+            }
+            activeBackend = Backend::IoUring;
+        } catch (const std::exception&) {
+            ring.reset();
+            if (backend == Backend::IoUring) {
+                throw;
+            }
+        }
+    }
+    ioThread = std::thread(activeBackend == Backend::IoUring ? &AsyncIO::ringLoop : &AsyncIO::blockingLoop, this);
+}
+
+AsyncIO::~AsyncIO() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    wake();
+    if (ioThread.joinable()) {
+        ioThread.join();
+    }
+    ring.reset();
+    if (wakeFd >= 0) {
+        ::close(wakeFd);
+    }
+}
+
+std::shared_ptr<AsyncIO> AsyncIO::sharedInstance() {
+    static std::shared_ptr<AsyncIO> instance =
+        std::make_shared<AsyncIO>(static_cast<Backend>(defaultBackend().load()));
+    return instance;
+}
+
+void AsyncIO::setDefaultBackend(Backend backend) {
+    defaultBackend().store(static_cast<int>(backend));
+}
+
+AsyncIO::Backend AsyncIO::parseBackend(const std::string& name) {
+    if (name == "auto") return Backend::Auto;
+    if (name == "uring" || name == "io_uring") return Backend::IoUring;
+    if (name == "blocking") return Backend::Blocking;
+    throw std::invalid_argument("Unknown I/O backend: " + name);
+}
+
+const char* AsyncIO::backendName(Backend backend) {
+    switch (backend) {
+        case Backend::IoUring: return "io_uring";
+        case Backend::Blocking: return "blocking";
+        default: return "auto";
+    }
+}
+
+AsyncIO::Stats AsyncIO::getStats() const {
+    Stats stats;
+    stats.requests = requestCount.load();
+    stats.bytes = byteCount.load();
+    stats.kernelSubmits = submitCount.load();
+    stats.operations = operationCount.load();
+    return stats;
+}
+
+void AsyncIO::wake() {
+    if (wakeFd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = ::write(wakeFd, &one, sizeof(one));
+        (void)written; // the counter only saturates after 2^64 - 1 wake-ups
+    } else {
+        queueCondition.notify_all();
+    }
+}
+
+void AsyncIO::enqueue(std::unique_ptr<Request> request) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (stopping) {
+            throw std::runtime_error("Cannot submit to a stopped I/O backend");
+        }
+        pending.push_back(std::move(request));
+    }
+    requestCount.fetch_add(1);
+    wake();
+}
+
+void AsyncIO::submitWrite(const std::string& path, std::vector<Segment> segments, Completion done) {
+    auto request = std::make_unique<Request>();
+    request->write = true;
+    request->path = path;
+    for (const auto& segment : segments) {
+        // The kernel only reads from write buffers
+        request->segments.emplace_back(static_cast<unsigned char*>(const_cast<void*>(segment.data)), segment.size);
+    }
+    request->done = std::move(done);
+    enqueue(std::move(request));
+}
+
+void AsyncIO::submitRead(const std::string& path, uint64_t offset, void* destination, size_t size,
+                         Completion done) {
+    auto request = std::make_unique<Request>();
+    request->path = path;
+    request->offset = offset;
+    request->segments.emplace_back(static_cast<unsigned char*>(destination), size);
+    request->done = std::move(done);
+    enqueue(std::move(request));
+}
+
+std::future<void> AsyncIO::writeFile(const std::string& path, std::vector<Segment> segments,
+                                     std::shared_ptr<const void> keepAlive) {
+    auto promise = std::make_shared<std::promise<void>>();
+    std::future<void> result = promise->get_future();
+    submitWrite(path, std::move(segments), [promise, keepAlive](std::exception_ptr error) {
+        if (error) promise->set_exception(error);
+        else promise->set_value();
+    });
+    return result;
+}
+
+std::future<void> AsyncIO::readFile(const std::string& path, uint64_t offset, void* destination, size_t size,
+                                    std::shared_ptr<void> keepAlive) {
+    auto promise = std::make_shared<std::promise<void>>();
+    std::future<void> result = promise->get_future();
+    submitRead(path, offset, destination, size, [promise, keepAlive](std::exception_ptr error) {
+        if (error) promise->set_exception(error);
+        else promise->set_value();
+    });
+    return result;
+}
+
+bool AsyncIO::openRequest(Request& request) {
+    request.fd = request.write ? ::open(request.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+                               : ::open(request.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (request.fd < 0) {
+        request.error = std::make_exception_ptr(std::runtime_error(
+            (request.write ? "Cannot create file: " : "Cannot open file: ") + request.path));
+        return false;
+    }
+    return true;
+}
+
+void AsyncIO::finishRequest(Request& request) {
+    if (request.fd >= 0 && ::close(request.fd) != 0 && request.write && !request.error) {
+        request.error = std::make_exception_ptr(std::runtime_error("Failed to write image data: " + request.path));
+    }
+    request.fd = -1;
+    if (request.done) {
+        try {
+            request.done(request.error);
+        } catch (...) {
+            // A throwing completion must not take the I/O thread down
+        }
+    }
+}
+
+namespace {
+
+std::exception_ptr transferError(bool write, const std::string& path, int error) {
+    std::string message = write ? "Failed to write image data: " : "Failed to read complete image data: ";
+    message += path;
+    message += error != 0 ? std::string(": ") + std::strerror(error) : std::string(": unexpected end of file");
+    return std::make_exception_ptr(std::runtime_error(message));
+}
+
+} // namespace
+
+void AsyncIO::ringLoop() {
+    Trace::setThreadName("async io");
+    // One read or write of at most MAX_TRANSFER bytes; short transfers resume
+    struct Chunk {
+        Request* request;
+        unsigned char* data;
+        size_t size;
+        uint64_t offset;
+    };
+
+    std::deque<Chunk*> ready;
+    size_t inflight = 0;
+    size_t liveRequests = 0;
+    bool wakeArmed = false;
+
+    auto complete = [&](Request* request) {
+        finishRequest(*request);
+        delete request;
+        --liveRequests;
+    };
+
+    for (;;) {
+        std::deque<std::unique_ptr<Request>> incoming;
+        bool exiting;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            incoming.swap(pending);
+            exiting = stopping;
+        }
+        for (auto& owned : incoming) {
+            Request* request = owned.release();
+            ++liveRequests;
+            if (!openRequest(*request)) {
+                complete(request);
+                continue;
+            }
+            uint64_t offset = request->offset;
+            for (const auto& segment : request->segments) {
+                for (size_t done = 0; done < segment.second; done += MAX_TRANSFER) {
+                    size_t size = std::min(MAX_TRANSFER, segment.second - done);
+                    ready.push_back(new Chunk{request, segment.first + done, size, offset + done});
+                    ++request->outstanding;
+                }
+                offset += segment.second;
+            }
+            if (request->outstanding == 0) {
+                complete(request);
+            }
+        }
+        if (exiting && liveRequests == 0) {
+            break;
+        }
+
+        // Everything that fits goes to the kernel in one io_uring_enter;
+        // one completion slot stays reserved for the wake-up read
+        while (!ready.empty() && inflight + 1 < ring->cqEntries) {
+            io_uring_sqe* sqe = ring->nextSqe();
+            if (!sqe) {
+                break;
+            }
+            Chunk* chunk = ready.front();
+            ready.pop_front();
+            sqe->opcode = chunk->request->write ? IORING_OP_WRITE : IORING_OP_READ;
+            sqe->fd = chunk->request->fd;
+            sqe->addr = reinterpret_cast<uint64_t>(chunk->data);
+            sqe->len = static_cast<uint32_t>(chunk->size);
+            sqe->off = chunk->offset;
+            sqe->user_data = reinterpret_cast<uint64_t>(chunk);
+            ++inflight;
+            operationCount.fetch_add(1);
+        }
+        if (!wakeArmed) {
+            io_uring_sqe* sqe = ring->nextSqe();
+            if (sqe) {
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = wakeFd;
+                sqe->addr = reinterpret_cast<uint64_t>(&wakeValue);
+                sqe->len = sizeof(wakeValue);
+                sqe->off = static_cast<uint64_t>(-1); // not seekable
+                sqe->user_data = WAKE_TAG;
+                wakeArmed = true;
+            }
+        }
+
+        unsigned toSubmit = ring->publish();
+        int result = ring->enter(toSubmit, 1);
+        if (result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            // Only reachable through a corrupted ring; requests can no longer complete
+            std::cerr << "io_uring_enter failed: " << std::strerror(errno) << std::endl;
+            std::terminate();
+        }
+        if (result > 0 && toSubmit > 0) {
+            submitCount.fetch_add(1);
+        }
+
+        unsigned head = __atomic_load_n(ring->cqHead, __ATOMIC_RELAXED);
+        unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = ring->cqes[head & ring->cqMask];
+            if (cqe.user_data == WAKE_TAG) {
+                wakeArmed = false;
+                continue;
+            }
+            Chunk* chunk = reinterpret_cast<Chunk*>(cqe.user_data);
+            Request* request = chunk->request;
+            int transferred = cqe.res;
+            --inflight;
+            if (transferred == -EINTR || transferred == -EAGAIN) {
+                ready.push_front(chunk);
+                continue;
+            }
+            if (transferred <= 0) {
+                if (!request->error) {
+                    request->error = transferError(request->write, request->path, -transferred);
+                }
+            } else {
+                byteCount.fetch_add(static_cast<uint64_t>(transferred));
+                if (static_cast<size_t>(transferred) < chunk->size) {
+                    // Short transfer: queue the rest of the chunk again
+                    chunk->data += transferred;
+                    chunk->offset += static_cast<uint64_t>(transferred);
+                    chunk->size -= static_cast<size_t>(transferred);
+                    ready.push_front(chunk);
+                    continue;
+                }
+            }
+            delete chunk;
+            if (--request->outstanding == 0) {
+                complete(request);
+            }
+        }
+        __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+    }
+}
+
+void AsyncIO::blockingLoop() {
+    Trace::setThreadName("async io");
+    for (;;) {
+        std::unique_ptr<Request> request;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]() { return stopping || !pending.empty(); });
+            if (pending.empty()) {
+                return;
+            }
+            request = std::move(pending.front());
+            pending.pop_front();
+        }
+
+        BMP_TRACE_SCOPE(trace, request->write ? "async write" : "async read", "io");
+        if (openRequest(*request)) {
+            uint64_t offset = request->offset;
+            for (const auto& segment : request->segments) {
+                size_t done = 0;
+                while (done < segment.second && !request->error) {
+                    size_t size = std::min(MAX_TRANSFER, segment.second - done);
+                    ssize_t transferred = request->write
+                        ? ::pwrite(request->fd, segment.first + done, size, static_cast<off_t>(offset + done))
+                        : ::pread(request->fd, segment.first + done, size, static_cast<off_t>(offset + done));
+                    operationCount.fetch_add(1);
+                    if (transferred < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (transferred <= 0) {
+                        request->error = transferError(request->write, request->path, transferred < 0 ? errno : 0);
+                        break;
+                    }
+                    done += static_cast<size_t>(transferred);
+                    byteCount.fetch_add(static_cast<uint64_t>(transferred));
+                }
+                offset += segment.second;
+            }
+        }
+        finishRequest(*request);
+    }
+}
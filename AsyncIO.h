@@ -0,0 +1,111 @@
+/*
+   Asynchronous File I/O (io_uring with a blocking fallback)
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef ASYNCIO_H
+#define ASYNCIO_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Whole-file writes and ranged reads executed by one I/O thread, so the
+// caller queues them and goes back to computing. With io_uring every
+// request queued since the last wake-up goes to the kernel in a single
+// io_uring_enter call and the transfers overlap; where io_uring is not
+// usable (kernels before 5.6, seccomp, io_uring_disabled) the same thread
+// performs plain pread/pwrite loops instead.
+class AsyncIO {
+public:
+    enum class Backend { Auto, IoUring, Blocking };
+
+    // One contiguous piece of a file written back to back with the others
+    struct Segment {
+        const void* data;
+        size_t size;
+    };
+
+    // Runs on the I/O thread when a request finishes; nullptr means success
+    using Completion = std::function<void(std::exception_ptr)>;
+
+    struct Stats {
+        uint64_t requests = 0;
+        uint64_t bytes = 0;
+        uint64_t kernelSubmits = 0;  // io_uring_enter calls that submitted work
+        uint64_t operations = 0;     // read/write operations issued
+    };
+
+private:
+    struct Request;
+    struct Ring;
+
+    Backend activeBackend;
+    std::unique_ptr<Ring> ring;
+    std::deque<std::unique_ptr<Request>> pending;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping;
+    int wakeFd;                      // eventfd that interrupts a waiting ring
+    uint64_t wakeValue;              // read target of the armed wake-up
+    std::thread ioThread;
+
+    std::atomic<uint64_t> requestCount{0};
+    std::atomic<uint64_t> byteCount{0};
+    std::atomic<uint64_t> submitCount{0};
+    std::atomic<uint64_t> operationCount{0};
+
+    void enqueue(std::unique_ptr<Request> request);
+    void wake();
+    void ringLoop();
+    void blockingLoop();
+    static bool openRequest(Request& request);
+    static void finishRequest(Request& request);
+
+public:
+    // Auto tries io_uring and falls back to Blocking; IoUring throws if unavailable
+    explicit AsyncIO(Backend backend = Backend::Auto);
+    // Waits for every queued request to finish
+    ~AsyncIO();
+
+    AsyncIO(const AsyncIO& other) = delete;
+    AsyncIO& operator=(const AsyncIO& other) = delete;
+    AsyncIO(AsyncIO&& other) = delete;
+    AsyncIO& operator=(AsyncIO&& other) = delete;
+
+    // Library-owned instance, created on first use with the default backend
+    static std::shared_ptr<AsyncIO> sharedInstance();
+    // Backend of the shared instance; only effective before its first use
+    static void setDefaultBackend(Backend backend);
+    static Backend parseBackend(const std::string& name);
+    static const char* backendName(Backend backend);
+
+    Backend backend() const { return activeBackend; }
+    Stats getStats() const;
+
+    // Create/truncate path and write the segments in order. The memory must
+    // stay valid until done runs.
+    void submitWrite(const std::string& path, std::vector<Segment> segments, Completion done);
+    // Read exactly size bytes at offset into destination
+    void submitRead(const std::string& path, uint64_t offset, void* destination, size_t size, Completion done);
+
+    // Future-returning forms; keepAlive is released once the request completes
+    std::future<void> writeFile(const std::string& path, std::vector<Segment> segments,
+                                std::shared_ptr<const void> keepAlive = nullptr);
+    std::future<void> readFile(const std::string& path, uint64_t offset, void* destination, size_t size,
+                               std::shared_ptr<void> keepAlive = nullptr);
+};
+
+#endif // ASYNCIO_H
@@ -0,0 +1,149 @@
+/*
+   Offline Kernel Auto-Tuner Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "AutoTuner.h"
+#include "WorkWithBMP_optimized.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+constexpr TuningProfile::Kernel TUNED_KERNELS[] = {
+    TuningProfile::Kernel::Rotate, TuningProfile::Kernel::Gaussian3x3, TuningProfile::Kernel::GaussianBlur};
+
+struct Candidate {
+    int threads;
+    int tileSize;
+    int chunksPerThread;
+    BMPImageOptimized::Scheduler scheduler;
+};
+
+} // namespace
+
+AutoTuner::AutoTuner(const Options& tunerOptions) : options(tunerOptions) {
+    if (options.maxThreads <= 0) {
+        options.maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (options.repetitions <= 0) {
+        throw std::invalid_argument("Tuning needs at least one timed run per candidate");
+    }
+    options.largestSizeClass = std::clamp(options.largestSizeClass, 0, TuningProfile::SIZE_CLASS_COUNT - 1);
+}
+
+std::pair<int, int> AutoTuner::sampleSize(int sizeClass) {
+    // Inside each class, with odd widths so rows carry padding
+    switch (sizeClass) {
+        case 0: return {201, 150};
+        case 1: return {721, 540};
+        case 2: return {2001, 1500};
+        default: return {4201, 4000};
+    }
+}
+
+std::vector<int> AutoTuner::threadCandidates() const {
+    std::vector<int> counts;
+    for (int threads : {1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64}) {
+        if (threads < options.maxThreads) counts.push_back(threads);
+    }
+    counts.push_back(options.maxThreads);
+    return counts;
+}
+
+TuningProfile AutoTuner::run(std::ostream* log) {
+    TuningProfile profile;
+    BMPImageOptimized image;
+    std::vector<BMPImageOptimized::Scheduler> schedulers = {BMPImageOptimized::Scheduler::WorkStealing};
+#ifdef _OPENMP
+    schedulers.push_back(BMPImageOptimized::Scheduler::OpenMP);
+#endif
+
+    for (int sizeClass = 0; sizeClass <= options.largestSizeClass; ++sizeClass) {
+        auto [width, height] = sampleSize(sizeClass);
+        auto desc = ImageKernels::makeDescriptor(width, height, 24);
+        std::vector<unsigned char> source(desc.dataSize());
+        std::mt19937 random(12345);
+        std::generate(source.begin(), source.end(), [&random]() { return static_cast<unsigned char>(random()); });
+        std::vector<unsigned char> dest(std::max(desc.dataSize(), ImageKernels::rotatedDescriptor(desc).dataSize()));
+
+        for (auto kernel : TUNED_KERNELS) {
+            auto runKernel = [&](int threads) {
+                if (kernel == TuningProfile::Kernel::Rotate) {
+                    image.rotateClockwise(source, dest, desc, threads);
+                } else if (kernel == TuningProfile::Kernel::Gaussian3x3) {
+                    image.applyGaussianFilter(source, dest, desc, threads);
+                } else {
+                    image.applyGaussianBlur(source, dest, desc, options.blurRadius, 0.0, threads);
+                }
+            };
+            // Median seconds of the timed runs after one warm-up
+            auto measure = [&](const Candidate& candidate) {
+                image.setTileSize(candidate.tileSize);
+                image.setChunksPerThread(candidate.chunksPerThread);
+                image.setScheduler(candidate.scheduler);
+                runKernel(candidate.threads);
+                std::vector<double> seconds;
+                for (int i = 0; i < options.repetitions; ++i) {
+                    auto start = std::chrono::steady_clock::now();
+                    runKernel(candidate.threads);
+                    seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+                }
+                std::nth_element(seconds.begin(), seconds.begin() + seconds.size() / 2, seconds.end());
+                return seconds[seconds.size() / 2];
+            };
+
+            Candidate best{1, ImageKernels::DEFAULT_TILE_SIZE, 4, BMPImageOptimized::Scheduler::WorkStealing};
+            double bestSeconds = measure(best);
+            double sequentialSeconds = bestSeconds;
+            // A candidate has to win by 3% so timing noise does not pick
+            // more threads or exotic settings for nothing
+            auto tryCandidate = [&](const Candidate& candidate) {
+                double seconds = measure(candidate);
+                if (seconds < bestSeconds * 0.97) {
+                    bestSeconds = seconds;
+                    best = candidate;
+                }
+            };
+
+            for (int threads : threadCandidates()) {
+                if (threads == 1) continue;
+                tryCandidate(Candidate{threads, best.tileSize, best.chunksPerThread, best.scheduler});
+            }
+            if (kernel == TuningProfile::Kernel::Rotate) {
+                for (int tileSize : {16, 32, 128, 256}) {
+                    tryCandidate(Candidate{best.threads, tileSize, best.chunksPerThread, best.scheduler});
+                }
+            }
+            // Chunking and scheduling only matter once the work is split
+            if (best.threads > 1) {
+                for (int chunks : {1, 2, 8, 16}) {
+                    tryCandidate(Candidate{best.threads, best.tileSize, chunks, best.scheduler});
+                }
+                for (auto scheduler : schedulers) {
+                    if (scheduler != best.scheduler) {
+                        tryCandidate(Candidate{best.threads, best.tileSize, best.chunksPerThread, scheduler});
+                    }
+                }
+            }
+
+            profile.set(kernel, sizeClass, TuningProfile::Settings{best.threads, best.tileSize, best.chunksPerThread,
+                                                                   BMPImageOptimized::schedulerName(best.scheduler)});
+            if (log != nullptr) {
+                *log << std::left << std::setw(12) << TuningProfile::kernelName(kernel) << std::setw(7)
+                     << TuningProfile::sizeClassName(sizeClass) << std::right << std::setw(3) << best.threads
+                     << " threads, tile " << best.tileSize << ", " << best.chunksPerThread << " chunks/thread, "
+                     << BMPImageOptimized::schedulerName(best.scheduler) << ": " << std::fixed
+                     << std::setprecision(3) << bestSeconds * 1000.0 << " ms (1 thread: "
+                     << sequentialSeconds * 1000.0 << " ms)" << std::endl;
+            }
+        }
+    }
+    return profile;
+}
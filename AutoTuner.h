@@ -0,0 +1,44 @@
+/*
+   Offline Kernel Auto-Tuner
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef AUTOTUNER_H
+#define AUTOTUNER_H
+
+#include "TuningProfile.h"
+#include <ostream>
+#include <vector>
+
+// Measures every profiled kernel on a synthetic 24-bit image per size
+// class and records the fastest settings. The search is a coordinate
+// descent: thread count first (library defaults for the rest), then tile
+// size (rotation only), chunks per thread and scheduler at the best point
+// so far. Each candidate gets one warm-up run and is scored by the median
+// of the timed runs.
+class AutoTuner {
+public:
+    struct Options {
+        int maxThreads = 0;         // largest thread count tried (0 = hardware concurrency)
+        int repetitions = 5;        // timed runs per candidate
+        int largestSizeClass = TuningProfile::SIZE_CLASS_COUNT - 1;
+        int blurRadius = 3;         // radius used for the GaussianBlur kernel
+    };
+
+    explicit AutoTuner(const Options& options);
+
+    // Progress lines go to log (nothing when nullptr)
+    TuningProfile run(std::ostream* log = nullptr);
+
+    // Width x height of the synthetic image for a size class
+    static std::pair<int, int> sampleSize(int sizeClass);
+
+private:
+    Options options;
+
+    std::vector<int> threadCandidates() const;
+};
+
+#endif // AUTOTUNER_H
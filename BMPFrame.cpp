@@ -0,0 +1,177 @@
+/*
+   In-Memory BMP Frame Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "BMPFrame.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+ImageKernels::ImageDescriptor descriptorFromInfoHeader(const unsigned char* infoHeader) {
+    int32_t width;
+    int32_t height;
+    int16_t bitsPerPixel;
+    std::memcpy(&width, infoHeader + 4, sizeof(width));
+    std::memcpy(&height, infoHeader + 8, sizeof(height));
+    std::memcpy(&bitsPerPixel, infoHeader + 14, sizeof(bitsPerPixel));
+    return ImageKernels::makeDescriptor(width, height, bitsPerPixel);
+}
+
+std::shared_ptr<unsigned char> adoptVector(std::vector<unsigned char>&& pixelData) {
+    auto owner = std::make_shared<std::vector<unsigned char>>(std::move(pixelData));
+    return std::shared_ptr<unsigned char>(owner, owner->data());
+}
+
+const std::vector<unsigned char>& emptyPalette() {
+    static const std::vector<unsigned char> empty;
+    return empty;
+}
+
+} // namespace
+
+BMPFrame::BMPFrame()
+    : desc{0, 0, 0, 0}, pixelBytes(0), bufferBytes(0), writable(false) {
+    std::memset(fileHeader, 0, FILE_HEADER_SIZE);
+    std::memset(infoHeader, 0, INFO_HEADER_SIZE);
+}
+
+BMPFrame::BMPFrame(const unsigned char* fileHeaderBytes, const unsigned char* infoHeaderBytes,
+                   std::vector<unsigned char> paletteBytes, std::vector<unsigned char> pixelData)
+    : desc(descriptorFromInfoHeader(infoHeaderBytes)),
+      palette(std::make_shared<const std::vector<unsigned char>>(std::move(paletteBytes))),
+      pixelBytes(pixelData.size()), bufferBytes(pixelData.size()), writable(true) {
+    if (pixelBytes != desc.dataSize()) {
+        throw std::runtime_error("Image data size mismatch");
+    }
+    std::memcpy(fileHeader, fileHeaderBytes, FILE_HEADER_SIZE);
+    std::memcpy(infoHeader, infoHeaderBytes, INFO_HEADER_SIZE);
+    pixels = adoptVector(std::move(pixelData));
+}
+
+BMPFrame::BMPFrame(const unsigned char* fileHeaderBytes, const unsigned char* infoHeaderBytes,
+                   std::vector<unsigned char> paletteBytes, std::shared_ptr<unsigned char> pixelBuffer,
+                   size_t bufferSize)
+    : desc(descriptorFromInfoHeader(infoHeaderBytes)),
+      palette(std::make_shared<const std::vector<unsigned char>>(std::move(paletteBytes))),
+      pixels(std::move(pixelBuffer)), pixelBytes(desc.dataSize()),
+      bufferBytes(std::max(bufferSize, desc.dataSize())), writable(true) {
+    if (!pixels) {
+        throw std::runtime_error("Frame holds no image data");
+    }
+    std::memcpy(fileHeader, fileHeaderBytes, FILE_HEADER_SIZE);
+    std::memcpy(infoHeader, infoHeaderBytes, INFO_HEADER_SIZE);
+}
+
+BMPFrame::BMPFrame(const unsigned char* fileHeaderBytes, const unsigned char* infoHeaderBytes,
+                   std::vector<unsigned char> paletteBytes, std::shared_ptr<const MappedFile> mapping,
+                   size_t offset)
+    : desc(descriptorFromInfoHeader(infoHeaderBytes)),
+      palette(std::make_shared<const std::vector<unsigned char>>(std::move(paletteBytes))),
+      pixelBytes(desc.dataSize()), bufferBytes(desc.dataSize()), writable(false) {
+    if (!mapping || mapping->size() < offset + pixelBytes) {
+        throw std::runtime_error("Failed to read complete image data");
+    }
+    std::memcpy(fileHeader, fileHeaderBytes, FILE_HEADER_SIZE);
+    std::memcpy(infoHeader, infoHeaderBytes, INFO_HEADER_SIZE);
+    // The mapping is PROT_READ; writable == false makes mutableData() copy first
+    pixels = std::shared_ptr<unsigned char>(mapping, const_cast<unsigned char*>(mapping->data() + offset));
+}
+
+BMPFrame::BMPFrame(BMPFrame&& other) noexcept
+    : desc(other.desc), palette(std::move(other.palette)), pixels(std::move(other.pixels)),
+      pixelBytes(other.pixelBytes), bufferBytes(other.bufferBytes), writable(other.writable),
+      orientation(other.orientation) {
+    std::memcpy(fileHeader, other.fileHeader, FILE_HEADER_SIZE);
+    std::memcpy(infoHeader, other.infoHeader, INFO_HEADER_SIZE);
+    other.desc = ImageKernels::ImageDescriptor{0, 0, 0, 0};
+    other.pixelBytes = 0;
+    other.bufferBytes = 0;
+    other.writable = false;
+    other.orientation = ImageKernels::Orientation::identity();
+}
+
+BMPFrame& BMPFrame::operator=(BMPFrame&& other) noexcept {
+    if (this != &other) {
+        std::memcpy(fileHeader, other.fileHeader, FILE_HEADER_SIZE);
+        std::memcpy(infoHeader, other.infoHeader, INFO_HEADER_SIZE);
+        desc = other.desc;
+        palette = std::move(other.palette);
+        pixels = std::move(other.pixels);
+        pixelBytes = other.pixelBytes;
+        bufferBytes = other.bufferBytes;
+        writable = other.writable;
+        orientation = other.orientation;
+        other.desc = ImageKernels::ImageDescriptor{0, 0, 0, 0};
+        other.pixelBytes = 0;
+        other.bufferBytes = 0;
+        other.writable = false;
+        other.orientation = ImageKernels::Orientation::identity();
+    }
+    return *this;
+}
+
+void BMPFrame::detach() {
+    auto copy = FramePool::sharedInstance()->acquire(pixelBytes);
+    std::memcpy(copy.get(), pixels.get(), pixelBytes);
+    pixels = std::move(copy);
+    bufferBytes = pixelBytes;
+    writable = true;
+}
+
+unsigned char* BMPFrame::mutableData() {
+    if (!pixels) {
+        throw std::runtime_error("Frame holds no image data");
+    }
+    if (!isExclusive()) {
+        detach();
+    }
+    return pixels.get();
+}
+
+void BMPFrame::assign(const ImageKernels::ImageDescriptor& newDesc, std::vector<unsigned char>&& pixelData) {
+    if (pixelData.size() != newDesc.dataSize()) {
+        throw std::runtime_error("Image data size mismatch");
+    }
+    desc = newDesc;
+    pixelBytes = pixelData.size();
+    bufferBytes = pixelBytes;
+    pixels = adoptVector(std::move(pixelData));
+    writable = true;
+    orientation = ImageKernels::Orientation::identity();
+}
+
+void BMPFrame::assign(const ImageKernels::ImageDescriptor& newDesc, std::shared_ptr<unsigned char> pixelBuffer,
+                      size_t bufferSize) {
+    if (!pixelBuffer) {
+        throw std::runtime_error("Frame holds no image data");
+    }
+    desc = newDesc;
+    pixelBytes = newDesc.dataSize();
+    bufferBytes = std::max(bufferSize, pixelBytes);
+    pixels = std::move(pixelBuffer);
+    writable = true;
+    orientation = ImageKernels::Orientation::identity();
+}
+
+void BMPFrame::reshape(const ImageKernels::ImageDescriptor& newDesc) {
+    if (!isExclusive()) {
+        throw std::runtime_error("Only an exclusive frame can be reshaped");
+    }
+    if (newDesc.dataSize() > bufferBytes) {
+        throw std::runtime_error("Frame buffer too small for the new geometry");
+    }
+    desc = newDesc;
+    pixelBytes = newDesc.dataSize();
+    orientation = ImageKernels::Orientation::identity();
+}
+
+const std::vector<unsigned char>& BMPFrame::getPalette() const {
+    return palette ? *palette : emptyPalette();
+}
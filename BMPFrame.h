@@ -0,0 +1,122 @@
+/*
+   In-Memory BMP Frame (headers, palette and pixels with copy-on-write)
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef BMPFRAME_H
+#define BMPFRAME_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "ImageKernels.h"
+#include "MappedFile.h"
+#include "FramePool.h"
+
+// A loaded image as a value: headers, palette and pixel storage travel
+// together, so a pipeline can branch without touching the disk again.
+// Copies share pixels and palette; the first write through mutableData()
+// on a shared or read-only (mapped) frame takes a private copy.
+//
+// A frame may carry a pending orientation: the image it represents is the
+// stored pixels (data(), getDescriptor()) transformed by getOrientation().
+// BMPImageOptimized composes rotations there and permutes pixels only when
+// a kernel or a save needs the physical layout.
+class BMPFrame {
+public:
+    static constexpr int FILE_HEADER_SIZE = 14;
+    static constexpr int INFO_HEADER_SIZE = 40;
+
+private:
+    unsigned char fileHeader[FILE_HEADER_SIZE];
+    unsigned char infoHeader[INFO_HEADER_SIZE];
+    ImageKernels::ImageDescriptor desc;
+
+    // Palette / extended header bytes, never modified after load
+    std::shared_ptr<const std::vector<unsigned char>> palette;
+
+    // Aliases its owner (a vector or a file mapping); writable is false for mappings
+    std::shared_ptr<unsigned char> pixels;
+    size_t pixelBytes;
+    size_t bufferBytes;     // usable size of the buffer, >= pixelBytes
+    bool writable;
+    ImageKernels::Orientation orientation;
+
+    void detach();
+
+public:
+    BMPFrame();
+
+    // Frame owning a pixel buffer
+    BMPFrame(const unsigned char* fileHeaderBytes, const unsigned char* infoHeaderBytes,
+             std::vector<unsigned char> paletteBytes, std::vector<unsigned char> pixelData);
+
+    // Frame owning a shared buffer (e.g. from a FramePool) of bufferSize bytes
+    // (0 = exactly desc.dataSize())
+    BMPFrame(const unsigned char* fileHeaderBytes, const unsigned char* infoHeaderBytes,
+             std::vector<unsigned char> paletteBytes, std::shared_ptr<unsigned char> pixelBuffer,
+             size_t bufferSize = 0);
+
+    // Frame reading its pixels (offset bytes into the file) from a shared mapping
+    BMPFrame(const unsigned char* fileHeaderBytes, const unsigned char* infoHeaderBytes,
+             std::vector<unsigned char> paletteBytes, std::shared_ptr<const MappedFile> mapping,
+             size_t offset);
+
+    // Copies are cheap (shared storage), moves leave the source empty
+    BMPFrame(const BMPFrame& other) = default;
+    BMPFrame& operator=(const BMPFrame& other) = default;
+    BMPFrame(BMPFrame&& other) noexcept;
+    BMPFrame& operator=(BMPFrame&& other) noexcept;
+    ~BMPFrame() = default;
+
+    // Explicit copy-on-write branch of this frame
+    BMPFrame clone() const { return *this; }
+
+    bool empty() const { return !pixels; }
+
+    // True when no other frame shares the pixels and they may be written in place
+    bool isExclusive() const { return writable && pixels.use_count() == 1; }
+
+    const unsigned char* data() const { return pixels.get(); }
+    size_t size() const { return pixelBytes; }
+    // Bytes an in-place kernel may use, e.g. for a rotation that widens the rows
+    size_t capacity() const { return bufferBytes; }
+
+    // Writable pixels; detaches from shared or mapped storage first (the
+    // private copy comes from the shared FramePool)
+    unsigned char* mutableData();
+
+    // Replace the pixels (and geometry) after an out-of-place kernel. Like
+    // reshape below, this stores a new image and clears the orientation.
+    void assign(const ImageKernels::ImageDescriptor& newDesc, std::vector<unsigned char>&& pixelData);
+    // Same with a buffer of at least newDesc.dataSize() bytes, e.g. from a FramePool
+    void assign(const ImageKernels::ImageDescriptor& newDesc, std::shared_ptr<unsigned char> pixelBuffer,
+                size_t bufferSize = 0);
+    // New geometry for the same (exclusive) buffer after an in-place kernel;
+    // newDesc.dataSize() must fit in capacity()
+    void reshape(const ImageKernels::ImageDescriptor& newDesc);
+
+    // Layout of the stored pixels
+    const ImageKernels::ImageDescriptor& getDescriptor() const { return desc; }
+    // Geometry of the represented image (stored layout after the orientation)
+    ImageKernels::ImageDescriptor getLogicalDescriptor() const {
+        return ImageKernels::orientedDescriptor(desc, orientation);
+    }
+    const ImageKernels::Orientation& getOrientation() const { return orientation; }
+    void setOrientation(const ImageKernels::Orientation& newOrientation) { orientation = newOrientation; }
+    bool isOriented() const { return !orientation.isIdentity(); }
+    
+    // Logical dimensions
+    int getWidth() const { return orientation.swapsAxes() ? desc.height : desc.width; }
+    int getHeight() const { return orientation.swapsAxes() ? desc.width : desc.height; }
+    int getBitsPerPixel() const { return desc.bitsPerPixel; }
+    size_t getDataSize() const { return desc.dataSize(); }
+
+    const unsigned char* getFileHeader() const { return fileHeader; }
+    const unsigned char* getInfoHeader() const { return infoHeader; }
+    const std::vector<unsigned char>& getPalette() const;
+};
+
+#endif // BMPFRAME_H
@@ -0,0 +1,234 @@
+/*
+   Batch Processing Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "BatchProcessor.h"
+#include "WorkWithBMP_optimized.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <glob.h>
+
+namespace {
+
+bool hasBmpExtension(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".bmp";
+}
+
+bool isGlobPattern(const std::string& spec) {
+    return spec.find_first_of("*?[") != std::string::npos;
+}
+
+// Width * height from the headers only, without touching the pixels
+uint64_t peekPixelCount(const std::string& inputFile) {
+    std::ifstream file(inputFile, std::ios::binary);
+    unsigned char headers[54];
+    if (!file.read(reinterpret_cast<char*>(headers), sizeof(headers))) {
+        throw std::runtime_error("Failed to read file header");
+    }
+    int32_t width;
+    int32_t height;
+    std::memcpy(&width, headers + 18, sizeof(width));
+    std::memcpy(&height, headers + 22, sizeof(height));
+    if (width <= 0 || height <= 0) {
+        throw std::runtime_error("Invalid image dimensions");
+    }
+    return static_cast<uint64_t>(width) * static_cast<uint64_t>(height);
+}
+
+} // namespace
+
+BatchProcessor::BatchProcessor(const Options& batchOptions) : options(batchOptions) {
+    if (options.numThreads <= 0) {
+        options.numThreads = std::thread::hardware_concurrency();
+        if (options.numThreads == 0) options.numThreads = 4; // fallback
+    }
+}
+
+void BatchProcessor::setThreadPool(std::shared_ptr<ThreadPool> pool) {
+    threadPool = std::move(pool);
+}
+
+std::vector<std::string> BatchProcessor::collectInputs(const std::string& spec) {
+    std::vector<std::string> inputs;
+    std::filesystem::path specPath(spec);
+
+    if (isGlobPattern(spec)) {
+        glob_t matches;
+        int status = ::glob(spec.c_str(), 0, nullptr, &matches);
+        if (status == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; ++i) {
+                if (std::filesystem::is_regular_file(matches.gl_pathv[i])) {
+                    inputs.emplace_back(matches.gl_pathv[i]);
+                }
+            }
+        }
+        globfree(&matches);
+    } else if (std::filesystem::is_directory(specPath)) {
+        for (const auto& entry : std::filesystem::directory_iterator(specPath)) {
+            if (entry.is_regular_file() && hasBmpExtension(entry.path())) {
+                inputs.push_back(entry.path().string());
+            }
+        }
+    } else if (std::filesystem::is_regular_file(specPath)) {
+        std::ifstream list(spec);
+        std::string line;
+        while (std::getline(list, line)) {
+            size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') {
+                continue;
+            }
+            size_t last = line.find_last_not_of(" \t\r");
+            inputs.push_back(line.substr(first, last - first + 1));
+        }
+        // Keep the list order: it is the caller's choice
+        if (inputs.empty()) {
+            throw std::runtime_error("Batch list is empty: " + spec);
+        }
+        return inputs;
+    }
+
+    if (inputs.empty()) {
+        throw std::runtime_error("No BMP files found for batch input: " + spec);
+    }
+    std::sort(inputs.begin(), inputs.end());
+    return inputs;
+}
+
+std::string BatchProcessor::outputPath(const std::string& inputFile, const std::string& suffix) const {
+    std::filesystem::path inputPath(inputFile);
+    std::string name = inputPath.stem().string() + "_" + suffix + inputPath.extension().string();
+    return (std::filesystem::path(options.outputDirectory) / name).string();
+}
+
+uint64_t BatchProcessor::processImage(const std::string& inputFile, int kernelThreads) const {
+    BMP_TRACE_SCOPE(trace, "image", "batch", "threads", kernelThreads);
+    BMPImageOptimized image;
+    image.setThreadPool(threadPool);
+    image.setFramePool(framePool);
+    if (options.tileSize > 0) {
+        image.setTileSize(options.tileSize);
+    }
+    image.setInPlaceRotation(options.inPlaceRotation);
+    image.setLazyOrientation(options.lazyOrientation);
+    auto loadMode = options.useMmap ? BMPImageOptimized::LoadMode::Mapped : BMPImageOptimized::LoadMode::Buffered;
+    BMPFrame source = image.loadFrame(inputFile, loadMode);
+    uint64_t pixels = static_cast<uint64_t>(source.getWidth()) * static_cast<uint64_t>(source.getHeight());
+
+    if (options.mapOutputs) {
+        for (bool clockwise : {true, false}) {
+            BMPFrame rotated = image.rotateToFile(
+                source, outputPath(inputFile, clockwise ? "rotated_clockwise_opt" : "rotated_counter_clockwise_opt"),
+                clockwise, kernelThreads);
+            image.filterToFile(
+                rotated, outputPath(inputFile, clockwise ? "filtered_clockwise_opt" : "filtered_counter_clockwise_opt"),
+                options.blurRadius, options.blurSigma, kernelThreads);
+        }
+        return pixels;
+    }
+    
+    // Outputs are written by the async I/O backend while the next kernel runs
+    std::vector<std::future<void>> saves;
+    for (bool clockwise : {true, false}) {
+        // The second branch consumes the source frame
+        BMPFrame frame = clockwise ? source.clone() : std::move(source);
+
+        if (kernelThreads > 1) {
+            if (clockwise) image.rotateClockwiseParallel(frame, kernelThreads);
+            else image.rotateCounterClockwiseParallel(frame, kernelThreads);
+        } else {
+            if (clockwise) image.rotateClockwise(frame);
+            else image.rotateCounterClockwise(frame);
+        }
+        // Both the rotated and the filtered frame are saved, so a deferred
+        // rotation is applied once here rather than by each save
+        image.materialize(frame, kernelThreads);
+        saves.push_back(image.saveToFileAsync(
+            outputPath(inputFile, clockwise ? "rotated_clockwise_opt" : "rotated_counter_clockwise_opt"), frame));
+
+        if (kernelThreads > 1) {
+            image.applyGaussianBlurParallel(frame, options.blurRadius, options.blurSigma, kernelThreads);
+        } else {
+            image.applyGaussianBlur(frame, options.blurRadius, options.blurSigma);
+        }
+        saves.push_back(image.saveToFileAsync(
+            outputPath(inputFile, clockwise ? "filtered_clockwise_opt" : "filtered_counter_clockwise_opt"), frame));
+    }
+    for (auto& save : saves) {
+        save.get();
+    }
+    return pixels;
+}
+
+BatchProcessor::Report BatchProcessor::run(const std::vector<std::string>& inputs) {
+    Report report;
+    report.workers = options.numThreads;
+    std::mutex reportMutex;
+    framePool = std::make_shared<FramePool>();
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    auto fail = [&](const std::string& inputFile, const std::exception& e) {
+        std::lock_guard<std::mutex> lock(reportMutex);
+        ++report.failed;
+        std::cerr << "Batch error: " << inputFile << ": " << e.what() << std::endl;
+    };
+
+    // Split by frame size from the headers alone
+    std::vector<std::string> smallFrames;
+    std::vector<std::string> largeFrames;
+    for (const auto& inputFile : inputs) {
+        try {
+            if (peekPixelCount(inputFile) >= options.largeFramePixels) {
+                largeFrames.push_back(inputFile);
+            } else {
+                smallFrames.push_back(inputFile);
+            }
+        } catch (const std::exception& e) {
+            fail(inputFile, e);
+        }
+    }
+
+    // Small frames: one image per worker, single-threaded kernels
+    auto pool = threadPool ? threadPool : ThreadPool::sharedInstance();
+    pool->parallelFor(static_cast<int>(smallFrames.size()), options.numThreads, [&](int index) {
+        try {
+            uint64_t pixels = processImage(smallFrames[index], 1);
+            std::lock_guard<std::mutex> lock(reportMutex);
+            ++report.images;
+            report.pixels += pixels;
+        } catch (const std::exception& e) {
+            fail(smallFrames[index], e);
+        }
+    });
+
+    // Large frames: one at a time, all workers inside the kernels
+    for (const auto& inputFile : largeFrames) {
+        try {
+            report.pixels += processImage(inputFile, options.numThreads);
+            ++report.images;
+            ++report.largeFrames;
+        } catch (const std::exception& e) {
+            fail(inputFile, e);
+        }
+    }
+
+    report.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+    // Every save has completed, so all frames are back in the pool
+    report.framePool = framePool->getStats();
+    framePool.reset();
+    return report;
+}
@@ -0,0 +1,82 @@
+/*
+   Batch Processing of Many BMP Files
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ThreadPool.h"
+#include "FramePool.h"
+
+// Processes independent images concurrently, one image per worker with
+// single-threaded kernels. Only frames of at least largeFramePixels are
+// processed one after another with intra-image parallelism, so small files
+// never pay for splitting a kernel that fits in one core's cache.
+class BatchProcessor {
+public:
+    // 2048 x 2048: below this a single image does not keep several cores busy
+    static constexpr uint64_t DEFAULT_LARGE_FRAME_PIXELS = uint64_t(2048) * 2048;
+
+    struct Options {
+        int numThreads = 0;          // workers (0 = hardware concurrency)
+        int tileSize = 0;            // 0 = library default
+        int blurRadius = 1;
+        double blurSigma = 0.0;
+        bool useMmap = false;
+        uint64_t largeFramePixels = DEFAULT_LARGE_FRAME_PIXELS;
+        std::string outputDirectory = ".";
+        bool mapOutputs = false;     // kernels write into mapped output files (no save copy)
+        bool inPlaceRotation = false; // rotate exclusive frames inside their own buffer
+        bool lazyOrientation = false; // rotations only compose; pixels move on save or filter
+    };
+
+    struct Report {
+        size_t images = 0;           // processed successfully
+        size_t failed = 0;
+        size_t largeFrames = 0;      // processed with intra-image parallelism
+        uint64_t pixels = 0;         // source pixels of successful images
+        int workers = 0;
+        double seconds = 0.0;
+        FramePool::Stats framePool;  // buffers recycled by this run's pool
+
+        double imagesPerSecond() const { return seconds > 0.0 ? images / seconds : 0.0; }
+        double megapixelsPerSecond() const { return seconds > 0.0 ? pixels / seconds / 1e6 : 0.0; }
+    };
+
+private:
+    Options options;
+    std::shared_ptr<ThreadPool> threadPool;
+    // Per-run arena: images of one batch recycle each other's frame buffers,
+    // and the idle ones are freed when the run ends
+    std::shared_ptr<FramePool> framePool;
+
+public:
+    explicit BatchProcessor(const Options& batchOptions);
+
+    void setThreadPool(std::shared_ptr<ThreadPool> pool);
+
+    // Expand a directory (its *.bmp files), a glob pattern, or a list file
+    // (one path per line, blank lines and '#' comments skipped) into a sorted
+    // list of inputs. Throws std::runtime_error if nothing matches.
+    static std::vector<std::string> collectInputs(const std::string& spec);
+
+    // Output path for input with the given suffix, e.g. <dir>/<stem>_<suffix>.bmp
+    std::string outputPath(const std::string& inputFile, const std::string& suffix) const;
+
+    // Load, rotate both ways, filter and save the four outputs of one image
+    // using kernelThreads threads inside each kernel. Returns source pixels.
+    uint64_t processImage(const std::string& inputFile, int kernelThreads) const;
+
+    // Process all inputs; per-file errors are reported on std::cerr and counted
+    Report run(const std::vector<std::string>& inputs);
+};
+
+#endif // BATCHPROCESSOR_H
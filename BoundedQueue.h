@@ -0,0 +1,142 @@
+/*
+   Bounded Lock-free MPMC Queue with Backpressure
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Fixed-capacity multi-producer multi-consumer ring (D. Vyukov's design):
+// every cell carries a sequence number that tells producers and consumers
+// whose turn it is, so push and pop are a CAS on a position counter plus a
+// release store, without locks. push() blocks while the queue is full,
+// which is what throttles a fast stage to the speed of the next one.
+template<typename T>
+class BoundedQueue {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::vector<Cell> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePosition{0};
+    alignas(64) std::atomic<size_t> dequeuePosition{0};
+    alignas(64) std::atomic<bool> closed{false};
+
+    // Spin briefly, then yield, then sleep: stages may wait for a whole frame
+    static void backoff(int& attempt) {
+        if (attempt < 64) {
+            ++attempt;
+        } else if (attempt < 128) {
+            ++attempt;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+public:
+    // Capacity is rounded up to a power of two, at least 2: with a single
+    // cell a full slot has the same sequence as a free one for the next lap
+    explicit BoundedQueue(size_t capacity) {
+        if (capacity == 0) {
+            throw std::invalid_argument("Queue capacity must be positive");
+        }
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        cells = std::vector<Cell>(size);
+        mask = size - 1;
+        for (size_t i = 0; i < size; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue& other) = delete;
+    BoundedQueue& operator=(const BoundedQueue& other) = delete;
+
+    size_t capacity() const { return cells.size(); }
+
+    bool tryPush(T& value) {
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;    // full
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& value) {
+        size_t position = dequeuePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (difference == 0) {
+                if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    cell.value = T();
+                    cell.sequence.store(position + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;    // empty
+            } else {
+                position = dequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Blocks while full (backpressure)
+    void push(T value) {
+        int attempt = 0;
+        while (!tryPush(value)) {
+            backoff(attempt);
+        }
+    }
+
+    // Blocks while empty; returns false once the queue is closed and drained
+    bool pop(T& value) {
+        int attempt = 0;
+        for (;;) {
+            if (tryPop(value)) {
+                return true;
+            }
+            if (closed.load(std::memory_order_acquire)) {
+                // Items pushed before close() must still be delivered
+                return tryPop(value);
+            }
+            backoff(attempt);
+        }
+    }
+
+    // Called once every producer has finished pushing
+    void close() {
+        closed.store(true, std::memory_order_release);
+    }
+};
+
+#endif // BOUNDEDQUEUE_H
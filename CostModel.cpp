@@ -0,0 +1,185 @@
+/*
+   Sequential / Parallel Cutover Cost Model Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "CostModel.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+// "48K", "2048K", "105M" as found in sysfs; 0 when unparsable
+size_t parseCacheSize(const std::string& text) {
+    size_t pos = 0;
+    unsigned long long value = 0;
+    try {
+        value = std::stoull(text, &pos);
+    } catch (const std::exception&) {
+        return 0;
+    }
+    char unit = pos < text.size() ? text[pos] : '\0';
+    if (unit == 'K' || unit == 'k') value *= 1024;
+    else if (unit == 'M' || unit == 'm') value *= 1024 * 1024;
+    else if (unit == 'G' || unit == 'g') value *= 1024ull * 1024 * 1024;
+    return static_cast<size_t>(value);
+}
+
+size_t sysconfSize(int name) {
+    long value = sysconf(name);
+    return value > 0 ? static_cast<size_t>(value) : 0;
+}
+
+} // namespace
+
+CostModel::CacheSizes CostModel::CacheSizes::detect() {
+    CacheSizes sizes;
+    size_t found[4] = {0, 0, 0, 0};
+    for (int index = 0; index < 8; ++index) {
+        std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+        std::ifstream levelFile(dir + "level");
+        std::ifstream typeFile(dir + "type");
+        std::ifstream sizeFile(dir + "size");
+        int level = 0;
+        std::string type;
+        std::string size;
+        if (!(levelFile >> level) || !(typeFile >> type) || !(sizeFile >> size)) {
+            continue;
+        }
+        // Instruction caches do not hold pixels
+        if (level >= 1 && level <= 3 && type != "Instruction") {
+            found[level] = parseCacheSize(size);
+        }
+    }
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    if (found[1] == 0) found[1] = sysconfSize(_SC_LEVEL1_DCACHE_SIZE);
+    if (found[2] == 0) found[2] = sysconfSize(_SC_LEVEL2_CACHE_SIZE);
+    if (found[3] == 0) found[3] = sysconfSize(_SC_LEVEL3_CACHE_SIZE);
+#endif
+    if (found[1] > 0) sizes.l1d = found[1];
+    if (found[2] > 0) sizes.l2 = found[2];
+    // Without an L3 the L2 is the last level
+    sizes.l3 = found[3] > 0 ? found[3] : sizes.l2;
+    return sizes;
+}
+
+CostModel::CostModel() : cacheSizes(CacheSizes::detect()) {}
+
+CostModel::CostModel(const CacheSizes& caches, const Coefficients& coefficients)
+    : cacheSizes(caches), costs(coefficients) {
+    if (costs.dispatchMicroseconds < 0.0 || costs.bandwidthThreads <= 0) {
+        throw std::invalid_argument("Cost model needs a non-negative dispatch cost and a positive bandwidth "
+                                    "thread count");
+    }
+    for (int i = 0; i < OPERATION_COUNT; ++i) {
+        if (costs.inCacheNsPerByte[i] <= 0.0 || costs.outOfCacheNsPerByte[i] <= 0.0) {
+            throw std::invalid_argument("Cost model per-byte costs must be positive");
+        }
+    }
+}
+
+bool CostModel::memoryBound(Operation operation) {
+    // Rotation and the SIMD 3x3 filter move bytes; the wide blur and the
+    // fused path spend their time in arithmetic
+    return operation == Operation::Rotate || operation == Operation::Gaussian3x3;
+}
+
+double CostModel::estimateMicroseconds(Operation operation, size_t workingSetBytes, int threads,
+                                       double workScale) const {
+    threads = std::max(1, threads);
+    int index = static_cast<int>(operation);
+    double bytes = static_cast<double>(workingSetBytes) * std::max(workScale, 0.0);
+    // A frame that fits the L2 is usually still there from the previous kernel
+    bool inCache = workingSetBytes <= cacheSizes.l2;
+    double compute = bytes * (inCache ? costs.inCacheNsPerByte[index] : costs.outOfCacheNsPerByte[index]) /
+                     1000.0 / threads;
+    if (workingSetBytes > cacheSizes.l3 && memoryBound(operation)) {
+        double bandwidthFloor = bytes * costs.outOfCacheNsPerByte[index] / 1000.0 / costs.bandwidthThreads;
+        compute = std::max(compute, bandwidthFloor);
+    }
+    return compute + costs.dispatchMicroseconds * (threads - 1);
+}
+
+CostModel::Decision CostModel::decide(Operation operation, const ImageKernels::ImageDescriptor& desc,
+                                      int maxThreads, double workScale) const {
+    Decision decision;
+    decision.operation = operation;
+    decision.maxThreads = std::max(1, maxThreads);
+    decision.width = desc.width;
+    decision.height = desc.height;
+    decision.pixels = static_cast<uint64_t>(desc.width) * static_cast<uint64_t>(desc.height);
+    // Source plus destination; both rotated and unrotated layouts have the same size up to padding
+    decision.workingSetBytes = desc.dataSize() + ImageKernels::rotatedDescriptor(desc).dataSize();
+    decision.sequentialMicroseconds = estimateMicroseconds(operation, decision.workingSetBytes, 1, workScale);
+    decision.estimatedMicroseconds = decision.sequentialMicroseconds;
+
+    // Ties go to fewer threads
+    for (int threads = 2; threads <= decision.maxThreads; ++threads) {
+        double estimate = estimateMicroseconds(operation, decision.workingSetBytes, threads, workScale);
+        if (estimate < decision.estimatedMicroseconds) {
+            decision.estimatedMicroseconds = estimate;
+            decision.threads = threads;
+        }
+    }
+    decision.mode = modeFor(decision.threads, decision.maxThreads);
+    return decision;
+}
+
+double CostModel::blurWorkScale(const ImageKernels::GaussianPlan& plan) {
+    // Three box passes cost about as much as an 11-tap kernel
+    return plan.useBoxBlur ? 11.0 : 2.0 * plan.radius + 1.0;
+}
+
+CostModel::Mode CostModel::modeFor(int threads, int maxThreads) {
+    if (threads <= 1) return Mode::Sequential;
+    return threads >= maxThreads ? Mode::Full : Mode::Partial;
+}
+
+const char* CostModel::operationName(Operation operation) {
+    switch (operation) {
+        case Operation::Rotate: return "rotate";
+        case Operation::Gaussian3x3: return "gaussian3x3";
+        case Operation::GaussianBlur: return "blur";
+        default: return "rotate+filter";
+    }
+}
+
+const char* CostModel::modeName(Mode mode) {
+    switch (mode) {
+        case Mode::Sequential: return "sequential";
+        case Mode::Partial: return "partial";
+        default: return "full";
+    }
+}
+
+std::string CostModel::describe(const Decision& decision) {
+    auto duration = [](double microseconds) {
+        std::ostringstream text;
+        if (microseconds < 1000.0) {
+            text << std::fixed << std::setprecision(0) << microseconds << " us";
+        } else {
+            text << std::fixed << std::setprecision(1) << microseconds / 1000.0 << " ms";
+        }
+        return text.str();
+    };
+    std::ostringstream line;
+    line << operationName(decision.operation) << ' ' << decision.width << 'x' << decision.height << ": "
+         << modeName(decision.mode) << ", " << decision.threads << " of " << decision.maxThreads
+         << (decision.maxThreads == 1 ? " thread" : " threads")
+         << (decision.fromProfile ? " from the tuning profile" : "") << " (est. "
+         << duration(decision.estimatedMicroseconds) << ", 1 thread " << duration(decision.sequentialMicroseconds)
+         << ")";
+    return line.str();
+}
+
+std::shared_ptr<const CostModel> CostModel::sharedInstance() {
+    static std::shared_ptr<const CostModel> instance = std::make_shared<CostModel>();
+    return instance;
+}
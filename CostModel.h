@@ -0,0 +1,103 @@
+/*
+   Sequential / Parallel Cutover Cost Model
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef COSTMODEL_H
+#define COSTMODEL_H
+
+#include "ImageKernels.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Estimates the run time of one kernel call on k threads and picks the
+// cheapest k. The bytes read and written move at the in-cache rate when
+// source and destination fit the L2, at the slower out-of-cache rate
+// otherwise, split evenly across the threads. Every extra thread adds a
+// fixed dispatch cost (wake-up, stealing, join), and memory-bound kernels
+// on working sets beyond the L3 stop scaling at bandwidthThreads.
+class CostModel {
+public:
+    enum class Operation {
+        Rotate,
+        Gaussian3x3,
+        GaussianBlur,       // per kernel tap; see blurWorkScale
+        RotateAndFilter     // fused rotation + 3x3 filter
+    };
+    static constexpr int OPERATION_COUNT = 4;
+
+    enum class Mode {
+        Sequential,         // 1 thread
+        Partial,            // 1 < k < maxThreads
+        Full                // every allowed thread
+    };
+
+    struct CacheSizes {
+        size_t l1d = 32 * 1024;
+        size_t l2 = 1024 * 1024;
+        size_t l3 = 8 * 1024 * 1024;
+
+        // From /sys/devices/system/cpu/cpu0/cache, the defaults above where unknown
+        static CacheSizes detect();
+    };
+
+    struct Coefficients {
+        // Nanoseconds per byte moved (source + destination) on one thread,
+        // measured with 24-bit images
+        double inCacheNsPerByte[OPERATION_COUNT] = {0.15, 0.07, 1.2, 0.8};
+        double outOfCacheNsPerByte[OPERATION_COUNT] = {0.9, 0.22, 1.25, 1.3};
+        // Added per thread beyond the first
+        double dispatchMicroseconds = 12.0;
+        // Threads that saturate memory bandwidth (memory-bound kernels only)
+        int bandwidthThreads = 4;
+    };
+
+    struct Decision {
+        Operation operation = Operation::Rotate;
+        Mode mode = Mode::Sequential;
+        int threads = 1;
+        int maxThreads = 1;
+        int width = 0;
+        int height = 0;
+        uint64_t pixels = 0;
+        size_t workingSetBytes = 0;
+        double sequentialMicroseconds = 0.0;   // model estimate for 1 thread
+        double estimatedMicroseconds = 0.0;    // model estimate for the chosen count
+        bool fromProfile = false;              // threads taken from the tuning profile
+    };
+
+    CostModel();
+    CostModel(const CacheSizes& caches, const Coefficients& coefficients);
+
+    // workScale multiplies the per-byte cost (e.g. the blur radius)
+    Decision decide(Operation operation, const ImageKernels::ImageDescriptor& desc, int maxThreads,
+                    double workScale = 1.0) const;
+    double estimateMicroseconds(Operation operation, size_t workingSetBytes, int threads,
+                                double workScale = 1.0) const;
+
+    // Taps of the plan's 1D pass (the box approximation costs about 11)
+    static double blurWorkScale(const ImageKernels::GaussianPlan& plan);
+    static Mode modeFor(int threads, int maxThreads);
+    static const char* operationName(Operation operation);
+    static const char* modeName(Mode mode);
+    // One line for logs, e.g. "rotate 2048x1536: partial, 4 of 8 threads (est. 4.1 ms, 1 thread 16.4 ms)"
+    static std::string describe(const Decision& decision);
+
+    // Model for the detected caches and default coefficients, built once
+    static std::shared_ptr<const CostModel> sharedInstance();
+
+    const CacheSizes& caches() const { return cacheSizes; }
+    const Coefficients& coefficients() const { return costs; }
+
+private:
+    CacheSizes cacheSizes;
+    Coefficients costs;
+
+    static bool memoryBound(Operation operation);
+};
+
+#endif // COSTMODEL_H
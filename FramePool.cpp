@@ -0,0 +1,107 @@
+/*
+   Size-Classed Pool Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "FramePool.h"
+
+FramePool::FramePool(size_t cacheLimitBytes) : cacheLimit(cacheLimitBytes) {
+}
+
+FramePool::~FramePool() {
+    trim();
+}
+
+std::shared_ptr<FramePool> FramePool::sharedInstance() {
+    static std::shared_ptr<FramePool> instance = std::make_shared<FramePool>();
+    return instance;
+}
+
+size_t FramePool::sizeClass(size_t size) {
+    if (size <= MIN_CLASS_SIZE) {
+        return MIN_CLASS_SIZE;
+    }
+    // Four steps between consecutive powers of two
+    int highBit = 63 - __builtin_clzll(static_cast<unsigned long long>(size - 1));
+    size_t step = (size_t(1) << highBit) / 4;
+    return (size + step - 1) / step * step;
+}
+
+std::shared_ptr<unsigned char> FramePool::acquire(size_t size) {
+    size_t classSize = sizeClass(size);
+    unsigned char* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        auto it = freeLists.find(classSize);
+        if (it != freeLists.end() && !it->second.empty()) {
+            buffer = it->second.back();
+            it->second.pop_back();
+            stats.cachedBytes -= classSize;
+            ++stats.hits;
+        } else {
+            ++stats.misses;
+        }
+        stats.liveBytes += classSize;
+    }
+    if (buffer == nullptr) {
+        try {
+            // Default-initialized: no zero-fill pass over the new pages
+            buffer = new unsigned char[classSize];
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            stats.liveBytes -= classSize;
+            throw;
+        }
+    }
+    auto self = shared_from_this();
+    return std::shared_ptr<unsigned char>(buffer, [self, classSize](unsigned char* released) {
+        self->release(released, classSize);
+    });
+}
+
+void FramePool::release(unsigned char* buffer, size_t classSize) {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        stats.liveBytes -= classSize;
+        if (stats.cachedBytes + classSize <= cacheLimit) {
+            freeLists[classSize].push_back(buffer);
+            stats.cachedBytes += classSize;
+            return;
+        }
+        ++stats.dropped;
+    }
+    delete[] buffer;
+}
+
+void FramePool::trim() {
+    std::map<size_t, std::vector<unsigned char*>> idle;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        idle.swap(freeLists);
+        stats.cachedBytes = 0;
+    }
+    for (auto& entry : idle) {
+        for (unsigned char* buffer : entry.second) {
+            delete[] buffer;
+        }
+    }
+}
+
+void FramePool::setCacheLimit(size_t bytes) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    cacheLimit = bytes;
+}
+
+FramePool::Stats FramePool::getStats() const {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return stats;
+}
+
+void FramePool::resetStats() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    stats.hits = 0;
+    stats.misses = 0;
+    stats.dropped = 0;
+}
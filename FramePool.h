@@ -0,0 +1,74 @@
+/*
+   Size-Classed Pool for Pixel Buffers
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Recycles frame-sized pixel buffers between operations and images. Sizes
+// are rounded up to classes four per power of two (at most 25% slack), so a
+// rotated frame (same pixels, different row padding) usually reuses the
+// buffer its source came from. Buffers are handed out uninitialized: the
+// kernels overwrite every pixel byte and clear only the row padding.
+//
+// A released buffer goes back to its pool when the last frame referencing
+// it drops, from whichever thread that happens on. Pools must be owned by a
+// std::shared_ptr; each outstanding buffer keeps its pool alive.
+class FramePool : public std::enable_shared_from_this<FramePool> {
+public:
+    static constexpr size_t MIN_CLASS_SIZE = 4096;
+    static constexpr size_t DEFAULT_CACHE_LIMIT = size_t(512) << 20;
+
+    struct Stats {
+        uint64_t hits = 0;           // served from a cached buffer
+        uint64_t misses = 0;         // fresh allocations
+        uint64_t dropped = 0;        // released buffers freed because the cache was full
+        size_t cachedBytes = 0;      // idle buffers held by the pool
+        size_t liveBytes = 0;        // buffers currently handed out
+
+        double hitRate() const { return hits + misses > 0 ? static_cast<double>(hits) / (hits + misses) : 0.0; }
+    };
+
+private:
+    mutable std::mutex poolMutex;
+    std::map<size_t, std::vector<unsigned char*>> freeLists;
+    size_t cacheLimit;
+    Stats stats;
+
+    void release(unsigned char* buffer, size_t classSize);
+
+public:
+    explicit FramePool(size_t cacheLimitBytes = DEFAULT_CACHE_LIMIT);
+    ~FramePool();
+
+    FramePool(const FramePool& other) = delete;
+    FramePool& operator=(const FramePool& other) = delete;
+
+    // Library-wide pool used by BMPImageOptimized and BMPFrame unless a
+    // pipeline injects its own
+    static std::shared_ptr<FramePool> sharedInstance();
+
+    static size_t sizeClass(size_t size);
+
+    // Buffer of at least size bytes with undefined contents
+    std::shared_ptr<unsigned char> acquire(size_t size);
+
+    // Free every idle buffer (outstanding ones still return when released)
+    void trim();
+    void setCacheLimit(size_t bytes);
+
+    Stats getStats() const;
+    void resetStats();
+};
+
+#endif // FRAMEPOOL_H
@@ -0,0 +1,1105 @@
+/*
+   Low-level Image Kernels Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "ImageKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define IMAGEKERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace ImageKernels {
+
+namespace {
+
+// Fixed-size pixel copy so the compiler emits plain moves for 24/32 bpp
+template<int BytesPerPixel>
+inline void copyPixel(unsigned char* dst, const unsigned char* src, int /* bytesPerPixel */) {
+    std::memcpy(dst, src, BytesPerPixel);
+}
+
+template<>
+inline void copyPixel<0>(unsigned char* dst, const unsigned char* src, int bytesPerPixel) {
+    std::memcpy(dst, src, bytesPerPixel);
+}
+
+// Clockwise: destination (nx, ny) comes from source (srcWidth - 1 - ny, nx).
+// Along a destination row the source walks down a column, and a tile of T
+// destination rows touches only T source rows, so both sides stay in cache.
+template<int BytesPerPixel>
+void rotateTileClockwiseImpl(const unsigned char* src, int srcWidth, size_t srcStride,
+                             unsigned char* dst, size_t dstStride, int bytesPerPixel,
+                             int dstX0, int dstY0, int dstX1, int dstY1) {
+    for (int ny = dstY0; ny < dstY1; ++ny) {
+        const unsigned char* srcColumn = src + static_cast<size_t>(srcWidth - 1 - ny) * bytesPerPixel;
+        unsigned char* dstRow = dst + static_cast<size_t>(ny) * dstStride;
+        for (int nx = dstX0; nx < dstX1; ++nx) {
+            copyPixel<BytesPerPixel>(dstRow + static_cast<size_t>(nx) * bytesPerPixel,
+                                     srcColumn + static_cast<size_t>(nx) * srcStride, bytesPerPixel);
+        }
+    }
+}
+
+// Counter-clockwise: destination (nx, ny) comes from source (ny, srcHeight - 1 - nx)
+template<int BytesPerPixel>
+void rotateTileCounterClockwiseImpl(const unsigned char* src, int srcHeight, size_t srcStride,
+                                    unsigned char* dst, size_t dstStride, int bytesPerPixel,
+                                    int dstX0, int dstY0, int dstX1, int dstY1) {
+    for (int ny = dstY0; ny < dstY1; ++ny) {
+        const unsigned char* srcColumn = src + static_cast<size_t>(ny) * bytesPerPixel;
+        unsigned char* dstRow = dst + static_cast<size_t>(ny) * dstStride;
+        for (int nx = dstX0; nx < dstX1; ++nx) {
+            copyPixel<BytesPerPixel>(dstRow + static_cast<size_t>(nx) * bytesPerPixel,
+                                     srcColumn + static_cast<size_t>(srcHeight - 1 - nx) * srcStride,
+                                     bytesPerPixel);
+        }
+    }
+}
+
+} // namespace
+
+size_t bmpRowStride(int width, int bitsPerPixel) {
+    size_t rowBytes = static_cast<size_t>(width) * (bitsPerPixel / 8);
+    return (rowBytes + 3) & ~static_cast<size_t>(3);
+}
+
+ImageDescriptor makeDescriptor(int width, int height, int bitsPerPixel) {
+    return ImageDescriptor{width, height, bmpRowStride(width, bitsPerPixel), bitsPerPixel};
+}
+
+ImageDescriptor rotatedDescriptor(const ImageDescriptor& desc) {
+    return makeDescriptor(desc.height, desc.width, desc.bitsPerPixel);
+}
+
+Orientation Orientation::then(const Orientation& next) const {
+    // A mirror reverses the direction of the turns before it: M R^t = R^-t M
+    int turns = next.mirrored ? next.quarterTurns - quarterTurns : next.quarterTurns + quarterTurns;
+    return {((turns % 4) + 4) % 4, mirrored != next.mirrored};
+}
+
+const char* orientationName(const Orientation& orientation) {
+    static const char* const names[2][4] = {
+        {"identity", "clockwise", "half turn", "counter-clockwise"},
+        {"horizontal mirror", "transpose", "vertical mirror", "anti-transpose"}
+    };
+    return names[orientation.mirrored ? 1 : 0][orientation.quarterTurns & 3];
+}
+
+ImageDescriptor orientedDescriptor(const ImageDescriptor& desc, const Orientation& orientation) {
+    return orientation.swapsAxes() ? rotatedDescriptor(desc) : desc;
+}
+
+void clearRowPadding(unsigned char* data, const ImageDescriptor& desc) {
+    size_t rowBytes = static_cast<size_t>(desc.width) * desc.bytesPerPixel();
+    size_t padding = desc.stride - rowBytes;
+    if (padding == 0) {
+        return;
+    }
+    for (int y = 0; y < desc.height; ++y) {
+        std::memset(data + static_cast<size_t>(y) * desc.stride + rowBytes, 0, padding);
+    }
+}
+
+void writeBmpGeometry(unsigned char* fileHeader, unsigned char* infoHeader,
+                      const ImageDescriptor& desc, size_t paletteSize) {
+    auto store32 = [](unsigned char* field, uint64_t value) {
+        uint32_t stored = value > UINT32_MAX ? 0u : static_cast<uint32_t>(value);
+        std::memcpy(field, &stored, sizeof(stored));
+    };
+    const uint64_t headerBytes = 14 + 40;
+    uint64_t dataOffset = headerBytes + paletteSize;
+    uint64_t dataSize = desc.dataSize();
+    
+    store32(fileHeader + 2, dataOffset + dataSize);
+    store32(fileHeader + 10, dataOffset);
+    int32_t width = desc.width;
+    int32_t height = desc.height;
+    std::memcpy(infoHeader + 4, &width, sizeof(width));
+    std::memcpy(infoHeader + 8, &height, sizeof(height));
+    store32(infoHeader + 16, 0);
+    store32(infoHeader + 20, dataSize);
+}
+
+void rotateTileClockwise(const unsigned char* src, int srcWidth, int /* srcHeight */, size_t srcStride,
+                         unsigned char* dst, size_t dstStride, int bytesPerPixel,
+                         int dstX0, int dstY0, int dstX1, int dstY1) {
+    switch (bytesPerPixel) {
+        case 3:
+            rotateTileClockwiseImpl<3>(src, srcWidth, srcStride, dst, dstStride, bytesPerPixel,
+                                       dstX0, dstY0, dstX1, dstY1);
+            break;
+        case 4:
+            rotateTileClockwiseImpl<4>(src, srcWidth, srcStride, dst, dstStride, bytesPerPixel,
+                                       dstX0, dstY0, dstX1, dstY1);
+            break;
+        default:
+            rotateTileClockwiseImpl<0>(src, srcWidth, srcStride, dst, dstStride, bytesPerPixel,
+                                       dstX0, dstY0, dstX1, dstY1);
+            break;
+    }
+}
+
+void rotateTileCounterClockwise(const unsigned char* src, int /* srcWidth */, int srcHeight, size_t srcStride,
+                                unsigned char* dst, size_t dstStride, int bytesPerPixel,
+                                int dstX0, int dstY0, int dstX1, int dstY1) {
+    switch (bytesPerPixel) {
+        case 3:
+            rotateTileCounterClockwiseImpl<3>(src, srcHeight, srcStride, dst, dstStride, bytesPerPixel,
+                                              dstX0, dstY0, dstX1, dstY1);
+            break;
+        case 4:
+            rotateTileCounterClockwiseImpl<4>(src, srcHeight, srcStride, dst, dstStride, bytesPerPixel,
+                                              dstX0, dstY0, dstX1, dstY1);
+            break;
+        default:
+            rotateTileCounterClockwiseImpl<0>(src, srcHeight, srcStride, dst, dstStride, bytesPerPixel,
+                                              dstX0, dstY0, dstX1, dstY1);
+            break;
+    }
+}
+
+void rotateBandClockwise(const unsigned char* src, int srcWidth, int srcHeight, size_t srcStride,
+                         unsigned char* dst, size_t dstStride, int bytesPerPixel,
+                         int dstY0, int dstY1, int tileSize) {
+    tileSize = std::max(1, tileSize);
+    int dstWidth = srcHeight;
+    for (int ty = dstY0; ty < dstY1; ty += tileSize) {
+        int tyEnd = std::min(ty + tileSize, dstY1);
+        for (int tx = 0; tx < dstWidth; tx += tileSize) {
+            int txEnd = std::min(tx + tileSize, dstWidth);
+            rotateTileClockwise(src, srcWidth, srcHeight, srcStride, dst, dstStride, bytesPerPixel,
+                                tx, ty, txEnd, tyEnd);
+        }
+    }
+}
+
+void rotateBandCounterClockwise(const unsigned char* src, int srcWidth, int srcHeight, size_t srcStride,
+                                unsigned char* dst, size_t dstStride, int bytesPerPixel,
+                                int dstY0, int dstY1, int tileSize) {
+    tileSize = std::max(1, tileSize);
+    int dstWidth = srcHeight;
+    for (int ty = dstY0; ty < dstY1; ty += tileSize) {
+        int tyEnd = std::min(ty + tileSize, dstY1);
+        for (int tx = 0; tx < dstWidth; tx += tileSize) {
+            int txEnd = std::min(tx + tileSize, dstWidth);
+            rotateTileCounterClockwise(src, srcWidth, srcHeight, srcStride, dst, dstStride, bytesPerPixel,
+                                       tx, ty, txEnd, tyEnd);
+        }
+    }
+}
+
+namespace {
+
+// Source pixel of destination (x, y): the transform is affine, so a row of
+// destination pixels walks the source with one constant pointer step
+struct OrientationMap {
+    ptrdiff_t originX, originY;
+    ptrdiff_t stepXx, stepXy;    // source (x, y) change per destination x
+    ptrdiff_t stepYx, stepYy;    // source (x, y) change per destination y
+};
+
+OrientationMap orientationMap(const ImageDescriptor& dstDesc, const Orientation& orientation) {
+    auto sourceOf = [&](ptrdiff_t x, ptrdiff_t y) {
+        // Undo the quarter turns, then the mirror
+        ptrdiff_t w = dstDesc.width;
+        ptrdiff_t h = dstDesc.height;
+        for (int turn = 0; turn < orientation.quarterTurns; ++turn) {
+            ptrdiff_t previousX = h - 1 - y;
+            y = x;
+            x = previousX;
+            std::swap(w, h);
+        }
+        if (orientation.mirrored) {
+            x = w - 1 - x;
+        }
+        return std::make_pair(x, y);
+    };
+    auto origin = sourceOf(0, 0);
+    auto alongX = sourceOf(1, 0);
+    auto alongY = sourceOf(0, 1);
+    return {origin.first, origin.second,
+            alongX.first - origin.first, alongX.second - origin.second,
+            alongY.first - origin.first, alongY.second - origin.second};
+}
+
+template<int BytesPerPixel>
+void orientTileImpl(const unsigned char* src, size_t srcStride, unsigned char* dst, size_t dstStride,
+                    int bytesPerPixel, const OrientationMap& map, int dstX0, int dstY0, int dstX1, int dstY1) {
+    const ptrdiff_t b = bytesPerPixel;
+    const ptrdiff_t stride = static_cast<ptrdiff_t>(srcStride);
+    const ptrdiff_t step = map.stepXx * b + map.stepXy * stride;
+    for (int ny = dstY0; ny < dstY1; ++ny) {
+        ptrdiff_t sx = map.originX + map.stepXx * dstX0 + map.stepYx * ny;
+        ptrdiff_t sy = map.originY + map.stepXy * dstX0 + map.stepYy * ny;
+        const unsigned char* from = src + sy * stride + sx * b;
+        unsigned char* to = dst + static_cast<size_t>(ny) * dstStride + static_cast<size_t>(dstX0) * b;
+        for (int nx = dstX0; nx < dstX1; ++nx) {
+            copyPixel<BytesPerPixel>(to, from, bytesPerPixel);
+            to += b;
+            from += step;
+        }
+    }
+}
+
+} // namespace
+
+void orientBand(const unsigned char* src, const ImageDescriptor& srcDesc, unsigned char* dst,
+                const ImageDescriptor& dstDesc, const Orientation& orientation,
+                int dstY0, int dstY1, int tileSize) {
+    OrientationMap map = orientationMap(dstDesc, orientation);
+    int bytesPerPixel = srcDesc.bytesPerPixel();
+    // Row-preserving transforms read whole source rows; tiles only matter
+    // when destination rows walk source columns
+    tileSize = orientation.swapsAxes() ? std::max(1, tileSize) : std::max(1, dstDesc.width);
+    for (int ty = dstY0; ty < dstY1; ty += tileSize) {
+        int tyEnd = std::min(ty + tileSize, dstY1);
+        for (int tx = 0; tx < dstDesc.width; tx += tileSize) {
+            int txEnd = std::min(tx + tileSize, dstDesc.width);
+            switch (bytesPerPixel) {
+                case 3:
+                    orientTileImpl<3>(src, srcDesc.stride, dst, dstDesc.stride, bytesPerPixel, map,
+                                      tx, ty, txEnd, tyEnd);
+                    break;
+                case 4:
+                    orientTileImpl<4>(src, srcDesc.stride, dst, dstDesc.stride, bytesPerPixel, map,
+                                      tx, ty, txEnd, tyEnd);
+                    break;
+                default:
+                    orientTileImpl<0>(src, srcDesc.stride, dst, dstDesc.stride, bytesPerPixel, map,
+                                      tx, ty, txEnd, tyEnd);
+                    break;
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// In-place rotation
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// Clockwise, destination (r, c) comes from source (c, n - 1 - r); the four
+// pixels of one cycle are rotated through a single temporary.
+template<int BytesPerPixel>
+void rotateSquareRowsImpl(unsigned char* data, int size, size_t stride, int bytesPerPixel,
+                          bool clockwise, int row0, int row1, int tileSize) {
+    const size_t b = static_cast<size_t>(bytesPerPixel);
+    auto at = [&](int row, int col) {
+        return data + static_cast<size_t>(row) * stride + static_cast<size_t>(col) * b;
+    };
+    unsigned char temp[16];
+    int lastColumn = (size + 1) / 2;
+    for (int tc = 0; tc < lastColumn; tc += tileSize) {
+        int tcEnd = std::min(tc + tileSize, lastColumn);
+        for (int r = row0; r < row1; ++r) {
+            for (int c = tc; c < tcEnd; ++c) {
+                unsigned char* p0 = at(r, c);
+                unsigned char* p1 = at(c, size - 1 - r);
+                unsigned char* p2 = at(size - 1 - r, size - 1 - c);
+                unsigned char* p3 = at(size - 1 - c, r);
+                copyPixel<BytesPerPixel>(temp, p0, bytesPerPixel);
+                if (clockwise) {
+                    copyPixel<BytesPerPixel>(p0, p1, bytesPerPixel);
+                    copyPixel<BytesPerPixel>(p1, p2, bytesPerPixel);
+                    copyPixel<BytesPerPixel>(p2, p3, bytesPerPixel);
+                    copyPixel<BytesPerPixel>(p3, temp, bytesPerPixel);
+                } else {
+                    copyPixel<BytesPerPixel>(p0, p3, bytesPerPixel);
+                    copyPixel<BytesPerPixel>(p3, p2, bytesPerPixel);
+                    copyPixel<BytesPerPixel>(p2, p1, bytesPerPixel);
+                    copyPixel<BytesPerPixel>(p1, temp, bytesPerPixel);
+                }
+            }
+        }
+    }
+}
+
+// Pixel (r, c) of a rows x cols matrix sits at index i = r * cols + c and
+// belongs at c * rows + r. Modulo rows * cols - 1 that target is i * rows,
+// so the pixel pulled into index i comes from i * cols.
+template<int BytesPerPixel>
+void followTransposeCycleImpl(unsigned char* data, size_t modulus, size_t cols, int bytesPerPixel,
+                              size_t leader) {
+    const size_t b = static_cast<size_t>(bytesPerPixel);
+    unsigned char temp[16];
+    copyPixel<BytesPerPixel>(temp, data + leader * b, bytesPerPixel);
+    size_t index = leader;
+    for (;;) {
+        size_t next = index * cols % modulus;
+        if (next == leader) {
+            break;
+        }
+        copyPixel<BytesPerPixel>(data + index * b, data + next * b, bytesPerPixel);
+        index = next;
+    }
+    copyPixel<BytesPerPixel>(data + index * b, temp, bytesPerPixel);
+}
+
+} // namespace
+
+void rotateSquareRowsInPlace(unsigned char* data, int size, size_t stride, int bytesPerPixel,
+                             bool clockwise, int row0, int row1, int tileSize) {
+    if (bytesPerPixel > 16) {
+        throw std::invalid_argument("Unsupported pixel size for in-place rotation");
+    }
+    tileSize = std::max(1, tileSize);
+    switch (bytesPerPixel) {
+        case 3:
+            rotateSquareRowsImpl<3>(data, size, stride, bytesPerPixel, clockwise, row0, row1, tileSize);
+            break;
+        case 4:
+            rotateSquareRowsImpl<4>(data, size, stride, bytesPerPixel, clockwise, row0, row1, tileSize);
+            break;
+        default:
+            rotateSquareRowsImpl<0>(data, size, stride, bytesPerPixel, clockwise, row0, row1, tileSize);
+            break;
+    }
+}
+
+void packRows(unsigned char* data, const ImageDescriptor& desc) {
+    size_t rowBytes = static_cast<size_t>(desc.width) * desc.bytesPerPixel();
+    if (rowBytes == desc.stride) {
+        return;
+    }
+    for (int y = 1; y < desc.height; ++y) {
+        std::memmove(data + static_cast<size_t>(y) * rowBytes, data + static_cast<size_t>(y) * desc.stride,
+                     rowBytes);
+    }
+}
+
+void unpackRows(unsigned char* data, const ImageDescriptor& desc) {
+    size_t rowBytes = static_cast<size_t>(desc.width) * desc.bytesPerPixel();
+    if (rowBytes == desc.stride) {
+        return;
+    }
+    for (int y = desc.height - 1; y > 0; --y) {
+        std::memmove(data + static_cast<size_t>(y) * desc.stride, data + static_cast<size_t>(y) * rowBytes,
+                     rowBytes);
+    }
+    clearRowPadding(data, desc);
+}
+
+std::vector<std::pair<size_t, size_t>> transposeCycles(int rows, int cols) {
+    std::vector<std::pair<size_t, size_t>> cycles;
+    size_t count = static_cast<size_t>(rows) * static_cast<size_t>(cols);
+    if (rows <= 1 || cols <= 1) {
+        return cycles;   // a single row or column is its own transpose in memory
+    }
+    size_t modulus = count - 1;
+    std::vector<uint64_t> visited((count + 63) / 64, 0);
+    for (size_t start = 1; start < modulus; ++start) {
+        if (visited[start / 64] & (uint64_t(1) << (start % 64))) {
+            continue;
+        }
+        size_t length = 0;
+        size_t index = start;
+        do {
+            visited[index / 64] |= uint64_t(1) << (index % 64);
+            ++length;
+            index = index * static_cast<size_t>(cols) % modulus;
+        } while (index != start);
+        if (length > 1) {
+            cycles.emplace_back(start, length);
+        }
+    }
+    return cycles;
+}
+
+void followTransposeCycle(unsigned char* data, int rows, int cols, int bytesPerPixel, size_t leader) {
+    if (bytesPerPixel > 16) {
+        throw std::invalid_argument("Unsupported pixel size for in-place rotation");
+    }
+    size_t modulus = static_cast<size_t>(rows) * static_cast<size_t>(cols) - 1;
+    switch (bytesPerPixel) {
+        case 3:
+            followTransposeCycleImpl<3>(data, modulus, static_cast<size_t>(cols), bytesPerPixel, leader);
+            break;
+        case 4:
+            followTransposeCycleImpl<4>(data, modulus, static_cast<size_t>(cols), bytesPerPixel, leader);
+            break;
+        default:
+            followTransposeCycleImpl<0>(data, modulus, static_cast<size_t>(cols), bytesPerPixel, leader);
+            break;
+    }
+}
+
+void mirrorPackedRows(unsigned char* data, int rows, size_t rowBytes, int row0, int row1) {
+    for (int y = row0; y < row1; ++y) {
+        std::swap_ranges(data + static_cast<size_t>(y) * rowBytes, data + static_cast<size_t>(y + 1) * rowBytes,
+                         data + static_cast<size_t>(rows - 1 - y) * rowBytes);
+    }
+}
+
+void reversePackedPixels(unsigned char* data, int cols, int bytesPerPixel, int row0, int row1) {
+    const size_t b = static_cast<size_t>(bytesPerPixel);
+    size_t rowBytes = static_cast<size_t>(cols) * b;
+    for (int y = row0; y < row1; ++y) {
+        unsigned char* row = data + static_cast<size_t>(y) * rowBytes;
+        for (int left = 0, right = cols - 1; left < right; ++left, --right) {
+            std::swap_ranges(row + static_cast<size_t>(left) * b, row + static_cast<size_t>(left + 1) * b,
+                             row + static_cast<size_t>(right) * b);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 3x3 Gaussian
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// The 2D kernel {1,2,1; 2,4,2; 1,2,1} / 16 is the outer product of [1,2,1]
+// with itself, so it runs as a horizontal pass into 16-bit row sums followed
+// by a vertical pass. Sums never exceed 255 * 16 = 4080, and since the weights
+// are exact binary fractions the result equals the truncated float
+// convolution bit for bit.
+
+void horizontal121Scalar(const unsigned char* row, uint16_t* out, size_t begin, size_t end, int bytesPerPixel) {
+    const size_t b = static_cast<size_t>(bytesPerPixel);
+    for (size_t j = begin; j < end; ++j) {
+        out[j] = static_cast<uint16_t>(row[j - b] + 2u * row[j] + row[j + b]);
+    }
+}
+
+void vertical121Scalar(const uint16_t* above, const uint16_t* row, const uint16_t* below,
+                       unsigned char* out, size_t begin, size_t end) {
+    for (size_t j = begin; j < end; ++j) {
+        out[j] = static_cast<unsigned char>((above[j] + 2u * row[j] + below[j]) >> 4);
+    }
+}
+
+#ifdef IMAGEKERNELS_X86
+
+// unpack/pack pairs stay within 128-bit lanes, so byte order is preserved
+// on AVX2 and AVX-512 as well.
+
+__attribute__((target("sse2")))
+void horizontal121SSE2(const unsigned char* row, uint16_t* out, size_t begin, size_t end, int bytesPerPixel) {
+    const size_t b = static_cast<size_t>(bytesPerPixel);
+    const __m128i zero = _mm_setzero_si128();
+    size_t j = begin;
+    for (; j + 16 <= end; j += 16) {
+        __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + j - b));
+        __m128i center = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + j));
+        __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + j + b));
+        __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(left, zero), _mm_unpacklo_epi8(right, zero)),
+                                   _mm_slli_epi16(_mm_unpacklo_epi8(center, zero), 1));
+        __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(left, zero), _mm_unpackhi_epi8(right, zero)),
+                                   _mm_slli_epi16(_mm_unpackhi_epi8(center, zero), 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j + 8), hi);
+    }
+    horizontal121Scalar(row, out, j, end, bytesPerPixel);
+}
+
+__attribute__((target("sse2")))
+void vertical121SSE2(const uint16_t* above, const uint16_t* row, const uint16_t* below,
+                     unsigned char* out, size_t begin, size_t end) {
+    size_t j = begin;
+    for (; j + 16 <= end; j += 16) {
+        __m128i sum[2];
+        for (int half = 0; half < 2; ++half) {
+            size_t k = j + 8 * half;
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + k));
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + k));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + k));
+            sum[half] = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(a, d), _mm_slli_epi16(c, 1)), 4);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j), _mm_packus_epi16(sum[0], sum[1]));
+    }
+    vertical121Scalar(above, row, below, out, j, end);
+}
+
+__attribute__((target("avx2")))
+void horizontal121AVX2(const unsigned char* row, uint16_t* out, size_t begin, size_t end, int bytesPerPixel) {
+    const size_t b = static_cast<size_t>(bytesPerPixel);
+    size_t j = begin;
+    for (; j + 16 <= end; j += 16) {
+        // Zero-extend 16 bytes straight into one 256-bit register of 16-bit lanes
+        __m256i left = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + j - b)));
+        __m256i center = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + j)));
+        __m256i right = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + j + b)));
+        __m256i sum = _mm256_add_epi16(_mm256_add_epi16(left, right), _mm256_slli_epi16(center, 1));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j), sum);
+    }
+    horizontal121Scalar(row, out, j, end, bytesPerPixel);
+}
+
+__attribute__((target("avx2")))
+void vertical121AVX2(const uint16_t* above, const uint16_t* row, const uint16_t* below,
+                     unsigned char* out, size_t begin, size_t end) {
+    size_t j = begin;
+    for (; j + 32 <= end; j += 32) {
+        __m256i sum[2];
+        for (int half = 0; half < 2; ++half) {
+            size_t k = j + 16 * half;
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(above + k));
+            __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + k));
+            __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(below + k));
+            sum[half] = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(a, d), _mm256_slli_epi16(c, 1)), 4);
+        }
+        // packus interleaves 128-bit lanes; permute restores linear order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(sum[0], sum[1]), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j), packed);
+    }
+    vertical121SSE2(above, row, below, out, j, end);
+}
+
+__attribute__((target("avx512bw")))
+void horizontal121AVX512(const unsigned char* row, uint16_t* out, size_t begin, size_t end, int bytesPerPixel) {
+    const size_t b = static_cast<size_t>(bytesPerPixel);
+    size_t j = begin;
+    for (; j + 32 <= end; j += 32) {
+        __m512i left = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + j - b)));
+        __m512i center = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + j)));
+        __m512i right = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + j + b)));
+        __m512i sum = _mm512_add_epi16(_mm512_add_epi16(left, right), _mm512_slli_epi16(center, 1));
+        _mm512_storeu_si512(out + j, sum);
+    }
+    horizontal121AVX2(row, out, j, end, bytesPerPixel);
+}
+
+__attribute__((target("avx512bw")))
+void vertical121AVX512(const uint16_t* above, const uint16_t* row, const uint16_t* below,
+                       unsigned char* out, size_t begin, size_t end) {
+    const __m512i laneOrder = _mm512_set_epi64(7, 5, 3, 1, 6, 4, 2, 0);
+    size_t j = begin;
+    for (; j + 64 <= end; j += 64) {
+        __m512i sum[2];
+        for (int half = 0; half < 2; ++half) {
+            size_t k = j + 32 * half;
+            __m512i a = _mm512_loadu_si512(above + k);
+            __m512i c = _mm512_loadu_si512(row + k);
+            __m512i d = _mm512_loadu_si512(below + k);
+            sum[half] = _mm512_srli_epi16(_mm512_add_epi16(_mm512_add_epi16(a, d), _mm512_slli_epi16(c, 1)), 4);
+        }
+        __m512i packed = _mm512_maskz_permutexvar_epi64(0xFF, laneOrder, _mm512_packus_epi16(sum[0], sum[1]));
+        _mm512_storeu_si512(out + j, packed);
+    }
+    vertical121AVX2(above, row, below, out, j, end);
+}
+
+#endif // IMAGEKERNELS_X86
+
+std::atomic<int>& simdLevelOverride() {
+    static std::atomic<int> level{-1};
+    return level;
+}
+
+} // namespace
+
+SimdLevel detectSimdLevel() {
+#ifdef IMAGEKERNELS_X86
+    static const SimdLevel detected = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512bw")) return SimdLevel::AVX512;
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+        if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE2;
+        return SimdLevel::Scalar;
+    }();
+    return detected;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel activeSimdLevel() {
+    int forced = simdLevelOverride().load(std::memory_order_relaxed);
+    return forced < 0 ? detectSimdLevel() : static_cast<SimdLevel>(forced);
+}
+
+void setSimdLevel(SimdLevel level) {
+    level = std::min(level, detectSimdLevel());
+    simdLevelOverride().store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SSE2: return "sse2";
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::AVX512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+SimdLevel parseSimdLevel(const std::string& name) {
+    if (name == "scalar") return SimdLevel::Scalar;
+    if (name == "sse2") return SimdLevel::SSE2;
+    if (name == "avx2") return SimdLevel::AVX2;
+    if (name == "avx512") return SimdLevel::AVX512;
+    throw std::invalid_argument("Unknown SIMD level: " + name);
+}
+
+void gaussianHorizontal121(const unsigned char* row, uint16_t* out, size_t begin, size_t end, int bytesPerPixel) {
+    if (begin >= end) {
+        return;
+    }
+    switch (activeSimdLevel()) {
+#ifdef IMAGEKERNELS_X86
+        case SimdLevel::AVX512:
+            horizontal121AVX512(row, out, begin, end, bytesPerPixel);
+            break;
+        case SimdLevel::AVX2:
+            horizontal121AVX2(row, out, begin, end, bytesPerPixel);
+            break;
+        case SimdLevel::SSE2:
+            horizontal121SSE2(row, out, begin, end, bytesPerPixel);
+            break;
+#endif
+        default:
+            horizontal121Scalar(row, out, begin, end, bytesPerPixel);
+            break;
+    }
+}
+
+void gaussianVertical121(const uint16_t* above, const uint16_t* row, const uint16_t* below,
+                         unsigned char* out, size_t begin, size_t end) {
+    if (begin >= end) {
+        return;
+    }
+    switch (activeSimdLevel()) {
+#ifdef IMAGEKERNELS_X86
+        case SimdLevel::AVX512:
+            vertical121AVX512(above, row, below, out, begin, end);
+            break;
+        case SimdLevel::AVX2:
+            vertical121AVX2(above, row, below, out, begin, end);
+            break;
+        case SimdLevel::SSE2:
+            vertical121SSE2(above, row, below, out, begin, end);
+            break;
+#endif
+        default:
+            vertical121Scalar(above, row, below, out, begin, end);
+            break;
+    }
+}
+
+void captureGaussianHalo(const unsigned char* image, size_t stride, int width, int bytesPerPixel,
+                         int startY, int endY, GaussianStripHalo& halo) {
+    size_t firstByte = bytesPerPixel;
+    size_t lastByte = static_cast<size_t>(std::max(width - 1, 1)) * bytesPerPixel;
+    halo.above.assign(stride, 0);
+    halo.below.assign(stride, 0);
+    gaussianHorizontal121(image + static_cast<size_t>(startY - 1) * stride, halo.above.data(),
+                          firstByte, lastByte, bytesPerPixel);
+    gaussianHorizontal121(image + static_cast<size_t>(endY) * stride, halo.below.data(),
+                          firstByte, lastByte, bytesPerPixel);
+}
+
+void gaussianStrip3x3(const unsigned char* src, unsigned char* dst, size_t stride, int width, int bytesPerPixel,
+                      int startY, int endY, const GaussianStripHalo& halo) {
+    if (startY >= endY || width < 3) {
+        return;
+    }
+    size_t firstByte = bytesPerPixel;
+    size_t lastByte = static_cast<size_t>(width - 1) * bytesPerPixel;
+    
+    // Ring of three horizontal-sum rows: previous, current, next. Row y is
+    // summed before it is overwritten, so the strip also works with src == dst.
+    std::vector<uint16_t> ring(3 * stride, 0);
+    uint16_t* previous = ring.data();
+    uint16_t* current = ring.data() + stride;
+    uint16_t* next = ring.data() + 2 * stride;
+    
+    std::copy(halo.above.begin(), halo.above.end(), previous);
+    gaussianHorizontal121(src + static_cast<size_t>(startY) * stride, current, firstByte, lastByte, bytesPerPixel);
+    
+    for (int y = startY; y < endY; ++y) {
+        const uint16_t* below = halo.below.data();
+        if (y + 1 < endY) {
+            gaussianHorizontal121(src + static_cast<size_t>(y + 1) * stride, next, firstByte, lastByte, bytesPerPixel);
+            below = next;
+        }
+        unsigned char* out = dst + static_cast<size_t>(y) * stride;
+        gaussianVertical121(previous, current, below, out, firstByte, lastByte);
+        if (src != dst) {
+            // Border columns and row padding keep their source values
+            const unsigned char* in = src + static_cast<size_t>(y) * stride;
+            std::memcpy(out, in, firstByte);
+            std::memcpy(out + lastByte, in + lastByte, stride - lastByte);
+        }
+        
+        uint16_t* recycled = previous;
+        previous = current;
+        current = next;
+        next = recycled;
+    }
+}
+
+namespace {
+
+// Gather the rotated pixels of destination rectangle [x0, x1) x [y0, y1)
+// into a packed local buffer (row stride (x1 - x0) * bpp)
+template<int BytesPerPixel>
+void gatherRotated(const unsigned char* src, const ImageDescriptor& srcDesc, bool clockwise, int bytesPerPixel,
+                   int x0, int y0, int x1, int y1, unsigned char* local) {
+    const size_t localStride = static_cast<size_t>(x1 - x0) * bytesPerPixel;
+    for (int ny = y0; ny < y1; ++ny) {
+        unsigned char* out = local + static_cast<size_t>(ny - y0) * localStride;
+        if (clockwise) {
+            // (nx, ny) <- source (srcWidth - 1 - ny, nx)
+            const unsigned char* column = src + static_cast<size_t>(srcDesc.width - 1 - ny) * bytesPerPixel;
+            for (int nx = x0; nx < x1; ++nx) {
+                copyPixel<BytesPerPixel>(out + static_cast<size_t>(nx - x0) * bytesPerPixel,
+                                         column + static_cast<size_t>(nx) * srcDesc.stride, bytesPerPixel);
+            }
+        } else {
+            // (nx, ny) <- source (ny, srcHeight - 1 - nx)
+            const unsigned char* column = src + static_cast<size_t>(ny) * bytesPerPixel;
+            for (int nx = x0; nx < x1; ++nx) {
+                copyPixel<BytesPerPixel>(out + static_cast<size_t>(nx - x0) * bytesPerPixel,
+                                         column + static_cast<size_t>(srcDesc.height - 1 - nx) * srcDesc.stride,
+                                         bytesPerPixel);
+            }
+        }
+    }
+}
+
+} // namespace
+
+void rotateGaussianBand(const unsigned char* src, const ImageDescriptor& srcDesc, unsigned char* dst,
+                        bool clockwise, int dstY0, int dstY1, int tileSize) {
+    const ImageDescriptor dstDesc = rotatedDescriptor(srcDesc);
+    const int bpp = srcDesc.bytesPerPixel();
+    const int width = dstDesc.width;
+    const int height = dstDesc.height;
+    tileSize = std::max(1, tileSize);
+    
+    // One tile plus its one-pixel halo, reused for every tile of the band
+    const size_t maxLocalStride = static_cast<size_t>(tileSize + 2) * bpp;
+    std::vector<unsigned char> local(static_cast<size_t>(tileSize + 2) * maxLocalStride);
+    std::vector<uint16_t> sums(static_cast<size_t>(tileSize + 2) * maxLocalStride);
+    
+    for (int ty = dstY0; ty < dstY1; ty += tileSize) {
+        int tyEnd = std::min(ty + tileSize, dstY1);
+        int y0 = std::max(ty - 1, 0);
+        int y1 = std::min(tyEnd + 1, height);
+        for (int tx = 0; tx < width; tx += tileSize) {
+            int txEnd = std::min(tx + tileSize, width);
+            int x0 = std::max(tx - 1, 0);
+            int x1 = std::min(txEnd + 1, width);
+            const size_t localStride = static_cast<size_t>(x1 - x0) * bpp;
+            
+            switch (bpp) {
+                case 3: gatherRotated<3>(src, srcDesc, clockwise, bpp, x0, y0, x1, y1, local.data()); break;
+                case 4: gatherRotated<4>(src, srcDesc, clockwise, bpp, x0, y0, x1, y1, local.data()); break;
+                default: gatherRotated<0>(src, srcDesc, clockwise, bpp, x0, y0, x1, y1, local.data()); break;
+            }
+            auto localRow = [&](int y) { return local.data() + static_cast<size_t>(y - y0) * localStride; };
+            auto sumRow = [&](int y) { return sums.data() + static_cast<size_t>(y - y0) * localStride; };
+            
+            // Interior columns of this tile in local byte offsets; image border
+            // rows and columns keep their rotated source values
+            int filterX0 = std::max(tx, 1);
+            int filterX1 = std::min(txEnd, width - 1);
+            bool canFilter = width >= 3 && height >= 3 && filterX0 < filterX1;
+            size_t filterBegin = static_cast<size_t>(filterX0 - x0) * bpp;
+            size_t filterEnd = static_cast<size_t>(filterX1 - x0) * bpp;
+            if (canFilter) {
+                for (int y = y0; y < y1; ++y) {
+                    gaussianHorizontal121(localRow(y), sumRow(y), filterBegin, filterEnd, bpp);
+                }
+            }
+            
+            const size_t tileOffset = static_cast<size_t>(tx - x0) * bpp;
+            const size_t tileBytes = static_cast<size_t>(txEnd - tx) * bpp;
+            for (int y = ty; y < tyEnd; ++y) {
+                unsigned char* out = dst + static_cast<size_t>(y) * dstDesc.stride + static_cast<size_t>(x0) * bpp;
+                if (!canFilter || y == 0 || y == height - 1) {
+                    std::memcpy(out + tileOffset, localRow(y) + tileOffset, tileBytes);
+                    continue;
+                }
+                gaussianVertical121(sumRow(y - 1), sumRow(y), sumRow(y + 1), out, filterBegin, filterEnd);
+                if (tx == 0) {
+                    std::memcpy(out, localRow(y), bpp);
+                }
+                if (txEnd == width) {
+                    size_t last = static_cast<size_t>(width - 1 - x0) * bpp;
+                    std::memcpy(out + last, localRow(y) + last, bpp);
+                }
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Configurable-radius Gaussian
+// ---------------------------------------------------------------------------
+
+namespace {
+
+constexpr int WEIGHT_BITS = 14;
+constexpr int HORIZONTAL_SHIFT = 6;  // keeps 8 fractional bits, max 255 << 8 fits 16 bits
+constexpr int VERTICAL_SHIFT = 2 * WEIGHT_BITS - HORIZONTAL_SHIFT;
+
+inline int clampIndex(int value, int limit) {
+    return value < 0 ? 0 : (value >= limit ? limit - 1 : value);
+}
+
+// R > 0 is a compile-time radius (fully unrolled taps), R == 0 reads it at runtime
+template<int R>
+void horizontalRadius(const unsigned char* row, uint16_t* out, int width, int bytesPerPixel,
+                      const uint32_t* weights, int runtimeRadius) {
+    const int r = R > 0 ? R : runtimeRadius;
+    const size_t b = static_cast<size_t>(bytesPerPixel);
+    const uint32_t rounding = 1u << (HORIZONTAL_SHIFT - 1);
+    
+    auto edgePixel = [&](int x) {
+        for (size_t c = 0; c < b; ++c) {
+            uint32_t acc = rounding;
+            for (int k = -r; k <= r; ++k) {
+                acc += weights[k + r] * row[static_cast<size_t>(clampIndex(x + k, width)) * b + c];
+            }
+            out[static_cast<size_t>(x) * b + c] = static_cast<uint16_t>(acc >> HORIZONTAL_SHIFT);
+        }
+    };
+    
+    int interiorBegin = std::min(r, width);
+    int interiorEnd = std::max(interiorBegin, width - r);
+    for (int x = 0; x < interiorBegin; ++x) {
+        edgePixel(x);
+    }
+    for (size_t j = static_cast<size_t>(interiorBegin) * b; j < static_cast<size_t>(interiorEnd) * b; ++j) {
+        uint32_t acc = rounding;
+        for (int k = -r; k <= r; ++k) {
+            acc += weights[k + r] * row[j + static_cast<ptrdiff_t>(k) * static_cast<ptrdiff_t>(b)];
+        }
+        out[j] = static_cast<uint16_t>(acc >> HORIZONTAL_SHIFT);
+    }
+    for (int x = interiorEnd; x < width; ++x) {
+        edgePixel(x);
+    }
+}
+
+template<int R>
+void verticalRadius(const uint16_t* const* rows, unsigned char* out, size_t count,
+                    const uint32_t* weights, int runtimeRadius) {
+    const int taps = 2 * (R > 0 ? R : runtimeRadius) + 1;
+    const uint32_t rounding = 1u << (VERTICAL_SHIFT - 1);
+    for (size_t j = 0; j < count; ++j) {
+        uint32_t acc = rounding;
+        for (int k = 0; k < taps; ++k) {
+            acc += weights[k] * rows[k][j];
+        }
+        out[j] = static_cast<unsigned char>(acc >> VERTICAL_SHIFT);
+    }
+}
+
+void horizontalRadiusDispatch(int radius, const unsigned char* row, uint16_t* out, int width,
+                              int bytesPerPixel, const uint32_t* weights) {
+    switch (radius) {
+        case 1: horizontalRadius<1>(row, out, width, bytesPerPixel, weights, radius); break;
+        case 2: horizontalRadius<2>(row, out, width, bytesPerPixel, weights, radius); break;
+        case 3: horizontalRadius<3>(row, out, width, bytesPerPixel, weights, radius); break;
+        case 4: horizontalRadius<4>(row, out, width, bytesPerPixel, weights, radius); break;
+        case 5: horizontalRadius<5>(row, out, width, bytesPerPixel, weights, radius); break;
+        case 7: horizontalRadius<7>(row, out, width, bytesPerPixel, weights, radius); break;
+        default: horizontalRadius<0>(row, out, width, bytesPerPixel, weights, radius); break;
+    }
+}
+
+void verticalRadiusDispatch(int radius, const uint16_t* const* rows, unsigned char* out, size_t count,
+                            const uint32_t* weights) {
+    switch (radius) {
+        case 1: verticalRadius<1>(rows, out, count, weights, radius); break;
+        case 2: verticalRadius<2>(rows, out, count, weights, radius); break;
+        case 3: verticalRadius<3>(rows, out, count, weights, radius); break;
+        case 4: verticalRadius<4>(rows, out, count, weights, radius); break;
+        case 5: verticalRadius<5>(rows, out, count, weights, radius); break;
+        case 7: verticalRadius<7>(rows, out, count, weights, radius); break;
+        default: verticalRadius<0>(rows, out, count, weights, radius); break;
+    }
+}
+
+// Box sizes whose triple convolution approximates a Gaussian of the given sigma
+void boxRadiiForSigma(double sigma, int radii[3]) {
+    const int passes = 3;
+    double idealWidth = std::sqrt(12.0 * sigma * sigma / passes + 1.0);
+    int lower = static_cast<int>(std::floor(idealWidth));
+    if (lower % 2 == 0) --lower;
+    int upper = lower + 2;
+    double idealCount = (12.0 * sigma * sigma - passes * lower * lower - 4.0 * passes * lower - 3.0 * passes)
+                        / (-4.0 * lower - 4.0);
+    int lowerCount = static_cast<int>(std::lround(idealCount));
+    for (int i = 0; i < passes; ++i) {
+        radii[i] = ((i < lowerCount ? lower : upper) - 1) / 2;
+    }
+}
+
+} // namespace
+
+GaussianPlan planGaussian(int radius, double sigma) {
+    if (radius <= 0 && sigma <= 0.0) {
+        throw std::invalid_argument("Gaussian blur needs a radius or a sigma");
+    }
+    if (radius <= 0) {
+        radius = std::min(MAX_GAUSSIAN_RADIUS, std::max(1, static_cast<int>(std::ceil(3.0 * sigma))));
+    }
+    if (radius > MAX_GAUSSIAN_RADIUS) {
+        throw std::invalid_argument("Gaussian radius must be between 1 and " + std::to_string(MAX_GAUSSIAN_RADIUS));
+    }
+    if (sigma <= 0.0) {
+        sigma = 0.3 * (radius - 1) + 0.8;
+    }
+    
+    GaussianPlan plan;
+    plan.radius = radius;
+    plan.sigma = sigma;
+    plan.useBoxBlur = sigma > BOX_BLUR_SIGMA_THRESHOLD;
+    boxRadiiForSigma(sigma, plan.boxRadii);
+    
+    std::vector<double> exact(2 * radius + 1);
+    double total = 0.0;
+    for (int k = -radius; k <= radius; ++k) {
+        exact[k + radius] = std::exp(-(k * k) / (2.0 * sigma * sigma));
+        total += exact[k + radius];
+    }
+    plan.weights.resize(exact.size());
+    int64_t quantizedTotal = 0;
+    for (size_t i = 0; i < exact.size(); ++i) {
+        plan.weights[i] = static_cast<uint32_t>(std::lround(exact[i] / total * (1 << WEIGHT_BITS)));
+        quantizedTotal += plan.weights[i];
+    }
+    // Put the rounding error on the centre tap so the weights sum to exactly 1.0
+    plan.weights[radius] = static_cast<uint32_t>(plan.weights[radius] + ((1 << WEIGHT_BITS) - quantizedTotal));
+    return plan;
+}
+
+void captureRadiusHalo(const GaussianPlan& plan, const unsigned char* image, size_t stride,
+                       int width, int height, int bytesPerPixel,
+                       int startY, int endY, GaussianRadiusHalo& halo) {
+    const int r = plan.radius;
+    halo.above.assign(static_cast<size_t>(r) * stride, 0);
+    halo.below.assign(static_cast<size_t>(r) * stride, 0);
+    for (int i = 0; i < r; ++i) {
+        int aboveRow = clampIndex(startY - r + i, height);
+        int belowRow = clampIndex(endY + i, height);
+        horizontalRadiusDispatch(r, image + static_cast<size_t>(aboveRow) * stride,
+                                 halo.above.data() + static_cast<size_t>(i) * stride,
+                                 width, bytesPerPixel, plan.weights.data());
+        horizontalRadiusDispatch(r, image + static_cast<size_t>(belowRow) * stride,
+                                 halo.below.data() + static_cast<size_t>(i) * stride,
+                                 width, bytesPerPixel, plan.weights.data());
+    }
+}
+
+void gaussianStripRadius(const GaussianPlan& plan, const unsigned char* src, unsigned char* dst, size_t stride,
+                         int width, int /* height */, int bytesPerPixel,
+                         int startY, int endY, const GaussianRadiusHalo& halo) {
+    if (startY >= endY) {
+        return;
+    }
+    const int r = plan.radius;
+    const int taps = 2 * r + 1;
+    const size_t rowBytes = static_cast<size_t>(width) * bytesPerPixel;
+    
+    // Slot (y - startY) % taps holds the horizontal sums of strip row y. A slot
+    // is refilled only after the row it held has dropped out of the window.
+    std::vector<uint16_t> ring(static_cast<size_t>(taps) * stride, 0);
+    auto slot = [&](int y) { return ring.data() + static_cast<size_t>((y - startY) % taps) * stride; };
+    auto sumRow = [&](int y) {
+        horizontalRadiusDispatch(r, src + static_cast<size_t>(y) * stride, slot(y),
+                                 width, bytesPerPixel, plan.weights.data());
+    };
+    
+    for (int y = startY; y < std::min(startY + r, endY); ++y) {
+        sumRow(y);
+    }
+    
+    std::vector<const uint16_t*> window(taps);
+    for (int y = startY; y < endY; ++y) {
+        if (y + r < endY) {
+            sumRow(y + r);
+        }
+        for (int k = -r; k <= r; ++k) {
+            int source = y + k;
+            if (source < startY) {
+                window[k + r] = halo.above.data() + static_cast<size_t>(source - (startY - r)) * stride;
+            } else if (source >= endY) {
+                window[k + r] = halo.below.data() + static_cast<size_t>(source - endY) * stride;
+            } else {
+                window[k + r] = slot(source);
+            }
+        }
+        verticalRadiusDispatch(r, window.data(), dst + static_cast<size_t>(y) * stride, rowBytes,
+                               plan.weights.data());
+        if (src != dst) {
+            std::memcpy(dst + static_cast<size_t>(y) * stride + rowBytes,
+                        src + static_cast<size_t>(y) * stride + rowBytes, stride - rowBytes);
+        }
+    }
+}
+
+void boxBlurRows(const unsigned char* src, unsigned char* dst, size_t stride, int width, int bytesPerPixel,
+                 int startY, int endY, int radius) {
+    const size_t b = static_cast<size_t>(bytesPerPixel);
+    const uint32_t diameter = 2u * radius + 1u;
+    const size_t rowBytes = static_cast<size_t>(width) * b;
+    std::vector<unsigned char> original(rowBytes);
+    for (int y = startY; y < endY; ++y) {
+        const unsigned char* in = src + static_cast<size_t>(y) * stride;
+        unsigned char* row = dst + static_cast<size_t>(y) * stride;
+        std::copy(in, in + rowBytes, original.begin());
+        if (src != dst) {
+            std::memcpy(row + rowBytes, in + rowBytes, stride - rowBytes);
+        }
+        for (size_t c = 0; c < b; ++c) {
+            auto pixel = [&](int x) { return original[static_cast<size_t>(clampIndex(x, width)) * b + c]; };
+            uint32_t sum = 0;
+            for (int k = -radius; k <= radius; ++k) {
+                sum += pixel(k);
+            }
+            for (int x = 0; x < width; ++x) {
+                row[static_cast<size_t>(x) * b + c] = static_cast<unsigned char>((sum + diameter / 2) / diameter);
+                sum += pixel(x + radius + 1);
+                sum -= pixel(x - radius);
+            }
+        }
+    }
+}
+
+void boxBlurColumns(unsigned char* image, size_t stride, int height,
+                    size_t startByte, size_t endByte, int radius) {
+    const uint32_t diameter = 2u * radius + 1u;
+    // Work on cache-line wide column blocks copied out contiguously
+    const size_t blockBytes = 64;
+    std::vector<unsigned char> block(static_cast<size_t>(height) * blockBytes);
+    std::vector<uint32_t> sums(blockBytes);
+    for (size_t first = startByte; first < endByte; first += blockBytes) {
+        size_t count = std::min(blockBytes, endByte - first);
+        for (int y = 0; y < height; ++y) {
+            std::copy(image + static_cast<size_t>(y) * stride + first,
+                      image + static_cast<size_t>(y) * stride + first + count,
+                      block.begin() + static_cast<size_t>(y) * blockBytes);
+        }
+        auto value = [&](int y, size_t j) { return block[static_cast<size_t>(clampIndex(y, height)) * blockBytes + j]; };
+        for (size_t j = 0; j < count; ++j) {
+            sums[j] = 0;
+            for (int k = -radius; k <= radius; ++k) {
+                sums[j] += value(k, j);
+            }
+        }
+        for (int y = 0; y < height; ++y) {
+            unsigned char* row = image + static_cast<size_t>(y) * stride + first;
+            for (size_t j = 0; j < count; ++j) {
+                row[j] = static_cast<unsigned char>((sums[j] + diameter / 2) / diameter);
+                sums[j] += value(y + radius + 1, j);
+                sums[j] -= value(y - radius, j);
+            }
+        }
+    }
+}
+
+} // namespace ImageKernels
@@ -0,0 +1,246 @@
+/*
+   Low-level Image Kernels (tiled rotation, separable SIMD Gaussian)
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef IMAGEKERNELS_H
+#define IMAGEKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ImageKernels {
+
+// Geometry of a bottom-up BMP pixel array
+struct ImageDescriptor {
+    int width;
+    int height;
+    size_t stride;        // bytes per row including padding
+    int bitsPerPixel;
+
+    int bytesPerPixel() const { return bitsPerPixel / 8; }
+    size_t dataSize() const { return stride * static_cast<size_t>(height); }
+};
+
+// BMP row stride: width * bytesPerPixel rounded up to a multiple of 4
+size_t bmpRowStride(int width, int bitsPerPixel);
+
+ImageDescriptor makeDescriptor(int width, int height, int bitsPerPixel);
+
+// Geometry after a 90-degree rotation (width and height swapped, new stride)
+ImageDescriptor rotatedDescriptor(const ImageDescriptor& desc);
+
+// Element of the symmetry group of the pixel grid (rotations by quarter
+// turns and mirrors): an optional horizontal mirror (x -> width - 1 - x)
+// followed by clockwise quarter turns. Transforms compose here without
+// touching pixels; orientBand applies the result in one pass.
+struct Orientation {
+    int quarterTurns = 0;   // 0..3 clockwise
+    bool mirrored = false;
+
+    static Orientation identity() { return {0, false}; }
+    static Orientation clockwise() { return {1, false}; }
+    static Orientation halfTurn() { return {2, false}; }
+    static Orientation counterClockwise() { return {3, false}; }
+    static Orientation mirrorHorizontal() { return {0, true}; }
+    static Orientation mirrorVertical() { return {2, true}; }
+
+    bool isIdentity() const { return quarterTurns == 0 && !mirrored; }
+    // Width and height trade places (odd number of quarter turns)
+    bool swapsAxes() const { return quarterTurns % 2 != 0; }
+    // This transform followed by next
+    Orientation then(const Orientation& next) const;
+    bool operator==(const Orientation& other) const {
+        return quarterTurns == other.quarterTurns && mirrored == other.mirrored;
+    }
+    bool operator!=(const Orientation& other) const { return !(*this == other); }
+};
+
+const char* orientationName(const Orientation& orientation);
+
+// Geometry of desc after orientation (new stride when the axes swap)
+ImageDescriptor orientedDescriptor(const ImageDescriptor& desc, const Orientation& orientation);
+
+// Zero the padding bytes at the end of every row. Kernels writing into
+// uninitialized (pooled) buffers only touch pixel bytes.
+void clearRowPadding(unsigned char* data, const ImageDescriptor& desc);
+
+// Patch file size, pixel offset, dimensions, image size and compression (0)
+// of 14 + 40 byte BMP headers. Size fields are 32-bit: files up to 4 GB get
+// exact values, larger ones store 0, which readers accept for BI_RGB.
+void writeBmpGeometry(unsigned char* fileHeader, unsigned char* infoHeader,
+                      const ImageDescriptor& desc, size_t paletteSize);
+
+// Default edge of a square rotation tile in pixels (64x64x4 bytes = 16 KB per side)
+constexpr int DEFAULT_TILE_SIZE = 64;
+
+// Rotate the destination rectangle [dstX0, dstX1) x [dstY0, dstY1) of a
+// 90-degree clockwise rotation. srcWidth/srcHeight are the source
+// dimensions; the destination is srcHeight pixels wide and srcWidth high.
+// Only pixel bytes are written, row padding is left untouched.
+void rotateTileClockwise(const unsigned char* src, int srcWidth, int srcHeight, size_t srcStride,
+                         unsigned char* dst, size_t dstStride, int bytesPerPixel,
+                         int dstX0, int dstY0, int dstX1, int dstY1);
+
+// Counter-clockwise counterpart of rotateTileClockwise
+void rotateTileCounterClockwise(const unsigned char* src, int srcWidth, int srcHeight, size_t srcStride,
+                                unsigned char* dst, size_t dstStride, int bytesPerPixel,
+                                int dstX0, int dstY0, int dstX1, int dstY1);
+
+// Rotate destination rows [dstY0, dstY1) tile by tile. Callers split work
+// by destination row bands so every thread owns the cache lines it writes.
+void rotateBandClockwise(const unsigned char* src, int srcWidth, int srcHeight, size_t srcStride,
+                         unsigned char* dst, size_t dstStride, int bytesPerPixel,
+                         int dstY0, int dstY1, int tileSize);
+
+void rotateBandCounterClockwise(const unsigned char* src, int srcWidth, int srcHeight, size_t srcStride,
+                                unsigned char* dst, size_t dstStride, int bytesPerPixel,
+                                int dstY0, int dstY1, int tileSize);
+
+// Write destination rows [dstY0, dstY1) of src transformed by orientation,
+// tile by tile (dstDesc = orientedDescriptor(srcDesc, orientation)). Only
+// pixel bytes are written; bands are independent.
+void orientBand(const unsigned char* src, const ImageDescriptor& srcDesc, unsigned char* dst,
+                const ImageDescriptor& dstDesc, const Orientation& orientation,
+                int dstY0, int dstY1, int tileSize);
+
+// In-place 90-degree rotation building blocks. Square images rotate by
+// 4-pixel cycles; rectangles are packed (padding dropped), transposed by
+// cycle following, mirrored and unpacked again with the new row stride.
+
+// Rotate the 4-pixel cycles that start in rows [row0, row1) of the top half
+// of a size x size image, tileSize columns at a time. Cycles never overlap,
+// so threads may take disjoint row ranges of [0, size / 2).
+void rotateSquareRowsInPlace(unsigned char* data, int size, size_t stride, int bytesPerPixel,
+                             bool clockwise, int row0, int row1, int tileSize);
+
+// Move rows to width * bytesPerPixel apart (first row first) or back to
+// desc.stride apart (last row first, padding zeroed)
+void packRows(unsigned char* data, const ImageDescriptor& desc);
+void unpackRows(unsigned char* data, const ImageDescriptor& desc);
+
+// Permutation cycles of transposing a packed rows x cols pixel matrix as
+// (leader, length) pairs; fixed points are skipped. Uses one bit per pixel.
+std::vector<std::pair<size_t, size_t>> transposeCycles(int rows, int cols);
+
+// Move every pixel of the cycle starting at leader to its transposed position.
+// Distinct cycles touch distinct pixels, so they can run concurrently.
+void followTransposeCycle(unsigned char* data, int rows, int cols, int bytesPerPixel, size_t leader);
+
+// Swap packed rows [row0, row1) of the top half with their mirror rows
+void mirrorPackedRows(unsigned char* data, int rows, size_t rowBytes, int row0, int row1);
+
+// Reverse the pixel order inside packed rows [row0, row1)
+void reversePackedPixels(unsigned char* data, int cols, int bytesPerPixel, int row0, int row1);
+
+// Instruction sets the Gaussian kernel can dispatch to
+enum class SimdLevel {
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512
+};
+
+// Best level supported by the running CPU
+SimdLevel detectSimdLevel();
+
+// Level currently used by the kernels (detected once, can be lowered for testing)
+SimdLevel activeSimdLevel();
+
+// Force a level; requests above detectSimdLevel() are clamped to it
+void setSimdLevel(SimdLevel level);
+
+const char* simdLevelName(SimdLevel level);
+
+// Parse "scalar", "sse2", "avx2" or "avx512"; throws std::invalid_argument otherwise
+SimdLevel parseSimdLevel(const std::string& name);
+
+// Separable 3x3 Gaussian {1,2,1; 2,4,2; 1,2,1} / 16 in exact integer
+// arithmetic. Results equal the truncated float convolution bit for bit.
+
+// Horizontal pass: out[j] = row[j - bpp] + 2 * row[j] + row[j + bpp] for j in [begin, end)
+void gaussianHorizontal121(const unsigned char* row, uint16_t* out, size_t begin, size_t end, int bytesPerPixel);
+
+// Vertical pass: out[j] = (above[j] + 2 * row[j] + below[j]) >> 4 for j in [begin, end)
+void gaussianVertical121(const uint16_t* above, const uint16_t* row, const uint16_t* below,
+                         unsigned char* out, size_t begin, size_t end);
+
+// Horizontal sums of the rows just outside a strip, taken from the
+// unfiltered image before any strip starts writing
+struct GaussianStripHalo {
+    std::vector<uint16_t> above;
+    std::vector<uint16_t> below;
+};
+
+void captureGaussianHalo(const unsigned char* image, size_t stride, int width, int bytesPerPixel,
+                         int startY, int endY, GaussianStripHalo& halo);
+
+// Filter rows [startY, endY) of src into dst through a three-row ring
+// buffer; src == dst filters in place. Border columns keep their source
+// values. Strips only read their own rows plus the captured halo, so
+// disjoint strips run concurrently without locks.
+void gaussianStrip3x3(const unsigned char* src, unsigned char* dst, size_t stride, int width, int bytesPerPixel,
+                      int startY, int endY, const GaussianStripHalo& halo);
+
+// Fused 90-degree rotation and 3x3 Gaussian: destination rows [dstY0, dstY1)
+// of blur(rotate(src)) are produced tile by tile from a rotated tile plus
+// halo gathered into a local buffer, so no rotated image is materialized.
+// Output equals rotateBand* followed by gaussianStrip3x3 byte for byte;
+// row padding of dst is left untouched.
+void rotateGaussianBand(const unsigned char* src, const ImageDescriptor& srcDesc, unsigned char* dst,
+                        bool clockwise, int dstY0, int dstY1, int tileSize);
+
+// Gaussian blur with configurable radius/sigma. Unlike the classic 3x3
+// filter above, every pixel is filtered and the image edge is replicated.
+constexpr int MAX_GAUSSIAN_RADIUS = 15;
+
+// Above this sigma the direct convolution is replaced by three box blurs,
+// whose cost per pixel does not depend on the radius
+constexpr double BOX_BLUR_SIGMA_THRESHOLD = 4.0;
+
+struct GaussianPlan {
+    int radius;                      // half width of the direct kernel
+    double sigma;
+    bool useBoxBlur;                 // O(1) per pixel approximation
+    std::vector<uint32_t> weights;   // 2 * radius + 1 taps, fixed point, sum = 1 << 14
+    int boxRadii[3];                 // per-pass box half widths when useBoxBlur
+};
+
+// radius <= 0 derives it from sigma (ceil(3 sigma)); sigma <= 0 derives it
+// from the radius the way OpenCV does. Throws std::invalid_argument if the
+// radius is outside [1, MAX_GAUSSIAN_RADIUS].
+GaussianPlan planGaussian(int radius, double sigma);
+
+// Horizontal sums of the radius rows above and below a strip (edge-clamped),
+// captured from the unfiltered image before any strip writes
+struct GaussianRadiusHalo {
+    std::vector<uint16_t> above;     // radius rows
+    std::vector<uint16_t> below;     // radius rows
+};
+
+void captureRadiusHalo(const GaussianPlan& plan, const unsigned char* image, size_t stride,
+                       int width, int height, int bytesPerPixel,
+                       int startY, int endY, GaussianRadiusHalo& halo);
+
+// Direct separable convolution of rows [startY, endY) from src into dst
+// (src == dst allowed) through a ring buffer of 2 * radius + 1 horizontal-sum rows
+void gaussianStripRadius(const GaussianPlan& plan, const unsigned char* src, unsigned char* dst, size_t stride,
+                         int width, int height, int bytesPerPixel,
+                         int startY, int endY, const GaussianRadiusHalo& halo);
+
+// Running-sum box blur of rows [startY, endY) along x (src == dst allowed)
+void boxBlurRows(const unsigned char* src, unsigned char* dst, size_t stride, int width, int bytesPerPixel,
+                 int startY, int endY, int radius);
+
+// Running-sum box blur of byte columns [startByte, endByte) along y
+void boxBlurColumns(unsigned char* image, size_t stride, int height,
+                    size_t startByte, size_t endByte, int radius);
+
+} // namespace ImageKernels
+
+#endif // IMAGEKERNELS_H
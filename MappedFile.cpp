@@ -0,0 +1,88 @@
+/*
+   Read-only Memory-Mapped File Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "MappedFile.h"
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& filename)
+    : mappedData(nullptr), mappedSize(0), path(filename), writable(false) {
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file: " + filename);
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat file: " + filename);
+    }
+    if (info.st_size <= 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot map empty file: " + filename);
+    }
+
+    mappedSize = static_cast<size_t>(info.st_size);
+    void* address = ::mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("Cannot map file " + filename + ": " + std::strerror(errno));
+    }
+
+    mappedData = static_cast<unsigned char*>(address);
+    ::madvise(mappedData, mappedSize, MADV_WILLNEED);
+}
+
+MappedFile::MappedFile(const std::string& filename, size_t size)
+    : mappedData(nullptr), mappedSize(size), path(filename), writable(true) {
+    if (size == 0) {
+        throw std::runtime_error("Cannot map empty file: " + filename);
+    }
+    int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create file: " + filename);
+    }
+
+    // Reserve the blocks now: running out of space later would fault a
+    // store into the mapping (SIGBUS) instead of failing a call
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Cannot size file " + filename + ": " + std::strerror(error));
+    }
+    int error = ::posix_fallocate(fd, 0, static_cast<off_t>(size));
+    if (error != 0 && error != EOPNOTSUPP && error != EINVAL) {
+        ::close(fd);
+        throw std::runtime_error("Cannot allocate file " + filename + ": " + std::strerror(error));
+    }
+
+    void* address = ::mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("Cannot map file " + filename + ": " + std::strerror(errno));
+    }
+    mappedData = static_cast<unsigned char*>(address);
+}
+
+unsigned char* MappedFile::writableData() {
+    if (!writable) {
+        throw std::runtime_error("File is mapped read-only: " + path);
+    }
+    return mappedData;
+}
+
+MappedFile::~MappedFile() {
+    if (mappedData != nullptr) {
+        ::munmap(mappedData, mappedSize);
+    }
+}
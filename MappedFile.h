@@ -0,0 +1,47 @@
+/*
+   Read-only Memory-Mapped File
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>
+
+// RAII wrapper around a POSIX mmap of a whole file. The mapping stays
+// valid for the lifetime of the object; pages are faulted in lazily by
+// whichever thread touches them first. Input files are mapped read-only;
+// output files are created at their final size and mapped shared, so
+// kernels can store results straight into the file's page cache.
+class MappedFile {
+private:
+    unsigned char* mappedData;
+    size_t mappedSize;
+    std::string path;
+    bool writable;
+
+public:
+    // Map an existing file read-only
+    explicit MappedFile(const std::string& filename);
+    // Create (or truncate) filename with size bytes of disk space reserved
+    // and map it read-write. The contents start zero-filled.
+    MappedFile(const std::string& filename, size_t size);
+    ~MappedFile();
+
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+    MappedFile(MappedFile&& other) = delete;
+    MappedFile& operator=(MappedFile&& other) = delete;
+
+    const unsigned char* data() const { return mappedData; }
+    // Throws std::runtime_error for read-only mappings
+    unsigned char* writableData();
+    bool isWritable() const { return writable; }
+    size_t size() const { return mappedSize; }
+    const std::string& getPath() const { return path; }
+};
+
+#endif // MAPPEDFILE_H
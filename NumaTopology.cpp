@@ -0,0 +1,142 @@
+/*
+   NUMA Topology Discovery Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "NumaTopology.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <sched.h>
+
+namespace {
+
+// CPUs in this process's affinity mask (every hardware thread if unknown)
+std::vector<int> allowedCpus() {
+    std::vector<int> cpus;
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &mask)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    if (cpus.empty()) {
+        int count = std::max(1u, std::thread::hardware_concurrency());
+        for (int cpu = 0; cpu < count; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+} // namespace
+
+NumaTopology NumaTopology::discover(const std::string& root) {
+    NumaTopology topology;
+    std::vector<int> allowed = allowedCpus();
+
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(root, error)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+            !std::all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            continue;
+        }
+        std::ifstream file(entry.path() / "cpulist");
+        std::string list;
+        if (!std::getline(file, list)) {
+            continue;
+        }
+        Node node{std::stoi(name.substr(4)), {}};
+        for (int cpu : parseCpuList(list)) {
+            if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+                node.cpus.push_back(cpu);
+            }
+        }
+        // Memory-only nodes and nodes outside the affinity mask get no workers
+        if (!node.cpus.empty()) {
+            topology.nodeList.push_back(std::move(node));
+        }
+    }
+
+    if (topology.nodeList.empty()) {
+        topology.nodeList.push_back(Node{0, allowed});
+    }
+    std::sort(topology.nodeList.begin(), topology.nodeList.end(),
+              [](const Node& a, const Node& b) { return a.id < b.id; });
+    return topology;
+}
+
+size_t NumaTopology::cpuCount() const {
+    size_t count = 0;
+    for (const auto& node : nodeList) {
+        count += node.cpus.size();
+    }
+    return count;
+}
+
+std::vector<int> NumaTopology::cpuOrder(Placement placement) const {
+    std::vector<int> order;
+    if (placement == Placement::Compact) {
+        for (const auto& node : nodeList) {
+            order.insert(order.end(), node.cpus.begin(), node.cpus.end());
+        }
+    } else if (placement == Placement::Spread) {
+        // Round-robin over nodes: worker i lands on node i % nodes
+        for (size_t index = 0; order.size() < cpuCount(); ++index) {
+            for (const auto& node : nodeList) {
+                if (index < node.cpus.size()) {
+                    order.push_back(node.cpus[index]);
+                }
+            }
+        }
+    }
+    return order;
+}
+
+std::vector<int> NumaTopology::parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::istringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (item.empty() || item == "\n") {
+            continue;
+        }
+        size_t dash = item.find('-');
+        try {
+            int first = std::stoi(item.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (const std::logic_error&) {
+            throw std::invalid_argument("Malformed CPU list: " + list);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+NumaTopology::Placement NumaTopology::parsePlacement(const std::string& name) {
+    if (name == "none") return Placement::None;
+    if (name == "compact") return Placement::Compact;
+    if (name == "spread") return Placement::Spread;
+    throw std::invalid_argument("Unknown placement: " + name + " (expected none, compact or spread)");
+}
+
+const char* NumaTopology::placementName(Placement placement) {
+    switch (placement) {
+        case Placement::Compact: return "compact";
+        case Placement::Spread: return "spread";
+        default: return "none";
+    }
+}
@@ -0,0 +1,48 @@
+/*
+   NUMA Topology Discovery
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef NUMATOPOLOGY_H
+#define NUMATOPOLOGY_H
+
+#include <string>
+#include <vector>
+
+// CPUs of each NUMA node, read from /sys/devices/system/node. Only CPUs
+// this process may run on are listed. Hosts without the sysfs directory
+// report a single node holding every allowed CPU.
+class NumaTopology {
+public:
+    struct Node {
+        int id;
+        std::vector<int> cpus;
+    };
+
+    // Order in which pinned pool workers take CPUs
+    enum class Placement {
+        None,       // workers float (no pinning)
+        Compact,    // fill node 0 first, then node 1, ...
+        Spread      // alternate nodes, so any worker count uses every socket
+    };
+
+    static NumaTopology discover(const std::string& root = "/sys/devices/system/node");
+
+    const std::vector<Node>& nodes() const { return nodeList; }
+    size_t cpuCount() const;
+
+    // CPU for worker i at index i % size(); empty for Placement::None
+    std::vector<int> cpuOrder(Placement placement) const;
+
+    // sysfs cpulist syntax, e.g. "0-3,8-11"
+    static std::vector<int> parseCpuList(const std::string& list);
+    static Placement parsePlacement(const std::string& name);
+    static const char* placementName(Placement placement);
+
+private:
+    std::vector<Node> nodeList;
+};
+
+#endif // NUMATOPOLOGY_H
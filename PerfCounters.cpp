@@ -0,0 +1,320 @@
+/*
+   Hardware Performance Counters Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "PerfCounters.h"
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+constexpr PerfCounters::Event HARDWARE_EVENTS[] = {
+    PerfCounters::Event::Cycles, PerfCounters::Event::Instructions, PerfCounters::Event::LlcMisses,
+    PerfCounters::Event::DtlbMisses, PerfCounters::Event::BranchMisses};
+
+// Read with PERF_FORMAT_GROUP | TOTAL_TIME_ENABLED | TOTAL_TIME_RUNNING
+struct GroupReadHeader {
+    uint64_t count;
+    uint64_t timeEnabled;
+    uint64_t timeRunning;
+};
+
+constexpr uint64_t cacheConfig(uint64_t cache, uint64_t op, uint64_t result) {
+    return cache | (op << 8) | (result << 16);
+}
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int openEvent(uint32_t type, uint64_t config, int threadId, int groupFd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = groupFd == -1 ? 1 : 0;     // the leader switches the whole group
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, threadId, -1, groupFd, PERF_FLAG_FD_CLOEXEC));
+}
+
+// The LLC event has a generic fallback for PMUs without cache events
+int openMember(PerfCounters::Event event, int threadId, int groupFd) {
+    switch (event) {
+        case PerfCounters::Event::TaskClock:
+            return openEvent(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, threadId, groupFd);
+        case PerfCounters::Event::Cycles:
+            return openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, threadId, groupFd);
+        case PerfCounters::Event::Instructions:
+            return openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, threadId, groupFd);
+        case PerfCounters::Event::LlcMisses: {
+            int fd = openEvent(PERF_TYPE_HW_CACHE,
+                               cacheConfig(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+                                           PERF_COUNT_HW_CACHE_RESULT_MISS),
+                               threadId, groupFd);
+            if (fd < 0 && errno == ENOENT) {
+                fd = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, threadId, groupFd);
+            }
+            return fd;
+        }
+        case PerfCounters::Event::DtlbMisses:
+            return openEvent(PERF_TYPE_HW_CACHE,
+                             cacheConfig(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                                         PERF_COUNT_HW_CACHE_RESULT_MISS),
+                             threadId, groupFd);
+        case PerfCounters::Event::BranchMisses:
+            return openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, threadId, groupFd);
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+std::string paranoidLevel() {
+    std::ifstream file("/proc/sys/kernel/perf_event_paranoid");
+    std::string level;
+    return (file >> level) ? level : "unknown";
+}
+
+std::string formatCount(const PerfCounters::Sample& sample, PerfCounters::Event event) {
+    if (!sample.has(event)) {
+        return "n/a";
+    }
+    double count = static_cast<double>(sample.value(event));
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(1);
+    if (count >= 1e9) {
+        text << count / 1e9 << "G";
+    } else if (count >= 1e6) {
+        text << count / 1e6 << "M";
+    } else if (count >= 1e3) {
+        text << count / 1e3 << "K";
+    } else {
+        text << std::setprecision(0) << count;
+    }
+    return text.str();
+}
+
+} // namespace
+
+PerfCounters::Sample& PerfCounters::Sample::operator+=(const Sample& other) {
+    bool empty = runs == 0;
+    for (int i = 0; i < EVENT_COUNT; ++i) {
+        values[i] += other.values[i];
+        valid[i] = empty ? other.valid[i] : valid[i] && other.valid[i];
+    }
+    wallSeconds += other.wallSeconds;
+    runs += other.runs;
+    threads = std::max(threads, other.threads);
+    return *this;
+}
+
+double PerfCounters::Sample::ipc() const {
+    if (!has(Event::Cycles) || !has(Event::Instructions) || value(Event::Cycles) == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(value(Event::Instructions)) / value(Event::Cycles);
+}
+
+double PerfCounters::Sample::bandwidthGBs() const {
+    if (!has(Event::LlcMisses) || wallSeconds <= 0.0) {
+        return 0.0;
+    }
+    return static_cast<double>(value(Event::LlcMisses)) * CACHE_LINE_BYTES / wallSeconds / 1e9;
+}
+
+PerfCounters::PerfCounters() {
+    std::vector<int> threadIds;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator("/proc/self/task", error)) {
+        threadIds.push_back(std::atoi(entry.path().filename().c_str()));
+    }
+    if (threadIds.empty()) {
+        reason = "cannot list the threads in /proc/self/task";
+        return;
+    }
+
+    // The first thread decides which hardware events the host has
+    std::vector<Event> events = {Event::TaskClock};
+    std::vector<std::string> missing;
+    int missingErrno = 0;
+    bool probed = false;
+
+    for (int threadId : threadIds) {
+        Group group;
+        group.threadId = threadId;
+        int leader = openMember(Event::TaskClock, threadId, -1);
+        if (leader < 0) {
+            if (errno == ESRCH) {
+                continue;   // the thread exited meanwhile
+            }
+            if (errno == EACCES || errno == EPERM) {
+                reason = "perf_event_open not permitted (kernel.perf_event_paranoid = " + paranoidLevel() + ")";
+            } else if (errno == ENOSYS) {
+                reason = "this kernel has no perf_event_open";
+            } else {
+                reason = std::string("perf_event_open failed: ") + std::strerror(errno);
+            }
+            closeAll();
+            return;
+        }
+        group.members.emplace_back(Event::TaskClock, leader);
+
+        if (!probed) {
+            for (Event event : HARDWARE_EVENTS) {
+                int fd = openMember(event, threadId, leader);
+                if (fd < 0) {
+                    missing.push_back(eventName(event));
+                    missingErrno = errno;
+                    continue;
+                }
+                events.push_back(event);
+                group.members.emplace_back(event, fd);
+            }
+            probed = true;
+        } else {
+            for (size_t i = 1; i < events.size(); ++i) {
+                int fd = openMember(events[i], threadId, leader);
+                if (fd >= 0) {
+                    group.members.emplace_back(events[i], fd);
+                }
+            }
+        }
+        groups.push_back(std::move(group));
+    }
+
+    if (!missing.empty()) {
+        std::string names;
+        for (const auto& name : missing) {
+            names += (names.empty() ? "" : ", ") + name;
+        }
+        std::string cause = (missingErrno == ENOENT || missingErrno == EOPNOTSUPP)
+                                ? "no hardware PMU, e.g. a virtual machine"
+                                : std::strerror(missingErrno);
+        reason = names + " unavailable (" + cause + ")";
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    closeAll();
+}
+
+void PerfCounters::closeAll() {
+    for (auto& group : groups) {
+        // Members before the leader
+        for (auto it = group.members.rbegin(); it != group.members.rend(); ++it) {
+            close(it->second);
+        }
+    }
+    groups.clear();
+}
+
+void PerfCounters::start() {
+    for (const auto& group : groups) {
+        int leader = group.members.front().second;
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    startNs = nowNs();
+}
+
+PerfCounters::Sample PerfCounters::stop() {
+    int64_t endNs = nowNs();
+    for (const auto& group : groups) {
+        ioctl(group.members.front().second, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    threadSamples.clear();
+    Sample total;
+    bool first = true;
+    for (const auto& group : groups) {
+        std::vector<uint64_t> buffer(sizeof(GroupReadHeader) / sizeof(uint64_t) + group.members.size());
+        ssize_t bytes = read(group.members.front().second, buffer.data(), buffer.size() * sizeof(uint64_t));
+        if (bytes < static_cast<ssize_t>(sizeof(GroupReadHeader))) {
+            continue;
+        }
+        GroupReadHeader header;
+        std::memcpy(&header, buffer.data(), sizeof(header));
+        const uint64_t* counts = buffer.data() + sizeof(GroupReadHeader) / sizeof(uint64_t);
+
+        Sample sample;
+        sample.wallSeconds = (endNs - startNs) / 1e9;
+        // Scale up when the group only had the PMU part of the time
+        double scale = (header.timeRunning > 0 && header.timeRunning < header.timeEnabled)
+                           ? static_cast<double>(header.timeEnabled) / header.timeRunning
+                           : 1.0;
+        for (size_t i = 0; i < group.members.size() && i < header.count; ++i) {
+            int index = static_cast<int>(group.members[i].first);
+            sample.values[index] = header.timeRunning > 0 ? static_cast<uint64_t>(counts[i] * scale) : 0;
+            sample.valid[index] = true;
+        }
+        sample.threads = sample.value(Event::TaskClock) > 0 ? 1 : 0;
+        sample.runs = 1;
+        threadSamples.emplace_back(group.threadId, sample);
+
+        // Threads add up; wall time is shared
+        for (int i = 0; i < EVENT_COUNT; ++i) {
+            total.values[i] += sample.values[i];
+            total.valid[i] = first ? sample.valid[i] : total.valid[i] && sample.valid[i];
+        }
+        total.threads += sample.threads;
+        first = false;
+    }
+    total.wallSeconds = (endNs - startNs) / 1e9;
+    total.runs = 1;
+    return total;
+}
+
+const char* PerfCounters::eventName(Event event) {
+    switch (event) {
+        case Event::TaskClock: return "task-clock";
+        case Event::Cycles: return "cycles";
+        case Event::Instructions: return "instructions";
+        case Event::LlcMisses: return "LLC misses";
+        case Event::DtlbMisses: return "dTLB misses";
+        case Event::BranchMisses: return "branch misses";
+    }
+    return "unknown";
+}
+
+void PerfCounters::printTable(std::ostream& out, const std::vector<std::pair<std::string, Sample>>& rows) {
+    out << std::left << std::setw(26) << "Kernel" << std::right << std::setw(8) << "Threads" << std::setw(10)
+        << "Wall ms" << std::setw(10) << "CPU ms" << std::setw(7) << "IPC" << std::setw(10) << "LLC miss"
+        << std::setw(11) << "dTLB miss" << std::setw(10) << "Br miss" << std::setw(9) << "GB/s" << std::endl;
+    for (const auto& [kernel, total] : rows) {
+        Sample sample = total;
+        int runs = std::max(1, total.runs);
+        for (auto& value : sample.values) value /= runs;
+        sample.wallSeconds /= runs;
+        std::ostringstream ipc, bandwidth, cpu;
+        ipc << std::fixed << std::setprecision(2);
+        bandwidth << std::fixed << std::setprecision(2);
+        cpu << std::fixed << std::setprecision(2);
+        if (sample.has(Event::Instructions) && sample.has(Event::Cycles)) ipc << sample.ipc(); else ipc << "n/a";
+        if (sample.has(Event::LlcMisses)) bandwidth << sample.bandwidthGBs(); else bandwidth << "n/a";
+        if (sample.has(Event::TaskClock)) cpu << sample.value(Event::TaskClock) / 1e6; else cpu << "n/a";
+        out << std::left << std::setw(26) << kernel << std::right << std::setw(8) << sample.threads
+            << std::setw(10) << std::fixed << std::setprecision(2) << sample.wallSeconds * 1000.0
+            << std::setw(10) << cpu.str() << std::setw(7) << ipc.str() << std::setw(10)
+            << formatCount(sample, Event::LlcMisses) << std::setw(11) << formatCount(sample, Event::DtlbMisses)
+            << std::setw(10) << formatCount(sample, Event::BranchMisses) << std::setw(9) << bandwidth.str()
+            << std::endl;
+    }
+    out << "(GB/s = LLC misses x " << CACHE_LINE_BYTES << " B / wall time)" << std::endl;
+}
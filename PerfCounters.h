@@ -0,0 +1,93 @@
+/*
+   Hardware Performance Counters
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Counts events on every thread of the process (pool and OpenMP workers
+// included) with perf_event_open: one group per thread, led by the task
+// clock, read in one call with PERF_FORMAT_GROUP. Only user-space events
+// are counted, which kernel.perf_event_paranoid = 2 still allows. Hardware
+// events the host lacks (no PMU in most VMs) are left out of the groups
+// and reported as unavailable; when perf_event_open is refused altogether
+// available() is false. Threads created after construction are not counted.
+class PerfCounters {
+public:
+    enum class Event {
+        TaskClock,      // ns of CPU time
+        Cycles,
+        Instructions,
+        LlcMisses,      // last-level cache read misses
+        DtlbMisses,     // data TLB read misses
+        BranchMisses
+    };
+    static constexpr int EVENT_COUNT = 6;
+    static constexpr size_t CACHE_LINE_BYTES = 64;
+
+    struct Sample {
+        uint64_t values[EVENT_COUNT] = {};
+        bool valid[EVENT_COUNT] = {};
+        double wallSeconds = 0.0;
+        int threads = 0;            // threads that ran during the sample
+        int runs = 0;               // samples added up
+
+        bool has(Event event) const { return valid[static_cast<int>(event)]; }
+        uint64_t value(Event event) const { return values[static_cast<int>(event)]; }
+        // Sums counts, wall time and runs (threads: the larger); an event stays
+        // valid only if valid in both
+        Sample& operator+=(const Sample& other);
+
+        // 0 when an input is unavailable
+        double ipc() const;
+        // LLC misses x cache line / wall time: the DRAM read traffic the misses caused
+        double bandwidthGBs() const;
+    };
+
+    // Opens the groups; never throws
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters& other) = delete;
+    PerfCounters& operator=(const PerfCounters& other) = delete;
+
+    bool available() const { return !groups.empty(); }
+    // Why nothing is counted, or which hardware events are missing and why
+    const std::string& unavailableReason() const { return reason; }
+
+    // Zeroes and enables every group
+    void start();
+    // Disables every group and returns the sum over threads (scaled when
+    // the kernel had to multiplex the PMU)
+    Sample stop();
+    // Per thread, from the last stop()
+    const std::vector<std::pair<int, Sample>>& perThread() const { return threadSamples; }
+
+    static const char* eventName(Event event);
+    // One row per kernel, per run: busy threads, CPU time, IPC, misses and bandwidth
+    static void printTable(std::ostream& out, const std::vector<std::pair<std::string, Sample>>& rows);
+
+private:
+    struct Group {
+        int threadId = 0;
+        std::vector<std::pair<Event, int>> members;    // leader first
+    };
+
+    std::vector<Group> groups;
+    std::vector<std::pair<int, Sample>> threadSamples;
+    std::string reason;
+    int64_t startNs = 0;
+
+    void closeAll();
+};
+
+#endif // PERFCOUNTERS_H
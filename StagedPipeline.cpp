@@ -0,0 +1,249 @@
+/*
+   Staged Pipeline Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "StagedPipeline.h"
+#include "BoundedQueue.h"
+#include "WorkWithBMP_optimized.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// Shared by the four saves of one image; the last one settles the outcome
+struct ImageTicket {
+    std::string inputFile;
+    uint64_t pixels = 0;
+    std::atomic<int> pendingSaves{0};
+    std::atomic<bool> failed{false};
+};
+
+struct LoadedFrame {
+    std::shared_ptr<ImageTicket> ticket;
+    BMPFrame frame;
+};
+
+struct SaveJob {
+    std::shared_ptr<ImageTicket> ticket;
+    std::string outputFile;
+    BMPFrame frame;
+};
+
+// Busy-time accumulator in nanoseconds, shared by the threads of one stage
+class StageClock {
+private:
+    std::atomic<uint64_t> busyNanoseconds{0};
+    std::atomic<size_t> items{0};
+
+public:
+    template<typename F>
+    void measure(F&& work) {
+        auto start = std::chrono::high_resolution_clock::now();
+        work();
+        auto elapsed = std::chrono::high_resolution_clock::now() - start;
+        busyNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        items.fetch_add(1);
+    }
+
+    StagedPipeline::StageStats stats(const std::string& name, int threads) const {
+        StagedPipeline::StageStats result;
+        result.name = name;
+        result.threads = threads;
+        result.items = items.load();
+        result.busySeconds = busyNanoseconds.load() / 1e9;
+        return result;
+    }
+};
+
+} // namespace
+
+StagedPipeline::StagedPipeline(const BatchProcessor::Options& batchOptions, const StageSizes& stageSizes)
+    : options(batchOptions), sizes(stageSizes), naming(batchOptions) {
+    if (options.numThreads <= 0) {
+        options.numThreads = std::thread::hardware_concurrency();
+        if (options.numThreads == 0) options.numThreads = 4; // fallback
+    }
+    if (sizes.workers <= 0) {
+        sizes.workers = std::thread::hardware_concurrency();
+        if (sizes.workers == 0) sizes.workers = 4; // fallback
+    }
+    if (sizes.readers <= 0 || sizes.writers <= 0 || sizes.queueCapacity == 0) {
+        throw std::invalid_argument("Pipeline stages need at least one thread and a non-empty queue");
+    }
+}
+
+StagedPipeline::StageSizes StagedPipeline::parseStageSizes(const std::string& spec) {
+    StageSizes result;
+    std::istringstream stream(spec);
+    char separator1 = 0;
+    char separator2 = 0;
+    if (!(stream >> result.readers >> separator1 >> result.workers >> separator2 >> result.writers) ||
+        separator1 != ':' || separator2 != ':' || !stream.eof() ||
+        result.readers <= 0 || result.workers < 0 || result.writers <= 0) {
+        throw std::invalid_argument("Stage sizes must look like R:W:S, e.g. 1:4:2 (W = 0 for auto)");
+    }
+    return result;
+}
+
+StagedPipeline::Report StagedPipeline::run(const std::vector<std::string>& inputs) {
+    BoundedQueue<LoadedFrame> loadedQueue(sizes.queueCapacity);
+    // Every image produces four outputs
+    BoundedQueue<SaveJob> saveQueue(sizes.queueCapacity * 4);
+
+    StageClock loadClock;
+    StageClock computeClock;
+    StageClock saveClock;
+    std::atomic<size_t> nextInput{0};
+    std::atomic<size_t> imagesDone{0};
+    std::atomic<size_t> imagesFailed{0};
+    std::atomic<uint64_t> pixelsDone{0};
+    std::mutex errorMutex;
+    // Arena for this run: readers, workers and writers all recycle through it
+    auto framePool = std::make_shared<FramePool>();
+
+    auto fail = [&](const std::shared_ptr<ImageTicket>& ticket, const std::exception& e) {
+        if (!ticket->failed.exchange(true)) {
+            imagesFailed.fetch_add(1);
+            std::lock_guard<std::mutex> lock(errorMutex);
+            std::cerr << "Pipeline error: " << ticket->inputFile << ": " << e.what() << std::endl;
+        }
+    };
+
+    auto loadMode = options.useMmap ? BMPImageOptimized::LoadMode::Mapped
+                                          : BMPImageOptimized::LoadMode::Buffered;
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    auto reader = [&]() {
+        Trace::setThreadName("reader");
+        BMPImageOptimized image;
+        image.setFramePool(framePool);
+        // Loaded buffers get room for the rotated layout
+        image.setInPlaceRotation(options.inPlaceRotation);
+        for (;;) {
+            size_t index = nextInput.fetch_add(1);
+            if (index >= inputs.size()) {
+                return;
+            }
+            auto ticket = std::make_shared<ImageTicket>();
+            ticket->inputFile = inputs[index];
+            LoadedFrame loaded{ticket, BMPFrame()};
+            try {
+                loadClock.measure([&]() { loaded.frame = image.loadFrame(ticket->inputFile, loadMode); });
+            } catch (const std::exception& e) {
+                fail(ticket, e);
+                continue;
+            }
+            ticket->pixels = static_cast<uint64_t>(loaded.frame.getWidth()) * loaded.frame.getHeight();
+            loadedQueue.push(std::move(loaded));
+        }
+    };
+
+    // Large frames split their kernels across this worker's share of the threads
+    int largeFrameThreads = std::max(1, options.numThreads / sizes.workers);
+    auto worker = [&]() {
+        Trace::setThreadName("pipeline worker");
+        BMPImageOptimized image;
+        image.setFramePool(framePool);
+        if (options.tileSize > 0) {
+            image.setTileSize(options.tileSize);
+        }
+        image.setInPlaceRotation(options.inPlaceRotation);
+        image.setLazyOrientation(options.lazyOrientation);
+        LoadedFrame loaded;
+        while (loadedQueue.pop(loaded)) {
+            auto ticket = loaded.ticket;
+            ticket->pendingSaves.store(4);
+            std::vector<SaveJob> jobs;
+            try {
+                computeClock.measure([&]() {
+                    int kernelThreads = ticket->pixels >= options.largeFramePixels ? largeFrameThreads : 1;
+                    for (bool clockwise : {true, false}) {
+                        BMPFrame frame = clockwise ? loaded.frame.clone() : std::move(loaded.frame);
+                        if (kernelThreads > 1) {
+                            if (clockwise) image.rotateClockwiseParallel(frame, kernelThreads);
+                            else image.rotateCounterClockwiseParallel(frame, kernelThreads);
+                        } else {
+                            if (clockwise) image.rotateClockwise(frame);
+                            else image.rotateCounterClockwise(frame);
+                        }
+                        // The writer keeps the rotated pixels; filtering then
+                        // copies on write instead of racing with the save
+                        jobs.push_back(SaveJob{ticket, naming.outputPath(ticket->inputFile,
+                            clockwise ? "rotated_clockwise_opt" : "rotated_counter_clockwise_opt"), frame});
+                        if (kernelThreads > 1) {
+                            image.applyGaussianBlurParallel(frame, options.blurRadius, options.blurSigma,
+                                                            kernelThreads);
+                        } else {
+                            image.applyGaussianBlur(frame, options.blurRadius, options.blurSigma);
+                        }
+                        jobs.push_back(SaveJob{ticket, naming.outputPath(ticket->inputFile,
+                            clockwise ? "filtered_clockwise_opt" : "filtered_counter_clockwise_opt"),
+                            std::move(frame)});
+                    }
+                });
+            } catch (const std::exception& e) {
+                fail(ticket, e);
+                continue;
+            }
+            for (auto& job : jobs) {
+                saveQueue.push(std::move(job));
+            }
+        }
+    };
+
+    auto writer = [&]() {
+        Trace::setThreadName("writer");
+        BMPImageOptimized image;
+        SaveJob job;
+        while (saveQueue.pop(job)) {
+            try {
+                saveClock.measure([&]() { image.saveToFile(job.outputFile, job.frame); });
+            } catch (const std::exception& e) {
+                fail(job.ticket, e);
+            }
+            if (job.ticket->pendingSaves.fetch_sub(1) == 1 && !job.ticket->failed.load()) {
+                imagesDone.fetch_add(1);
+                pixelsDone.fetch_add(job.ticket->pixels);
+            }
+            job = SaveJob();
+        }
+    };
+
+    std::vector<std::thread> readers;
+    std::vector<std::thread> workers;
+    std::vector<std::thread> writers;
+    for (int i = 0; i < sizes.readers; ++i) readers.emplace_back(reader);
+    for (int i = 0; i < sizes.workers; ++i) workers.emplace_back(worker);
+    for (int i = 0; i < sizes.writers; ++i) writers.emplace_back(writer);
+
+    // Shut stages down in order: a queue closes once all its producers are done
+    for (auto& thread : readers) thread.join();
+    loadedQueue.close();
+    for (auto& thread : workers) thread.join();
+    saveQueue.close();
+    for (auto& thread : writers) thread.join();
+
+    Report report;
+    report.batch.images = imagesDone.load();
+    report.batch.failed = imagesFailed.load();
+    report.batch.pixels = pixelsDone.load();
+    report.batch.workers = sizes.workers;
+    report.batch.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+    report.batch.framePool = framePool->getStats();
+    report.load = loadClock.stats("load", sizes.readers);
+    report.compute = computeClock.stats("process", sizes.workers);
+    report.save = saveClock.stats("save", sizes.writers);
+    return report;
+}
@@ -0,0 +1,61 @@
+/*
+   Staged Load -> Process -> Save Pipeline for Many Files
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef STAGEDPIPELINE_H
+#define STAGEDPIPELINE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "BatchProcessor.h"
+
+// Reader threads, compute workers and writer threads connected by bounded
+// lock-free queues. Loading the next frames and writing finished outputs
+// overlap with the kernels, and a full queue stalls its producer, so memory
+// stays bounded by the queue capacities. Over many frames the wall time
+// tends to the slowest stage instead of the sum of all three.
+class StagedPipeline {
+public:
+    struct StageSizes {
+        int readers = 1;
+        int workers = 0;             // 0 = hardware concurrency
+        int writers = 1;
+        size_t queueCapacity = 4;    // frames in flight between two stages
+    };
+
+    struct StageStats {
+        std::string name;
+        int threads = 0;
+        size_t items = 0;
+        double busySeconds = 0.0;    // summed over the stage's threads
+
+        // Wall time the stage alone would need with its threads fully busy
+        double criticalSeconds() const { return threads > 0 ? busySeconds / threads : 0.0; }
+    };
+
+    struct Report {
+        BatchProcessor::Report batch;
+        StageStats load;
+        StageStats compute;
+        StageStats save;
+    };
+
+private:
+    BatchProcessor::Options options;
+    StageSizes sizes;
+    BatchProcessor naming;           // output paths and options shared with batch mode
+
+public:
+    StagedPipeline(const BatchProcessor::Options& batchOptions, const StageSizes& stageSizes);
+
+    // Parse "R:W:S" (readers:workers:writers); throws std::invalid_argument
+    static StageSizes parseStageSizes(const std::string& spec);
+
+    Report run(const std::vector<std::string>& inputs);
+};
+
+#endif // STAGEDPIPELINE_H
@@ -0,0 +1,268 @@
+/*
+   Out-of-core BMP Rotation Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "StreamingRotator.h"
+#include "ImageKernels.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint64_t FILE_HEADER_SIZE = 14;
+constexpr uint64_t INFO_HEADER_SIZE = 40;
+
+// Owns a file descriptor for the duration of one rotation
+class FileHandle {
+private:
+    int fd;
+
+public:
+    explicit FileHandle(int descriptor) : fd(descriptor) {}
+    ~FileHandle() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    FileHandle(const FileHandle& other) = delete;
+    FileHandle& operator=(const FileHandle& other) = delete;
+
+    int get() const { return fd; }
+};
+
+std::string systemError(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+// pread/pwrite may transfer less than asked (and at most ~2 GB per call)
+void readFully(int fd, unsigned char* buffer, uint64_t count, uint64_t offset, const std::string& what) {
+    while (count > 0) {
+        ssize_t got = ::pread(fd, buffer, count, static_cast<off_t>(offset));
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(systemError("Failed to read " + what));
+        }
+        if (got == 0) {
+            throw std::runtime_error("Unexpected end of file while reading " + what);
+        }
+        buffer += got;
+        count -= static_cast<uint64_t>(got);
+        offset += static_cast<uint64_t>(got);
+    }
+}
+
+void writeFully(int fd, const unsigned char* buffer, uint64_t count, uint64_t offset, const std::string& what) {
+    while (count > 0) {
+        ssize_t written = ::pwrite(fd, buffer, count, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(systemError("Failed to write " + what));
+        }
+        buffer += written;
+        count -= static_cast<uint64_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+}
+
+double elapsedMs(std::chrono::high_resolution_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - since).count();
+}
+
+} // namespace
+
+StreamingRotator::StreamingRotator(size_t memoryBudgetBytes, int numThreads)
+    : memoryBudget(memoryBudgetBytes), numThreads(numThreads), tileSize(ImageKernels::DEFAULT_TILE_SIZE) {
+    if (memoryBudget == 0) {
+        throw std::invalid_argument("Memory budget must be positive");
+    }
+    if (this->numThreads <= 0) {
+        this->numThreads = std::thread::hardware_concurrency();
+        if (this->numThreads == 0) this->numThreads = 4; // fallback
+    }
+    const char* tmp = std::getenv("TMPDIR");
+    tempDirectory = (tmp != nullptr && *tmp != '\0') ? tmp : "/tmp";
+}
+
+void StreamingRotator::setTempDirectory(const std::string& directory) {
+    tempDirectory = directory;
+}
+
+void StreamingRotator::setThreadPool(std::shared_ptr<ThreadPool> pool) {
+    threadPool = std::move(pool);
+}
+
+void StreamingRotator::setTileSize(int pixels) {
+    if (pixels <= 0) {
+        throw std::invalid_argument("Tile size must be positive");
+    }
+    tileSize = pixels;
+}
+
+StreamingRotator::Result StreamingRotator::rotateFile(const std::string& inputFile, const std::string& outputFile,
+                                                      bool clockwise) {
+    FileHandle input(::open(inputFile.c_str(), O_RDONLY | O_CLOEXEC));
+    if (input.get() < 0) {
+        throw std::runtime_error(systemError("Cannot open file: " + inputFile));
+    }
+
+    // Headers and palette are small and read up front
+    unsigned char fileHeader[FILE_HEADER_SIZE];
+    unsigned char infoHeader[INFO_HEADER_SIZE];
+    readFully(input.get(), fileHeader, FILE_HEADER_SIZE, 0, "file header");
+    readFully(input.get(), infoHeader, INFO_HEADER_SIZE, FILE_HEADER_SIZE, "info header");
+
+    uint32_t dataOffset;
+    int32_t width;
+    int32_t height;
+    int16_t bitsPerPixel;
+    std::memcpy(&dataOffset, fileHeader + 10, sizeof(dataOffset));
+    std::memcpy(&width, infoHeader + 4, sizeof(width));
+    std::memcpy(&height, infoHeader + 8, sizeof(height));
+    std::memcpy(&bitsPerPixel, infoHeader + 14, sizeof(bitsPerPixel));
+    if (width <= 0 || height <= 0) {
+        throw std::runtime_error("Invalid image dimensions");
+    }
+    if (bitsPerPixel != 24 && bitsPerPixel != 32) {
+        throw std::runtime_error("Unsupported bits per pixel: " + std::to_string(bitsPerPixel));
+    }
+    if (dataOffset < FILE_HEADER_SIZE + INFO_HEADER_SIZE) {
+        throw std::runtime_error("Invalid pixel data offset");
+    }
+
+    const auto sourceDesc = ImageKernels::makeDescriptor(width, height, bitsPerPixel);
+    const auto destDesc = ImageKernels::rotatedDescriptor(sourceDesc);
+    const uint64_t bytesPerPixel = static_cast<uint64_t>(sourceDesc.bytesPerPixel());
+
+    struct stat info;
+    if (::fstat(input.get(), &info) != 0) {
+        throw std::runtime_error(systemError("Cannot stat file: " + inputFile));
+    }
+    if (static_cast<uint64_t>(info.st_size) < dataOffset + sourceDesc.dataSize()) {
+        throw std::runtime_error("Failed to read complete image data");
+    }
+
+    std::vector<unsigned char> palette(dataOffset - FILE_HEADER_SIZE - INFO_HEADER_SIZE);
+    readFully(input.get(), palette.data(), palette.size(), FILE_HEADER_SIZE + INFO_HEADER_SIZE, "palette");
+
+    // Temp file holding one column block of the destination per source strip.
+    // Block k (source rows [y0, y0 + rows)) is width destination rows of
+    // rows pixels each, stored at byte width * bpp * y0.
+    std::string tempTemplate = tempDirectory + "/bmp_rotate_XXXXXX";
+    std::vector<char> tempPath(tempTemplate.begin(), tempTemplate.end());
+    tempPath.push_back('\0');
+    FileHandle temp(::mkstemp(tempPath.data()));
+    if (temp.get() < 0) {
+        throw std::runtime_error(systemError("Cannot create temporary file in " + tempDirectory));
+    }
+    ::unlink(tempPath.data());
+
+    auto pool = threadPool ? threadPool : ThreadPool::sharedInstance();
+    const uint64_t blockRowBytes = static_cast<uint64_t>(width) * bytesPerPixel;
+
+    Result result{};
+    result.width = destDesc.width;
+    result.height = destDesc.height;
+    result.pixelBytes = destDesc.dataSize();
+    result.tempBytes = blockRowBytes * static_cast<uint64_t>(height);
+
+    // Phase 1: a strip of R source rows costs R * stride bytes to read plus
+    // R * width * bpp bytes for its rotated block
+    auto stripStart = std::chrono::high_resolution_clock::now();
+    const uint64_t stripRowCost = sourceDesc.stride + blockRowBytes;
+    const int stripRows = static_cast<int>(std::max<uint64_t>(
+        1, std::min<uint64_t>(static_cast<uint64_t>(height), memoryBudget / stripRowCost)));
+    {
+        std::vector<unsigned char> strip(static_cast<size_t>(stripRows) * sourceDesc.stride);
+        std::vector<unsigned char> block(static_cast<size_t>(stripRows) * blockRowBytes);
+
+        for (int y0 = 0; y0 < height; y0 += stripRows) {
+            int rows = std::min(stripRows, height - y0);
+            readFully(input.get(), strip.data(), static_cast<uint64_t>(rows) * sourceDesc.stride,
+                      dataOffset + static_cast<uint64_t>(y0) * sourceDesc.stride, "image data");
+
+            // The strip is a width x rows image; its rotation is a packed
+            // rows x width block (no row padding)
+            const size_t blockStride = static_cast<size_t>(rows) * bytesPerPixel;
+            int numBands = (width + tileSize - 1) / tileSize;
+            pool->parallelFor(numBands, numThreads, [&](int band) {
+                int startY = band * tileSize;
+                int endY = std::min(startY + tileSize, width);
+                if (clockwise) {
+                    ImageKernels::rotateBandClockwise(strip.data(), width, rows, sourceDesc.stride,
+                                                      block.data(), blockStride, sourceDesc.bytesPerPixel(),
+                                                      startY, endY, tileSize);
+                } else {
+                    ImageKernels::rotateBandCounterClockwise(strip.data(), width, rows, sourceDesc.stride,
+                                                             block.data(), blockStride, sourceDesc.bytesPerPixel(),
+                                                             startY, endY, tileSize);
+                }
+            });
+
+            writeFully(temp.get(), block.data(), blockStride * static_cast<uint64_t>(width),
+                       blockRowBytes * static_cast<uint64_t>(y0), "temporary file");
+            ++result.strips;
+        }
+    }
+    result.stripPhaseMs = elapsedMs(stripStart);
+
+    // Phase 2: a band of B destination rows costs B * stride bytes plus
+    // B rows of the widest block as read scratch
+    auto bandStart = std::chrono::high_resolution_clock::now();
+    FileHandle output(::open(outputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+    if (output.get() < 0) {
+        throw std::runtime_error(systemError("Cannot create file: " + outputFile));
+    }
+
+    ImageKernels::writeBmpGeometry(fileHeader, infoHeader, destDesc, palette.size());
+    const uint64_t outputDataOffset = FILE_HEADER_SIZE + INFO_HEADER_SIZE + palette.size();
+    writeFully(output.get(), fileHeader, FILE_HEADER_SIZE, 0, outputFile);
+    writeFully(output.get(), infoHeader, INFO_HEADER_SIZE, FILE_HEADER_SIZE, outputFile);
+    writeFully(output.get(), palette.data(), palette.size(), FILE_HEADER_SIZE + INFO_HEADER_SIZE, outputFile);
+
+    const uint64_t scratchRowBytes = static_cast<uint64_t>(stripRows) * bytesPerPixel;
+    const uint64_t bandRowCost = destDesc.stride + scratchRowBytes;
+    const int bandRows = static_cast<int>(std::max<uint64_t>(
+        1, std::min<uint64_t>(static_cast<uint64_t>(destDesc.height), memoryBudget / bandRowCost)));
+    {
+        // Padding bytes are never written by the copies below, so they stay zero
+        std::vector<unsigned char> band(static_cast<size_t>(bandRows) * destDesc.stride, 0);
+        std::vector<unsigned char> scratch(static_cast<size_t>(bandRows) * scratchRowBytes);
+
+        for (int ny0 = 0; ny0 < destDesc.height; ny0 += bandRows) {
+            int rows = std::min(bandRows, destDesc.height - ny0);
+            for (int y0 = 0; y0 < height; y0 += stripRows) {
+                int columns = std::min(stripRows, height - y0);
+                const uint64_t sliceRowBytes = static_cast<uint64_t>(columns) * bytesPerPixel;
+                readFully(temp.get(), scratch.data(), sliceRowBytes * static_cast<uint64_t>(rows),
+                          blockRowBytes * static_cast<uint64_t>(y0) + sliceRowBytes * static_cast<uint64_t>(ny0),
+                          "temporary file");
+
+                // Clockwise blocks land at destination x = y0, counter-clockwise
+                // ones mirror to x = height - y0 - columns
+                uint64_t destX = clockwise ? static_cast<uint64_t>(y0)
+                                           : static_cast<uint64_t>(height - y0 - columns);
+                for (int i = 0; i < rows; ++i) {
+                    std::memcpy(band.data() + static_cast<size_t>(i) * destDesc.stride + destX * bytesPerPixel,
+                                scratch.data() + static_cast<size_t>(i) * sliceRowBytes, sliceRowBytes);
+                }
+            }
+            writeFully(output.get(), band.data(), static_cast<uint64_t>(rows) * destDesc.stride,
+                       outputDataOffset + static_cast<uint64_t>(ny0) * destDesc.stride, outputFile);
+            ++result.bands;
+        }
+    }
+    result.bandPhaseMs = elapsedMs(bandStart);
+
+    return result;
+}
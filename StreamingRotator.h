@@ -0,0 +1,66 @@
+/*
+   Out-of-core BMP Rotation with Bounded Memory
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef STREAMINGROTATOR_H
+#define STREAMINGROTATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "ThreadPool.h"
+
+// Rotates BMP files that do not fit in memory. The rotation is a two-phase
+// tiled transpose through a temporary file:
+//   1. read the source in horizontal strips, rotate each strip in memory and
+//      append it to the temp file as a column block of the destination;
+//   2. assemble destination row bands from the matching slice of every
+//      block and write them to the output sequentially.
+// Neither phase holds more than the memory budget (plus one row per buffer
+// when the budget is smaller than a single row). All offsets are 64-bit.
+class StreamingRotator {
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = size_t(256) << 20;   // 256 MB
+
+    struct Result {
+        int width;               // destination dimensions
+        int height;
+        uint64_t pixelBytes;     // destination pixel array size
+        uint64_t tempBytes;      // bytes staged in the temp file
+        int strips;              // phase 1 source strips (= column blocks)
+        int bands;               // phase 2 destination row bands
+        double stripPhaseMs;
+        double bandPhaseMs;
+    };
+
+private:
+    size_t memoryBudget;
+    int numThreads;
+    int tileSize;
+    std::string tempDirectory;
+    std::shared_ptr<ThreadPool> threadPool;
+
+public:
+    // memoryBudgetBytes bounds each phase's buffers; numThreads <= 0 means hardware concurrency
+    explicit StreamingRotator(size_t memoryBudgetBytes = DEFAULT_MEMORY_BUDGET, int numThreads = 0);
+
+    // Directory for the temp file ($TMPDIR or /tmp by default); the file is
+    // unlinked as soon as it is created, so it never outlives the process
+    void setTempDirectory(const std::string& directory);
+
+    // Pool used to rotate strips in memory (nullptr = shared library pool)
+    void setThreadPool(std::shared_ptr<ThreadPool> pool);
+
+    void setTileSize(int pixels);
+
+    size_t getMemoryBudget() const { return memoryBudget; }
+
+    // Rotate inputFile by 90 degrees into outputFile
+    Result rotateFile(const std::string& inputFile, const std::string& outputFile, bool clockwise);
+};
+
+#endif // STREAMINGROTATOR_H
@@ -0,0 +1,141 @@
+/*
+   Dependency Graph of Tasks Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "TaskGraph.h"
+#include "Trace.h"
+#include <algorithm>
+#include <stdexcept>
+
+TaskGraph::TaskGraph(std::shared_ptr<ThreadPool> pool)
+    : threadPool(pool ? std::move(pool) : ThreadPool::sharedInstance()) {
+}
+
+TaskGraph::TaskId TaskGraph::addTask(const std::string& name, std::function<void()> work,
+                                     const std::vector<TaskId>& dependencies) {
+    TaskId id = static_cast<TaskId>(nodes.size());
+    for (TaskId dependency : dependencies) {
+        if (dependency < 0 || dependency >= id) {
+            throw std::invalid_argument("Task '" + name + "' depends on an unknown task");
+        }
+    }
+    
+    Node node;
+    node.name = name;
+    node.work = std::move(work);
+    node.dependencyCount = static_cast<int>(dependencies.size());
+    node.timing = TaskTiming{name, 0.0, 0.0};
+    nodes.push_back(std::move(node));
+    for (TaskId dependency : dependencies) {
+        nodes[dependency].successors.push_back(id);
+    }
+    return id;
+}
+
+const TaskGraph::TaskTiming& TaskGraph::getTiming(TaskId id) const {
+    if (id < 0 || id >= static_cast<TaskId>(nodes.size())) {
+        throw std::out_of_range("Unknown task id");
+    }
+    return nodes[id].timing;
+}
+
+void TaskGraph::submitHelpers() {
+    while (activeHelpers < maxHelpers && activeHelpers < static_cast<int>(readyTasks.size())) {
+        ++activeHelpers;
+        threadPool->submit([this]() { work(false); });
+    }
+}
+
+void TaskGraph::work(bool isCaller) {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    for (;;) {
+        bool stopped = firstError != nullptr;
+        if (!stopped && !readyTasks.empty()) {
+            TaskId id = readyTasks.front();
+            readyTasks.pop_front();
+            ++runningTasks;
+            lock.unlock();
+            
+            Node& node = nodes[id];
+            std::exception_ptr error;
+            auto start = std::chrono::high_resolution_clock::now();
+            try {
+                BMP_TRACE_SCOPE(trace, Trace::intern(node.name), "task");
+                node.work();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            node.timing.startMs = std::chrono::duration<double, std::milli>(start - origin).count();
+            node.timing.durationMs = std::chrono::duration<double, std::milli>(end - start).count();
+            
+            lock.lock();
+            --runningTasks;
+            if (error) {
+                if (!firstError) firstError = error;
+            } else {
+                ++finishedTasks;
+                for (TaskId successor : node.successors) {
+                    if (--nodes[successor].pendingDependencies == 0) {
+                        readyTasks.push_back(successor);
+                    }
+                }
+                submitHelpers();
+            }
+            stateCondition.notify_all();
+            continue;
+        }
+        
+        if (!isCaller) {
+            // Notify under the lock: after returning the helper never touches the graph
+            --activeHelpers;
+            stateCondition.notify_all();
+            return;
+        }
+        bool done = finishedTasks == static_cast<int>(nodes.size()) || (stopped && runningTasks == 0);
+        if (done && activeHelpers == 0) {
+            return;
+        }
+        stateCondition.wait(lock);
+    }
+}
+
+void TaskGraph::run(int maxParallelism) {
+    if (nodes.empty()) {
+        return;
+    }
+    if (maxParallelism <= 0) {
+        maxParallelism = threadPool->size() + 1;
+    }
+    int helpers = std::min(maxParallelism, static_cast<int>(nodes.size())) - 1;
+    if (helpers > 0) {
+        threadPool->ensureWorkers(helpers);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        readyTasks.clear();
+        finishedTasks = 0;
+        runningTasks = 0;
+        activeHelpers = 0;
+        maxHelpers = std::max(0, helpers);
+        firstError = nullptr;
+        origin = std::chrono::high_resolution_clock::now();
+        for (TaskId id = 0; id < static_cast<TaskId>(nodes.size()); ++id) {
+            nodes[id].pendingDependencies = nodes[id].dependencyCount;
+            if (nodes[id].dependencyCount == 0) {
+                readyTasks.push_back(id);
+            }
+        }
+        submitHelpers();
+    }
+    
+    work(true);
+    
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
@@ -0,0 +1,87 @@
+/*
+   Dependency Graph of Tasks on the Shared Thread Pool
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ThreadPool.h"
+
+// Runs a DAG of tasks: a task starts as soon as all of its dependencies have
+// finished, so independent branches (e.g. the clockwise and counter-clockwise
+// outputs) overlap. Ready tasks are taken by pool workers and by the thread
+// that called run(), which keeps nested parallelFor calls deadlock-free.
+class TaskGraph {
+public:
+    using TaskId = int;
+
+    struct TaskTiming {
+        std::string name;
+        double startMs;          // relative to the start of run()
+        double durationMs;
+    };
+
+private:
+    struct Node {
+        std::string name;
+        std::function<void()> work;
+        std::vector<TaskId> successors;
+        int dependencyCount = 0;
+        int pendingDependencies = 0;
+        TaskTiming timing;
+    };
+
+    std::vector<Node> nodes;
+    std::shared_ptr<ThreadPool> threadPool;
+
+    // Run state, guarded by stateMutex
+    std::mutex stateMutex;
+    std::condition_variable stateCondition;
+    std::deque<TaskId> readyTasks;
+    int finishedTasks = 0;
+    int runningTasks = 0;
+    int activeHelpers = 0;
+    int maxHelpers = 0;
+    std::exception_ptr firstError;
+    std::chrono::high_resolution_clock::time_point origin;
+
+    // Queue pool helpers for ready tasks (stateMutex held)
+    void submitHelpers();
+
+    // Execute ready tasks; helpers return when none is ready, the caller
+    // returns once the graph is finished (or stopped) and no helper is left
+    void work(bool isCaller);
+
+public:
+    // pool == nullptr uses ThreadPool::sharedInstance()
+    explicit TaskGraph(std::shared_ptr<ThreadPool> pool = nullptr);
+
+    TaskGraph(const TaskGraph& other) = delete;
+    TaskGraph& operator=(const TaskGraph& other) = delete;
+
+    // Dependencies must be ids returned by earlier addTask calls
+    TaskId addTask(const std::string& name, std::function<void()> work,
+                   const std::vector<TaskId>& dependencies = {});
+
+    // Execute every task with at most maxParallelism running at once
+    // (<= 0: pool size + calling thread). Blocks until all tasks are done;
+    // after a failure no new tasks start and the first exception is rethrown.
+    void run(int maxParallelism = 0);
+
+    size_t size() const { return nodes.size(); }
+    const TaskTiming& getTiming(TaskId id) const;
+};
+
+#endif // TASKGRAPH_H
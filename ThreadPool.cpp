@@ -0,0 +1,378 @@
+/*
+   Persistent Thread Pool Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+
+// Index of the pool worker running on this thread (-1 elsewhere)
+thread_local int currentWorkerIndex = -1;
+
+} // namespace
+
+ThreadPool::ThreadPool(int numThreads) : stopping(false) {
+    if (numThreads <= 0) {
+        numThreads = std::thread::hardware_concurrency();
+        if (numThreads == 0) numThreads = 4; // fallback
+    }
+    ensureWorkers(numThreads);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::sharedInstance() {
+    static std::shared_ptr<ThreadPool> instance = std::make_shared<ThreadPool>();
+    return instance;
+}
+
+int ThreadPool::size() const {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return static_cast<int>(workers.size());
+}
+
+void ThreadPool::ensureWorkers(int count) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    while (static_cast<int>(workers.size()) < count) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, static_cast<int>(workers.size()));
+        if (!workerCpus.empty()) {
+            // CPUs were validated by pinWorkers; a late failure only leaves this worker floating
+            pinWorker(static_cast<int>(workers.size()) - 1);
+        }
+    }
+}
+
+int ThreadPool::pinWorker(int index) {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (workerCpus.empty()) {
+        // Back to the process's own mask
+        if (sched_getaffinity(0, sizeof(mask), &mask) != 0) {
+            return errno;
+        }
+    } else {
+        int cpu = workerCpus[index % workerCpus.size()];
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            return EINVAL;
+        }
+        CPU_SET(cpu, &mask);
+    }
+    return pthread_setaffinity_np(workers[index].native_handle(), sizeof(mask), &mask);
+}
+
+void ThreadPool::pinWorkers(const std::vector<int>& cpus) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    workerCpus = cpus;
+    for (int index = 0; index < static_cast<int>(workers.size()); ++index) {
+        int error = pinWorker(index);
+        if (error != 0) {
+            // Leave every worker floating rather than half pinned
+            workerCpus.clear();
+            for (int other = 0; other < index; ++other) {
+                pinWorker(other);
+            }
+            throw std::runtime_error("Cannot pin pool worker " + std::to_string(index) + ": " +
+                                     std::strerror(error));
+        }
+    }
+}
+
+bool ThreadPool::isPinned() const {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return !workerCpus.empty();
+}
+
+void ThreadPool::workerLoop(int index) {
+    currentWorkerIndex = index;
+    Trace::setThreadName("worker " + std::to_string(index));
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+namespace {
+
+// Shared state of one parallelFor call. Helpers hold it by shared_ptr so a
+// helper that is dequeued after the caller returned only sees an exhausted
+// counter and never touches the caller's stack.
+struct ParallelForJob {
+    std::function<void(int)> task;
+    int taskCount;
+    std::atomic<int> nextIndex{0};
+    std::atomic<int> completed{0};
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    std::exception_ptr firstError;
+    std::mutex errorMutex;
+
+    void drain() {
+        for (;;) {
+            int index = nextIndex.fetch_add(1);
+            if (index >= taskCount) {
+                return;
+            }
+            try {
+                BMP_TRACE_SCOPE(trace, "task", "scheduler", "index", index);
+                task(index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!firstError) firstError = std::current_exception();
+            }
+            if (completed.fetch_add(1) + 1 == taskCount) {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                doneCondition.notify_all();
+            }
+        }
+    }
+};
+
+// Pending ranges of one participant. The owner pushes and pops at the back,
+// where the most recent (smallest, still cached) split lies; thieves take
+// the front, where the largest ranges are. size mirrors ranges.size() so the
+// owner can see an empty deque without taking the lock.
+struct alignas(64) RangeDeque {
+    std::mutex mutex;
+    std::deque<std::pair<int, int>> ranges;
+    std::atomic<int> size{0};
+};
+
+// Shared state of one parallelForRange call, kept alive by its helpers
+struct StealingJob {
+    std::function<void(int, int)> body;
+    int grainSize = 1;
+    int participants = 1;
+    std::unique_ptr<RangeDeque[]> deques;
+    std::atomic<int> nextSlot{1};  // slot 0 is the caller's
+    bool stableSlots = false;      // slot from the worker index (pinned pools)
+    std::atomic<int> remaining{0};
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    std::exception_ptr firstError;
+    std::mutex errorMutex;
+
+    bool popOwn(int slot, std::pair<int, int>& range) {
+        auto& own = deques[slot];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.ranges.empty()) {
+            return false;
+        }
+        range = own.ranges.back();
+        own.ranges.pop_back();
+        own.size.store(static_cast<int>(own.ranges.size()), std::memory_order_relaxed);
+        return true;
+    }
+
+    bool steal(int slot, std::pair<int, int>& range) {
+        for (int offset = 1; offset < participants; ++offset) {
+            auto& victim = deques[(slot + offset) % participants];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.ranges.empty()) {
+                range = victim.ranges.front();
+                victim.ranges.pop_front();
+                victim.size.store(static_cast<int>(victim.ranges.size()), std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Hands the back half of range to thieves, but only while the own deque
+    // is empty: a range is split O(log(range / grain)) times as it drains
+    // rather than all the way down before any of it runs, and a thief that
+    // empties the deque finds the next half there one grain later.
+    void exposeHalf(int slot, std::pair<int, int>& range) {
+        auto& own = deques[slot];
+        if (range.second - range.first <= grainSize || own.size.load(std::memory_order_relaxed) > 0) {
+            return;
+        }
+        int middle = range.first + (range.second - range.first) / 2;
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.ranges.emplace_back(middle, range.second);
+        own.size.store(static_cast<int>(own.ranges.size()), std::memory_order_relaxed);
+        range.second = middle;
+    }
+
+    // Runs until a full sweep finds no pending range. Work not yet exposed
+    // is finished by its owner, so leaving early is safe.
+    void run(int slot) {
+        std::pair<int, int> range;
+        for (;;) {
+            [[maybe_unused]] bool stolen = false;
+            if (!popOwn(slot, range)) {
+                if (!steal(slot, range)) break;
+                stolen = true;
+            }
+            // One grain at a time from the front
+            while (range.first < range.second) {
+                exposeHalf(slot, range);
+                int end = std::min(range.first + grainSize, range.second);
+                try {
+                    BMP_TRACE_SCOPE(trace, stolen ? "stolen range" : "range", "scheduler", "first", range.first,
+                                    "last", end);
+                    body(range.first, end);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!firstError) firstError = std::current_exception();
+                }
+                int count = end - range.first;
+                range.first = end;
+                if (remaining.fetch_sub(count) == count) {
+                    std::lock_guard<std::mutex> lock(doneMutex);
+                    doneCondition.notify_all();
+                }
+            }
+        }
+    }
+};
+
+} // namespace
+
+void ThreadPool::parallelFor(int taskCount, int maxParallelism, const std::function<void(int)>& task) {
+    if (taskCount <= 0) {
+        return;
+    }
+
+    if (maxParallelism <= 0) {
+        maxParallelism = size() + 1;
+    }
+    int helpers = std::min(maxParallelism, taskCount) - 1;
+
+    if (helpers <= 0) {
+        for (int i = 0; i < taskCount; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    ensureWorkers(helpers);
+
+    auto job = std::make_shared<ParallelForJob>();
+    job->task = task;
+    job->taskCount = taskCount;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (int i = 0; i < helpers; ++i) {
+            tasks.emplace_back([job]() { job->drain(); });
+        }
+    }
+    if (helpers == 1) {
+        queueCondition.notify_one();
+    } else {
+        queueCondition.notify_all();
+    }
+
+    // The caller works too, then waits for chunks still running on helpers
+    job->drain();
+    {
+        std::unique_lock<std::mutex> lock(job->doneMutex);
+        job->doneCondition.wait(lock, [&job]() { return job->completed.load() == job->taskCount; });
+    }
+
+    if (job->firstError) {
+        std::rethrow_exception(job->firstError);
+    }
+}
+
+void ThreadPool::parallelForRange(int first, int last, int grainSize, int maxParallelism,
+                                  const std::function<void(int, int)>& body) {
+    int totalWork = last - first;
+    if (totalWork <= 0) {
+        return;
+    }
+
+    if (maxParallelism <= 0) {
+        maxParallelism = size() + 1;
+    }
+    int participants = std::max(1, std::min(maxParallelism, totalWork));
+    if (grainSize <= 0) {
+        grainSize = participants == 1 ? totalWork : std::max(1, totalWork / (participants * 8));
+    }
+
+    if (participants == 1) {
+        for (int begin = first; begin < last;) {
+            int end = begin + std::min(grainSize, last - begin);
+            BMP_TRACE_SCOPE(trace, "range", "scheduler", "first", begin, "last", end);
+            body(begin, end);
+            begin = end;
+        }
+        return;
+    }
+
+    ensureWorkers(participants - 1);
+
+    auto job = std::make_shared<StealingJob>();
+    job->body = body;
+    job->grainSize = grainSize;
+    job->participants = participants;
+    job->deques = std::make_unique<RangeDeque[]>(participants);
+    job->remaining.store(totalWork);
+    job->stableSlots = isPinned();
+    // Even initial slices; a helper that starts late simply has its slice stolen
+    for (int slot = 0; slot < participants; ++slot) {
+        int begin = first + static_cast<int>(static_cast<long long>(totalWork) * slot / participants);
+        int end = first + static_cast<int>(static_cast<long long>(totalWork) * (slot + 1) / participants);
+        job->deques[slot].ranges.emplace_back(begin, end);
+        job->deques[slot].size.store(1, std::memory_order_relaxed);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (int i = 1; i < participants; ++i) {
+            tasks.emplace_back([job]() {
+                // Pinned workers keep their slice across calls; two helpers
+                // may then share a deque, and an unserved slice is stolen
+                job->run(job->stableSlots && currentWorkerIndex >= 0
+                             ? 1 + currentWorkerIndex % (job->participants - 1)
+                             : job->nextSlot.fetch_add(1));
+            });
+        }
+    }
+    if (participants == 2) {
+        queueCondition.notify_one();
+    } else {
+        queueCondition.notify_all();
+    }
+
+    job->run(0);
+    {
+        std::unique_lock<std::mutex> lock(job->doneMutex);
+        job->doneCondition.wait(lock, [&job]() { return job->remaining.load() == 0; });
+    }
+
+    if (job->firstError) {
+        std::rethrow_exception(job->firstError);
+    }
+}
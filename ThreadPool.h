@@ -0,0 +1,101 @@
+/*
+   Persistent Thread Pool for Parallel Image Kernels
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+
+// Long-lived pool of worker threads. Workers are created once and stay
+// parked on a condition variable between calls, so parallel kernels pay
+// for a queue push instead of a thread spawn.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    mutable std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping;
+    // CPU of worker i is workerCpus[i % size]; empty when workers float
+    std::vector<int> workerCpus;
+
+    void workerLoop(int index);
+    // Apply workerCpus to worker index (caller holds queueMutex); returns an errno value
+    int pinWorker(int index);
+
+public:
+    // numThreads <= 0 means std::thread::hardware_concurrency()
+    explicit ThreadPool(int numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+    ThreadPool(ThreadPool&& other) = delete;
+    ThreadPool& operator=(ThreadPool&& other) = delete;
+
+    // Library-owned pool shared by every BMPImageOptimized without an injected pool
+    static std::shared_ptr<ThreadPool> sharedInstance();
+
+    int size() const;
+
+    // Grow the pool so that at least count workers exist (never shrinks)
+    void ensureWorkers(int count);
+
+    // Pin worker i (current and future) to cpus[i % cpus.size()], e.g. in
+    // NumaTopology::cpuOrder. An empty list lets workers float again. While
+    // pinned, parallelForRange hands the same slice to the same worker on
+    // every call, so pages first touched by a worker stay local to it.
+    // Throws std::runtime_error (leaving workers floating) if a CPU is unusable.
+    void pinWorkers(const std::vector<int>& cpus);
+    bool isPinned() const;
+
+    // Queue a single task and get a future for its result
+    template<typename F>
+    auto submit(F&& func) -> std::future<typename std::invoke_result<F>::type> {
+        using ResultType = typename std::invoke_result<F>::type;
+        auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(func));
+        std::future<ResultType> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (stopping) {
+                throw std::runtime_error("Cannot submit to a stopped thread pool");
+            }
+            tasks.emplace_back([task]() { (*task)(); });
+        }
+        queueCondition.notify_one();
+        return result;
+    }
+
+    // Run task(0) .. task(taskCount - 1) using at most maxParallelism threads.
+    // The calling thread takes part in the work, so nested calls from inside
+    // a pool task cannot deadlock. The first exception thrown is rethrown here.
+    void parallelFor(int taskCount, int maxParallelism, const std::function<void(int)>& task);
+
+    // Work-stealing loop over [first, last) using at most maxParallelism
+    // threads; body(begin, end) gets ranges of at most grainSize items
+    // (grainSize <= 0 picks about eight ranges per thread, or a single call
+    // when only one thread takes part). Every thread
+    // starts with an even slice in its own deque and runs it a grain at a
+    // time from the front; whenever its deque is empty it pushes the back
+    // half of what is left, and an idle thread steals the largest pending
+    // range of another. Same caller and exception rules as parallelFor.
+    void parallelForRange(int first, int last, int grainSize, int maxParallelism,
+                          const std::function<void(int, int)>& body);
+};
+
+#endif // THREADPOOL_H
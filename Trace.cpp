@@ -0,0 +1,209 @@
+/*
+   Hot-Path Tracing Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "Trace.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// One thread's ring. Only the owning thread writes events; written is
+// published with release so the exporter sees complete records.
+struct ThreadBuffer {
+    std::vector<Trace::Event> events;
+    std::atomic<uint64_t> written{0};
+    std::string threadName;
+    int trackId = 0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::set<std::string> names;    // node-based, so interned pointers stay valid
+    size_t eventsPerThread = Trace::DEFAULT_EVENTS_PER_THREAD;
+    int64_t originNs = 0;
+    int nextTrackId = 0;
+};
+
+Registry& registry() {
+    static Registry state;
+    return state;
+}
+
+// Bumped by start(); threads holding a buffer of an older trace register anew
+std::atomic<uint64_t> currentGeneration{1};
+
+thread_local std::shared_ptr<ThreadBuffer> localBuffer;
+thread_local uint64_t localGeneration = 0;
+thread_local std::string localThreadName;
+
+ThreadBuffer* threadBuffer() {
+    uint64_t generation = currentGeneration.load(std::memory_order_acquire);
+    if (localGeneration != generation || !localBuffer) {
+        auto buffer = std::make_shared<ThreadBuffer>();
+        auto& state = registry();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        buffer->events.resize(state.eventsPerThread);
+        buffer->trackId = state.nextTrackId++;
+        buffer->threadName = localThreadName.empty() ? "thread " + std::to_string(buffer->trackId)
+                                                     : localThreadName;
+        state.buffers.push_back(buffer);
+        localBuffer = std::move(buffer);
+        localGeneration = generation;
+    }
+    return localBuffer.get();
+}
+
+void writeJsonString(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c != '\0'; ++c) {
+        unsigned char byte = static_cast<unsigned char>(*c);
+        if (byte == '"' || byte == '\\') {
+            out << '\\' << *c;
+        } else if (byte < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(byte)
+                << std::dec << std::setfill(' ');
+        } else {
+            out << *c;
+        }
+    }
+    out << '"';
+}
+
+// Events of a buffer in recording order (the oldest may have been overwritten)
+std::vector<Trace::Event> bufferEvents(const ThreadBuffer& buffer) {
+    uint64_t written = buffer.written.load(std::memory_order_acquire);
+    size_t capacity = buffer.events.size();
+    size_t kept = static_cast<size_t>(std::min<uint64_t>(written, capacity));
+    std::vector<Trace::Event> events;
+    events.reserve(kept);
+    for (uint64_t i = written - kept; i < written; ++i) {
+        events.push_back(buffer.events[i % capacity]);
+    }
+    return events;
+}
+
+} // namespace
+
+void Trace::start(size_t eventsPerThread) {
+    if (eventsPerThread == 0) {
+        throw std::invalid_argument("Trace buffers need room for at least one event");
+    }
+    auto& state = registry();
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.buffers.clear();
+        state.eventsPerThread = eventsPerThread;
+        state.nextTrackId = 0;
+        state.originNs = now();
+    }
+    currentGeneration.fetch_add(1, std::memory_order_acq_rel);
+    recording.store(true, std::memory_order_relaxed);
+}
+
+void Trace::stop() {
+    recording.store(false, std::memory_order_relaxed);
+}
+
+void Trace::setThreadName(const std::string& name) {
+    localThreadName = name;
+    if (localBuffer && localGeneration == currentGeneration.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        localBuffer->threadName = name;
+    }
+}
+
+const char* Trace::intern(const std::string& text) {
+    auto& state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.names.insert(text).first->c_str();
+}
+
+void Trace::record(const Event& event) noexcept {
+    if (!isRecording()) {
+        return;
+    }
+    try {
+        ThreadBuffer* buffer = threadBuffer();
+        uint64_t index = buffer->written.load(std::memory_order_relaxed);
+        buffer->events[index % buffer->events.size()] = event;
+        buffer->written.store(index + 1, std::memory_order_release);
+    } catch (...) {
+        // Out of memory for a new buffer: the event is lost, the work is not
+    }
+}
+
+Trace::Stats Trace::stats() {
+    auto& state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    Stats result;
+    result.threads = state.buffers.size();
+    for (const auto& buffer : state.buffers) {
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        size_t kept = static_cast<size_t>(std::min<uint64_t>(written, buffer->events.size()));
+        result.events += kept;
+        result.dropped += static_cast<size_t>(written - kept);
+    }
+    return result;
+}
+
+void Trace::writeChromeJson(std::ostream& out) {
+    auto& state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]() {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+    out << std::fixed << std::setprecision(3);
+    for (const auto& buffer : state.buffers) {
+        separator();
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->trackId
+            << ",\"args\":{\"name\":";
+        writeJsonString(out, buffer->threadName.c_str());
+        out << "}}";
+        for (const Event& event : bufferEvents(*buffer)) {
+            separator();
+            out << "{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"cat\":";
+            writeJsonString(out, event.category);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->trackId
+                << ",\"ts\":" << (event.beginNs - state.originNs) / 1000.0
+                << ",\"dur\":" << (event.endNs - event.beginNs) / 1000.0;
+            if (event.argNames[0] != nullptr) {
+                out << ",\"args\":{";
+                for (int i = 0; i < 2 && event.argNames[i] != nullptr; ++i) {
+                    if (i > 0) out << ',';
+                    writeJsonString(out, event.argNames[i]);
+                    out << ':' << event.args[i];
+                }
+                out << '}';
+            }
+            out << '}';
+        }
+    }
+    out << "\n]}\n";
+}
+
+void Trace::writeChromeJson(const std::string& path) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot write trace: " + path);
+    }
+    writeChromeJson(file);
+    if (!file) {
+        throw std::runtime_error("Failed to write trace: " + path);
+    }
+}
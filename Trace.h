@@ -0,0 +1,128 @@
+/*
+   Hot-Path Tracing
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Timeline of loads, kernels, scheduler ranges and saves per thread. Each
+// thread appends complete events (begin and end in one record) to its own
+// ring buffer, so recording takes no lock; when a buffer is full the
+// oldest events are overwritten. Nothing is recorded until start(), and
+// building with -DNO_TRACE (make TRACE=0) turns every BMP_TRACE_SCOPE into
+// nothing. Export with writeChromeJson and open the file in
+// chrome://tracing or ui.perfetto.dev.
+//
+// Event names, categories and argument names must outlive the trace:
+// string literals, or intern() for names built at run time.
+class Trace {
+public:
+#ifdef NO_TRACE
+    static constexpr bool ENABLED = false;
+#else
+    static constexpr bool ENABLED = true;
+#endif
+    static constexpr size_t DEFAULT_EVENTS_PER_THREAD = 1 << 16;
+
+    struct Event {
+        const char* name;
+        const char* category;
+        const char* argNames[2];    // nullptr = unused
+        int64_t args[2];
+        int64_t beginNs;            // steady clock
+        int64_t endNs;
+    };
+
+    // Discards earlier events and records until stop()
+    static void start(size_t eventsPerThread = DEFAULT_EVENTS_PER_THREAD);
+    static void stop();
+    static bool isRecording() { return recording.load(std::memory_order_relaxed); }
+
+    // Label for this thread's track (e.g. "worker 3"); may be set before start()
+    static void setThreadName(const std::string& name);
+    // Stable copy of text for event names
+    static const char* intern(const std::string& text);
+
+    struct Stats {
+        size_t threads = 0;
+        size_t events = 0;      // kept in the ring buffers
+        size_t dropped = 0;     // overwritten because a buffer was full
+    };
+    static Stats stats();
+
+    // Chrome trace event format ("X" events in microseconds, one track per
+    // thread). Call once the traced work has finished. Throws
+    // std::runtime_error when the file cannot be written.
+    static void writeChromeJson(std::ostream& out);
+    static void writeChromeJson(const std::string& path);
+
+    // Records [construction, destruction) when recording was on at construction
+    class Scope {
+    public:
+        Scope(const char* name, const char* category) noexcept
+            : Scope(name, category, nullptr, 0, nullptr, 0) {}
+        Scope(const char* name, const char* category, const char* argName, int64_t arg) noexcept
+            : Scope(name, category, argName, arg, nullptr, 0) {}
+        Scope(const char* name, const char* category, const char* firstArgName, int64_t firstArg,
+              const char* secondArgName, int64_t secondArg) noexcept
+            : event{name, category, {firstArgName, secondArgName}, {firstArg, secondArg},
+                    isRecording() ? now() : 0, 0} {}
+        ~Scope() {
+            if (event.beginNs != 0) {
+                event.endNs = now();
+                record(event);
+            }
+        }
+        Scope(const Scope& other) = delete;
+        Scope& operator=(const Scope& other) = delete;
+
+        // Fills the first unused argument slot (ignored when both are taken)
+        void setArg(const char* argName, int64_t value) noexcept {
+            int slot = event.argNames[0] == nullptr ? 0 : 1;
+            if (event.argNames[slot] == nullptr) {
+                event.argNames[slot] = argName;
+                event.args[slot] = value;
+            }
+        }
+
+        // Names the event once it is known (e.g. a decision made inside the scope)
+        void setName(const char* name) noexcept { event.name = name; }
+
+    private:
+        Event event;
+    };
+
+private:
+    static inline std::atomic<bool> recording{false};
+
+    static int64_t now() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    static void record(const Event& event) noexcept;
+};
+
+// BMP_TRACE_SCOPE(variable, name, category[, argName, arg[, argName, arg]])
+// BMP_TRACE_ARG(variable, argName, value) adds an argument before the scope ends
+// BMP_TRACE_NAME(variable, name) renames the scope before it ends
+#ifdef NO_TRACE
+#define BMP_TRACE_SCOPE(variable, ...) do {} while (0)
+#define BMP_TRACE_ARG(variable, argName, value) ((void)(value))
+#define BMP_TRACE_NAME(variable, name) ((void)(name))
+#else
+#define BMP_TRACE_SCOPE(variable, ...) Trace::Scope variable(__VA_ARGS__)
+#define BMP_TRACE_ARG(variable, argName, value) variable.setArg(argName, value)
+#define BMP_TRACE_NAME(variable, name) variable.setName(name)
+#endif
+
+#endif // TRACE_H
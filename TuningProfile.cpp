@@ -0,0 +1,185 @@
+/*
+   Per-Host Kernel Tuning Profile Implementation
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include "TuningProfile.h"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+constexpr const char* SIZE_CLASS_NAMES[TuningProfile::SIZE_CLASS_COUNT] = {"small", "medium", "large", "huge"};
+constexpr TuningProfile::Kernel KERNELS[TuningProfile::KERNEL_COUNT] = {
+    TuningProfile::Kernel::Rotate, TuningProfile::Kernel::Gaussian3x3, TuningProfile::Kernel::GaussianBlur};
+
+struct ActiveProfile {
+    std::mutex mutex;
+    std::shared_ptr<const TuningProfile> profile;
+    bool loaded = false;
+};
+
+ActiveProfile& activeProfile() {
+    static ActiveProfile state;
+    return state;
+}
+
+} // namespace
+
+int TuningProfile::sizeClass(uint64_t pixels) {
+    if (pixels < uint64_t(256) * 256) return 0;
+    if (pixels < uint64_t(1024) * 1024) return 1;
+    if (pixels < uint64_t(4096) * 4096) return 2;
+    return 3;
+}
+
+const char* TuningProfile::sizeClassName(int sizeClass) {
+    if (sizeClass < 0 || sizeClass >= SIZE_CLASS_COUNT) {
+        throw std::invalid_argument("Size class out of range");
+    }
+    return SIZE_CLASS_NAMES[sizeClass];
+}
+
+const char* TuningProfile::kernelName(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Rotate: return "rotate";
+        case Kernel::Gaussian3x3: return "gaussian3x3";
+        default: return "blur";
+    }
+}
+
+const TuningProfile::Settings* TuningProfile::find(Kernel kernel, uint64_t pixels) const {
+    const Settings& settings = entries[static_cast<int>(kernel)][sizeClass(pixels)];
+    return settings.threads > 0 ? &settings : nullptr;
+}
+
+void TuningProfile::set(Kernel kernel, int sizeClass, const Settings& settings) {
+    if (sizeClass < 0 || sizeClass >= SIZE_CLASS_COUNT) {
+        throw std::invalid_argument("Size class out of range");
+    }
+    if (settings.threads <= 0 || settings.tileSize <= 0 || settings.chunksPerThread <= 0 ||
+        (settings.scheduler != "steal" && settings.scheduler != "openmp")) {
+        throw std::invalid_argument("Tuned settings need positive threads, tile and chunks and a known scheduler");
+    }
+    entries[static_cast<int>(kernel)][sizeClass] = settings;
+}
+
+bool TuningProfile::empty() const {
+    for (const auto& kernel : entries) {
+        for (const auto& settings : kernel) {
+            if (settings.threads > 0) return false;
+        }
+    }
+    return true;
+}
+
+TuningProfile TuningProfile::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open tuning profile: " + path);
+    }
+    TuningProfile profile;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string kernelField;
+        std::string classField;
+        Settings settings;
+        if (!(fields >> kernelField >> classField >> settings.threads >> settings.tileSize >>
+              settings.chunksPerThread >> settings.scheduler)) {
+            throw std::runtime_error("Malformed tuning profile line " + std::to_string(lineNumber) + ": " + path);
+        }
+        int kernelIndex = -1;
+        for (int i = 0; i < KERNEL_COUNT; ++i) {
+            if (kernelField == kernelName(KERNELS[i])) kernelIndex = i;
+        }
+        int classIndex = -1;
+        for (int i = 0; i < SIZE_CLASS_COUNT; ++i) {
+            if (classField == SIZE_CLASS_NAMES[i]) classIndex = i;
+        }
+        if (kernelIndex < 0 || classIndex < 0) {
+            throw std::runtime_error("Unknown kernel or size class on tuning profile line " +
+                                     std::to_string(lineNumber) + ": " + path);
+        }
+        try {
+            profile.set(KERNELS[kernelIndex], classIndex, settings);
+        } catch (const std::invalid_argument& e) {
+            throw std::runtime_error(std::string(e.what()) + " (tuning profile line " +
+                                     std::to_string(lineNumber) + ": " + path + ")");
+        }
+    }
+    return profile;
+}
+
+void TuningProfile::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot write tuning profile: " + path);
+    }
+    file << "# bmp_processor_optimized tuning profile (" << std::thread::hardware_concurrency()
+         << " hardware threads)\n";
+    file << "# kernel size-class threads tile-size chunks-per-thread scheduler\n";
+    for (int kernel = 0; kernel < KERNEL_COUNT; ++kernel) {
+        for (int sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; ++sizeClass) {
+            const Settings& settings = entries[kernel][sizeClass];
+            if (settings.threads <= 0) {
+                continue;
+            }
+            file << kernelName(KERNELS[kernel]) << ' ' << SIZE_CLASS_NAMES[sizeClass] << ' ' << settings.threads
+                 << ' ' << settings.tileSize << ' ' << settings.chunksPerThread << ' ' << settings.scheduler << '\n';
+        }
+    }
+    if (!file) {
+        throw std::runtime_error("Failed to write tuning profile: " + path);
+    }
+}
+
+std::string TuningProfile::defaultPath() {
+    if (const char* path = std::getenv("BMP_TUNING_PROFILE")) {
+        if (*path != '\0') return path;
+    }
+    const char* home = std::getenv("HOME");
+    return (home != nullptr && *home != '\0' ? std::string(home) + "/" : std::string()) + ".bmp_processor_tuning";
+}
+
+std::shared_ptr<const TuningProfile> TuningProfile::active() {
+    auto& state = activeProfile();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (!state.loaded) {
+        state.loaded = true;
+        std::string path = defaultPath();
+        std::error_code error;
+        if (std::filesystem::exists(path, error)) {
+            try {
+                state.profile = std::make_shared<TuningProfile>(load(path));
+            } catch (const std::exception& e) {
+                // A broken profile must not stop processing; defaults apply
+                std::cerr << "Ignoring tuning profile: " << e.what() << std::endl;
+            }
+        }
+        if (!state.profile) {
+            state.profile = std::make_shared<TuningProfile>();
+        }
+    }
+    return state.profile;
+}
+
+void TuningProfile::setActive(std::shared_ptr<const TuningProfile> profile) {
+    auto& state = activeProfile();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.profile = profile ? std::move(profile) : std::make_shared<TuningProfile>();
+    state.loaded = true;
+}
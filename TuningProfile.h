@@ -0,0 +1,67 @@
+/*
+   Per-Host Kernel Tuning Profile
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#ifndef TUNINGPROFILE_H
+#define TUNINGPROFILE_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Best measured settings per kernel and image size class on one host, as
+// written by --tune. BMPImageOptimized applies an entry whenever a caller
+// passes numThreads <= 0; untuned combinations keep the library defaults.
+//
+// The file is plain text, one entry per line:
+//   <kernel> <size-class> <threads> <tile-size> <chunks-per-thread> <scheduler>
+// e.g. "rotate large 3 64 4 steal". Lines starting with '#' are comments.
+class TuningProfile {
+public:
+    enum class Kernel {
+        Rotate,         // tiled rotation (also materialization of pending orientations)
+        Gaussian3x3,    // classic 3x3 filter, fused rotate + filter included
+        GaussianBlur    // separable radius/sigma filter
+    };
+    static constexpr int KERNEL_COUNT = 3;
+
+    // Pixel count bounds: small < 256^2 <= medium < 1024^2 <= large < 4096^2 <= huge
+    static constexpr int SIZE_CLASS_COUNT = 4;
+
+    struct Settings {
+        int threads = 0;            // 0 = entry not tuned
+        int tileSize = 0;           // rotation tile edge in pixels
+        int chunksPerThread = 0;    // work items per thread for strips and steal grain
+        std::string scheduler;      // "steal" or "openmp"
+    };
+
+    static int sizeClass(uint64_t pixels);
+    static const char* sizeClassName(int sizeClass);
+    static const char* kernelName(Kernel kernel);
+
+    // Entry for kernel on images of the given pixel count, or nullptr when untuned
+    const Settings* find(Kernel kernel, uint64_t pixels) const;
+    void set(Kernel kernel, int sizeClass, const Settings& settings);
+    bool empty() const;
+
+    // Throws std::runtime_error for unreadable or malformed files
+    static TuningProfile load(const std::string& path);
+    void save(const std::string& path) const;
+
+    // $BMP_TUNING_PROFILE, else ~/.bmp_processor_tuning (./ without HOME)
+    static std::string defaultPath();
+
+    // Profile used by images without an injected one: loaded from
+    // defaultPath() on first use, empty if the file does not exist
+    static std::shared_ptr<const TuningProfile> active();
+    static void setActive(std::shared_ptr<const TuningProfile> profile);
+
+private:
+    std::array<std::array<Settings, SIZE_CLASS_COUNT>, KERNEL_COUNT> entries;
+};
+
+#endif // TUNINGPROFILE_H
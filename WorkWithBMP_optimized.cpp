@@ -6,18 +6,89 @@
 */
 
 #include "WorkWithBMP_optimized.h"
+#include "ImageKernels.h"
+#include "MappedFile.h"
+#include "Trace.h"
 #include <iostream>
 #include <cstring>
 #include <iomanip>
 #include <numeric>
+#include <filesystem>
+
+namespace {
+
+std::atomic<int>& defaultSchedulerKind() {
+    static std::atomic<int> kind{static_cast<int>(BMPImageOptimized::Scheduler::WorkStealing)};
+    return kind;
+}
+
+std::atomic<bool>& numaFirstTouch() {
+    static std::atomic<bool> enabled{false};
+    return enabled;
+}
+
+} // namespace
 
 BMPImageOptimized::BMPImageOptimized() 
-    : width(0), height(0), bitsPerPixel(0), rowSize(0), dataSize(0), path("") {
+    : width(0), height(0), bitsPerPixel(0), rowSize(0), dataSize(0), path(""),
+      tileSize(ImageKernels::DEFAULT_TILE_SIZE), scheduler(defaultScheduler()), chunksPerThread(4),
+      inPlaceRotation(false),
+      lazyOrientation(false) {
     // Initialize headers with zeros
     std::memset(fileHeader, 0, FILE_HEADER_SIZE);
     std::memset(infoHeader, 0, INFO_HEADER_SIZE);
 }
 
+BMPImageOptimized::BMPImageOptimized(BMPImageOptimized&& other) noexcept
+    : width(other.width), height(other.height), bitsPerPixel(other.bitsPerPixel),
+      rowSize(other.rowSize), dataSize(other.dataSize), path(std::move(other.path)),
+      palette(std::move(other.palette)), mapping(std::move(other.mapping)),
+      totalOperations(other.totalOperations.load()), parallelOperations(other.parallelOperations.load()),
+      decisionCounts{other.decisionCounts[0].load(), other.decisionCounts[1].load(), other.decisionCounts[2].load()},
+      lastDecision(other.getLastDecision()), costModel(std::move(other.costModel)),
+      threadPool(std::move(other.threadPool)), asyncIO(std::move(other.asyncIO)),
+      framePool(std::move(other.framePool)), tileSize(other.tileSize), scheduler(other.scheduler),
+      chunksPerThread(other.chunksPerThread), tuningProfile(std::move(other.tuningProfile)), inPlaceRotation(other.inPlaceRotation), lazyOrientation(other.lazyOrientation) {
+    std::memcpy(fileHeader, other.fileHeader, FILE_HEADER_SIZE);
+    std::memcpy(infoHeader, other.infoHeader, INFO_HEADER_SIZE);
+}
+
+BMPImageOptimized& BMPImageOptimized::operator=(BMPImageOptimized&& other) noexcept {
+    if (this != &other) {
+        std::memcpy(fileHeader, other.fileHeader, FILE_HEADER_SIZE);
+        std::memcpy(infoHeader, other.infoHeader, INFO_HEADER_SIZE);
+        width = other.width;
+        height = other.height;
+        bitsPerPixel = other.bitsPerPixel;
+        rowSize = other.rowSize;
+        dataSize = other.dataSize;
+        path = std::move(other.path);
+        palette = std::move(other.palette);
+        mapping = std::move(other.mapping);
+        totalOperations.store(other.totalOperations.load());
+        parallelOperations.store(other.parallelOperations.load());
+        for (int mode = 0; mode < 3; ++mode) {
+            decisionCounts[mode].store(other.decisionCounts[mode].load());
+        }
+        {
+            auto decision = other.getLastDecision();
+            std::lock_guard<std::mutex> lock(decisionMutex);
+            lastDecision = decision;
+        }
+        costModel = std::move(other.costModel);
+        threadPool = std::move(other.threadPool);
+        asyncIO = std::move(other.asyncIO);
+        framePool = std::move(other.framePool);
+        tileSize = other.tileSize;
+        scheduler = other.scheduler;
+        chunksPerThread = other.chunksPerThread;
+        tuningProfile = std::move(other.tuningProfile);
+        inPlaceRotation = other.inPlaceRotation;
+        lazyOrientation = other.lazyOrientation;
+    }
+    return *this;
+}
+
 void BMPImageOptimized::readHeaders(std::ifstream& file) {
     if (!file.is_open()) {
         throw std::runtime_error("File is not open");
@@ -35,6 +106,10 @@ void BMPImageOptimized::readHeaders(std::ifstream& file) {
         throw std::runtime_error("Failed to read info header");
     }
     
+    extractImageProperties();
+}
+
+void BMPImageOptimized::extractImageProperties() {
     // Extract image properties
     width = *reinterpret_cast<int*>(&infoHeader[4]);
     height = *reinterpret_cast<int*>(&infoHeader[8]);
@@ -42,7 +117,7 @@ void BMPImageOptimized::readHeaders(std::ifstream& file) {
     
     // Calculate derived properties
     rowSize = calculateRowSize(width, bitsPerPixel);
-    dataSize = rowSize * height;
+    dataSize = rowSize * static_cast<size_t>(height);
     
     // Validate image properties
     validateImage();
@@ -60,11 +135,20 @@ void BMPImageOptimized::writeHeaders(std::ofstream& file) {
     file.write(reinterpret_cast<const char*>(infoHeader), INFO_HEADER_SIZE);
 }
 
-int BMPImageOptimized::calculateRowSize(int width, int bpp) {
-    // Calculate row size with padding (must be multiple of 4)
-    int bytesPerPixel = bpp / 8;
-    int rowSize = width * bytesPerPixel;
-    return (rowSize + 3) & ~3; // Round up to nearest multiple of 4
+size_t BMPImageOptimized::calculateRowSize(int width, int bpp) {
+    // Row size with padding (multiple of 4), in 64-bit arithmetic
+    return ImageKernels::bmpRowStride(width, bpp);
+}
+
+void BMPImageOptimized::setGeometry(const ImageKernels::ImageDescriptor& desc) {
+    width = desc.width;
+    height = desc.height;
+    rowSize = desc.stride;
+    dataSize = desc.dataSize();
+}
+
+ImageKernels::ImageDescriptor BMPImageOptimized::getDescriptor() const {
+    return ImageKernels::ImageDescriptor{width, height, rowSize, bitsPerPixel};
 }
 
 void BMPImageOptimized::validateImage() {
@@ -76,13 +160,34 @@ void BMPImageOptimized::validateImage() {
         throw std::runtime_error("Unsupported bits per pixel: " + std::to_string(bitsPerPixel));
     }
     
-    if (dataSize <= 0) {
+    if (dataSize == 0) {
         throw std::runtime_error("Invalid data size");
     }
 }
 
-void BMPImageOptimized::loadFromFile(const std::string& filename) {
+void BMPImageOptimized::loadFromFile(const std::string& filename, LoadMode mode) {
     path = filename;
+    mapping.reset();
+    
+    if (mode == LoadMode::Mapped) {
+        auto mapped = std::make_shared<MappedFile>(filename);
+        if (mapped->size() < static_cast<size_t>(FILE_HEADER_SIZE + INFO_HEADER_SIZE)) {
+            throw std::runtime_error("Failed to read file header");
+        }
+        std::memcpy(fileHeader, mapped->data(), FILE_HEADER_SIZE);
+        std::memcpy(infoHeader, mapped->data() + FILE_HEADER_SIZE, INFO_HEADER_SIZE);
+        extractImageProperties();
+        
+        int dataOffset = *reinterpret_cast<const int*>(&fileHeader[10]);
+        if (dataOffset < FILE_HEADER_SIZE + INFO_HEADER_SIZE ||
+            mapped->size() < static_cast<size_t>(dataOffset) + static_cast<size_t>(dataSize)) {
+            throw std::runtime_error("Failed to read complete image data");
+        }
+        palette.assign(mapped->data() + FILE_HEADER_SIZE + INFO_HEADER_SIZE, mapped->data() + dataOffset);
+        mapping = std::move(mapped);
+        return;
+    }
+    
     std::ifstream file(filename, std::ios::binary);
     if (!file.is_open()) {
         throw std::runtime_error("Cannot open file: " + filename);
@@ -90,6 +195,15 @@ void BMPImageOptimized::loadFromFile(const std::string& filename) {
     
     try {
         readHeaders(file);
+        
+        // Keep the palette (extra header bytes) in memory so saving never reopens the source
+        int dataOffset = *reinterpret_cast<const int*>(&fileHeader[10]);
+        int paletteSize = std::max(0, dataOffset - FILE_HEADER_SIZE - INFO_HEADER_SIZE);
+        palette.resize(paletteSize);
+        file.read(reinterpret_cast<char*>(palette.data()), paletteSize);
+        if (file.gcount() != paletteSize) {
+            throw std::runtime_error("Failed to read palette");
+        }
     } catch (const std::exception& e) {
         file.close();
         throw;
@@ -98,47 +212,44 @@ void BMPImageOptimized::loadFromFile(const std::string& filename) {
     file.close();
 }
 
+BMPImageOptimized::PixelView BMPImageOptimized::getPixelView() const {
+    if (!mapping) {
+        throw std::runtime_error("Pixel view requires an image loaded with LoadMode::Mapped");
+    }
+    int dataOffset = *reinterpret_cast<const int*>(&fileHeader[10]);
+    return PixelView{mapping->data() + dataOffset, static_cast<size_t>(dataSize)};
+}
+
 void BMPImageOptimized::setPath(const std::string& filepath) {
     path = filepath;
 }
 
-void BMPImageOptimized::saveToFile(const std::string& filename, const std::vector<unsigned char>& imageData) {
-    if (imageData.size() != static_cast<size_t>(dataSize)) {
-        throw std::runtime_error("Image data size mismatch");
-    }
-    
-    // Create new headers for the current dimensions
-    unsigned char newFileHeader[FILE_HEADER_SIZE];
-    unsigned char newInfoHeader[INFO_HEADER_SIZE];
+std::vector<unsigned char> BMPImageOptimized::bitmapPrefix(const unsigned char* fileHeaderBytes,
+                                                           const unsigned char* infoHeaderBytes,
+                                                           const std::vector<unsigned char>& paletteBytes,
+                                                           const ImageKernels::ImageDescriptor& desc) {
+    std::vector<unsigned char> prefix(FILE_HEADER_SIZE + INFO_HEADER_SIZE + paletteBytes.size());
+    unsigned char* newFileHeader = prefix.data();
+    unsigned char* newInfoHeader = prefix.data() + FILE_HEADER_SIZE;
     
     // Copy original headers
-    std::memcpy(newFileHeader, fileHeader, FILE_HEADER_SIZE);
-    std::memcpy(newInfoHeader, infoHeader, INFO_HEADER_SIZE);
-    
-    // Calculate palette size
-    int dataOffset = *reinterpret_cast<const int*>(&fileHeader[10]);
-    int paletteSize = dataOffset - FILE_HEADER_SIZE - INFO_HEADER_SIZE;
-    
-    // Update file size in header (including palette)
-    int fileSize = FILE_HEADER_SIZE + INFO_HEADER_SIZE + paletteSize + dataSize;
-    newFileHeader[2] = fileSize & 0xFF;
-    newFileHeader[3] = (fileSize >> 8) & 0xFF;
-    newFileHeader[4] = (fileSize >> 16) & 0xFF;
-    newFileHeader[5] = (fileSize >> 24) & 0xFF;
+    std::memcpy(newFileHeader, fileHeaderBytes, FILE_HEADER_SIZE);
+    std::memcpy(newInfoHeader, infoHeaderBytes, INFO_HEADER_SIZE);
     
-    // Update data offset
-    int newDataOffset = FILE_HEADER_SIZE + INFO_HEADER_SIZE + paletteSize;
-    *reinterpret_cast<int*>(&newFileHeader[10]) = newDataOffset;
+    // Sizes, offset, dimensions and compression = 0 for the current geometry
+    ImageKernels::writeBmpGeometry(newFileHeader, newInfoHeader, desc, paletteBytes.size());
     
-    // Update width and height in info header
-    *reinterpret_cast<int*>(&newInfoHeader[4]) = width;
-    *reinterpret_cast<int*>(&newInfoHeader[8]) = height;
-    
-    // Update image size in info header
-    *reinterpret_cast<int*>(&newInfoHeader[20]) = dataSize;
-    
-    // Update compression (0 = no compression)
-    *reinterpret_cast<int*>(&newInfoHeader[16]) = 0;
+    // Palette (and any extended header bytes) captured at load time
+    std::copy(paletteBytes.begin(), paletteBytes.end(), prefix.begin() + FILE_HEADER_SIZE + INFO_HEADER_SIZE);
+    return prefix;
+}
+
+void BMPImageOptimized::writeBitmap(const std::string& filename, const unsigned char* fileHeaderBytes,
+                                    const unsigned char* infoHeaderBytes,
+                                    const std::vector<unsigned char>& paletteBytes,
+                                    const ImageKernels::ImageDescriptor& desc, const unsigned char* pixels) {
+    BMP_TRACE_SCOPE(trace, "save", "io", "bytes", static_cast<int64_t>(desc.dataSize()));
+    std::vector<unsigned char> prefix = bitmapPrefix(fileHeaderBytes, infoHeaderBytes, paletteBytes, desc);
     
     std::ofstream file(filename, std::ios::binary);
     if (!file.is_open()) {
@@ -146,24 +257,14 @@ void BMPImageOptimized::saveToFile(const std::string& filename, const std::vecto
     }
     
     try {
-        // Write updated headers
-        file.write(reinterpret_cast<const char*>(newFileHeader), FILE_HEADER_SIZE);
-        file.write(reinterpret_cast<const char*>(newInfoHeader), INFO_HEADER_SIZE);
-        
-        // Write palette if it exists
-        if (paletteSize > 0) {
-            std::ifstream originalFile(path, std::ios::binary);
-            if (originalFile.is_open()) {
-                originalFile.seekg(FILE_HEADER_SIZE + INFO_HEADER_SIZE);
-                std::vector<unsigned char> palette(paletteSize);
-                originalFile.read(reinterpret_cast<char*>(palette.data()), paletteSize);
-                file.write(reinterpret_cast<const char*>(palette.data()), paletteSize);
-                originalFile.close();
-            }
-        }
+        // Write updated headers and palette
+        file.write(reinterpret_cast<const char*>(prefix.data()), static_cast<std::streamsize>(prefix.size()));
         
         // Write image data
-        file.write(reinterpret_cast<const char*>(imageData.data()), dataSize);
+        file.write(reinterpret_cast<const char*>(pixels), static_cast<std::streamsize>(desc.dataSize()));
+        if (!file) {
+            throw std::runtime_error("Failed to write image data: " + filename);
+        }
     } catch (const std::exception& e) {
         file.close();
         throw;
@@ -172,7 +273,123 @@ void BMPImageOptimized::saveToFile(const std::string& filename, const std::vecto
     file.close();
 }
 
+void BMPImageOptimized::saveToFile(const std::string& filename, const std::vector<unsigned char>& imageData) {
+    if (imageData.size() != static_cast<size_t>(dataSize)) {
+        throw std::runtime_error("Image data size mismatch");
+    }
+    writeBitmap(filename, fileHeader, infoHeader, palette, getDescriptor(), imageData.data());
+}
+
+void BMPImageOptimized::saveToFile(const std::string& filename, const BMPFrame& frame) {
+    if (frame.empty()) {
+        throw std::runtime_error("Cannot save an empty frame");
+    }
+    if (frame.isOriented()) {
+        // The pending permutation doubles as the copy into the file
+        BMP_TRACE_SCOPE(trace, "save oriented", "io", "bytes", static_cast<int64_t>(frame.size()));
+        size_t pixelOffset = 0;
+        auto output = createMappedOutput(filename, frame, frame.getLogicalDescriptor(), pixelOffset);
+        orientInto(frame.data(), frame.getDescriptor(), output->writableData() + pixelOffset,
+                   frame.getOrientation(), callSettings(1));
+        return;
+    }
+    writeBitmap(filename, frame.getFileHeader(), frame.getInfoHeader(), frame.getPalette(),
+                frame.getDescriptor(), frame.data());
+}
+
+std::future<void> BMPImageOptimized::saveToFileAsync(const std::string& filename, const BMPFrame& frame) {
+    if (frame.empty()) {
+        throw std::runtime_error("Cannot save an empty frame");
+    }
+    // The request owns the header bytes and a shared copy of the frame
+    struct PendingSave {
+        std::vector<unsigned char> prefix;
+        BMPFrame frame;
+    };
+    auto pendingSave = std::make_shared<PendingSave>();
+    pendingSave->prefix = bitmapPrefix(frame.getFileHeader(), frame.getInfoHeader(), frame.getPalette(),
+                                       frame.getLogicalDescriptor());
+    pendingSave->frame = frame;
+    // A pending orientation is applied to the request's copy (one pass into
+    // a pooled buffer) so the write itself can still be queued
+    materializeFrame(pendingSave->frame, callSettings(1));
+    
+    std::vector<AsyncIO::Segment> segments = {
+        {pendingSave->prefix.data(), pendingSave->prefix.size()},
+        {pendingSave->frame.data(), pendingSave->frame.size()}
+    };
+    return getAsyncIO()->writeFile(filename, std::move(segments), pendingSave);
+}
+
+std::future<BMPFrame> BMPImageOptimized::loadFrameAsync(const std::string& filename) {
+    loadFromFile(filename, LoadMode::Buffered);
+    
+    struct PendingLoad {
+        unsigned char fileHeader[FILE_HEADER_SIZE];
+        unsigned char infoHeader[INFO_HEADER_SIZE];
+        std::vector<unsigned char> palette;
+        std::shared_ptr<unsigned char> pixels;
+        std::promise<BMPFrame> result;
+    };
+    auto pendingLoad = std::make_shared<PendingLoad>();
+    std::memcpy(pendingLoad->fileHeader, fileHeader, FILE_HEADER_SIZE);
+    std::memcpy(pendingLoad->infoHeader, infoHeader, INFO_HEADER_SIZE);
+    pendingLoad->palette = palette;
+    pendingLoad->pixels = getFramePool()->acquire(dataSize);
+    std::future<BMPFrame> frame = pendingLoad->result.get_future();
+    
+    uint64_t dataOffset = static_cast<uint64_t>(*reinterpret_cast<const int*>(&fileHeader[10]));
+    getAsyncIO()->submitRead(path, dataOffset, pendingLoad->pixels.get(), dataSize,
+                             [pendingLoad](std::exception_ptr error) {
+        try {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            pendingLoad->result.set_value(BMPFrame(pendingLoad->fileHeader, pendingLoad->infoHeader,
+                                                   std::move(pendingLoad->palette),
+                                                   std::move(pendingLoad->pixels)));
+        } catch (...) {
+            pendingLoad->result.set_exception(std::current_exception());
+        }
+    });
+    return frame;
+}
+
+BMPFrame BMPImageOptimized::loadFrame(const std::string& filename, LoadMode mode) {
+    BMP_TRACE_SCOPE(trace, "load", "io");
+    loadFromFile(filename, mode);
+    BMP_TRACE_ARG(trace, "bytes", static_cast<int64_t>(dataSize));
+    if (mapping) {
+        size_t dataOffset = static_cast<size_t>(*reinterpret_cast<const int*>(&fileHeader[10]));
+        return BMPFrame(fileHeader, infoHeader, palette, mapping, dataOffset);
+    }
+    // Pixels go straight into a pooled buffer, with room for the wider
+    // rotated layout when rotations run in place
+    size_t bufferSize = inPlaceRotation ? inPlaceRotationSize(getDescriptor()) : dataSize;
+    auto pixels = getFramePool()->acquire(bufferSize);
+    prepareDestination(pixels.get(), getDescriptor(), callSettings(0));
+    readPixels(pixels.get());
+    return BMPFrame(fileHeader, infoHeader, palette, std::move(pixels), FramePool::sizeClass(bufferSize));
+}
+
 std::vector<unsigned char> BMPImageOptimized::getImageData() const {
+    if (mapping) {
+        PixelView view = getPixelView();
+        return std::vector<unsigned char>(view.data, view.data + view.size);
+    }
+    
+    std::vector<unsigned char> data;
+    if (inPlaceRotation) {
+        // Lets rotateVectorInPlace grow to the rotated layout without reallocating
+        data.reserve(inPlaceRotationSize(getDescriptor()));
+    }
+    data.resize(dataSize);
+    readPixels(data.data());
+    return data;
+}
+
+void BMPImageOptimized::readPixels(unsigned char* dest) const {
+    BMP_TRACE_SCOPE(trace, "read pixels", "io", "bytes", static_cast<int64_t>(dataSize));
     std::ifstream file(path, std::ios::binary);
     if (!file.is_open()) {
         throw std::runtime_error("Cannot open file for reading data");
@@ -184,15 +401,13 @@ std::vector<unsigned char> BMPImageOptimized::getImageData() const {
     // Skip to data offset
     file.seekg(dataOffset);
     
-    std::vector<unsigned char> data(dataSize);
-    file.read(reinterpret_cast<char*>(data.data()), dataSize);
+    file.read(reinterpret_cast<char*>(dest), static_cast<std::streamsize>(dataSize));
     
-    if (file.gcount() != dataSize) {
+    if (static_cast<size_t>(file.gcount()) != dataSize) {
         throw std::runtime_error("Failed to read complete image data");
     }
     
     file.close();
-    return data;
 }
 
 // Sequential implementations (same as original)
@@ -204,12 +419,12 @@ void BMPImageOptimized::rotateClockwise(std::vector<unsigned char>& imageData) {
     int bytesPerPixel = bitsPerPixel / 8;
     int oldWidth = width;
     int oldHeight = height;
-    int oldRowSize = rowSize;
+    size_t oldRowSize = rowSize;
     
     // Update dimensions first
     std::swap(width, height);
     rowSize = calculateRowSize(width, bitsPerPixel);
-    dataSize = rowSize * height;
+    dataSize = rowSize * static_cast<size_t>(height);
     
     // Create new data with proper padding
     std::vector<unsigned char> newData(dataSize, 0);
@@ -240,12 +455,12 @@ void BMPImageOptimized::rotateCounterClockwise(std::vector<unsigned char>& image
     int bytesPerPixel = bitsPerPixel / 8;
     int oldWidth = width;
     int oldHeight = height;
-    int oldRowSize = rowSize;
+    size_t oldRowSize = rowSize;
     
     // Update dimensions first
     std::swap(width, height);
     rowSize = calculateRowSize(width, bitsPerPixel);
-    dataSize = rowSize * height;
+    dataSize = rowSize * static_cast<size_t>(height);
     
     // Create new data with proper padding
     std::vector<unsigned char> newData(dataSize, 0);
@@ -273,60 +488,58 @@ void BMPImageOptimized::applyGaussianFilter(std::vector<unsigned char>& imageDat
         throw std::runtime_error("Image data size mismatch for filtering");
     }
     
-    // Gaussian kernel 3x3
-    const float kernel[3][3] = {
-        {1.0f/16, 2.0f/16, 1.0f/16},
-        {2.0f/16, 4.0f/16, 2.0f/16},
-        {1.0f/16, 2.0f/16, 1.0f/16}
-    };
+    // Apply filter to inner pixels only, in place as one strip (see ImageKernels)
+    runGaussian3x3(imageData.data(), imageData.data(), getDescriptor(), callSettings(1));
     
-    int bytesPerPixel = bitsPerPixel / 8;
-    std::vector<unsigned char> filtered(dataSize);
-    
-    // Copy original data to filtered
-    std::copy(imageData.begin(), imageData.end(), filtered.begin());
-    
-    // Apply filter to inner pixels only
-    for (int y = 1; y < height - 1; ++y) {
-        for (int x = 1; x < width - 1; ++x) {
-            for (int c = 0; c < bytesPerPixel; ++c) {
-                float sum = 0.0f;
-                
-                for (int ky = 0; ky < 3; ++ky) {
-                    for (int kx = 0; kx < 3; ++kx) {
-                        int px = x + kx - 1;
-                        int py = y + ky - 1;
-                        sum += kernel[ky][kx] * imageData[py * rowSize + px * bytesPerPixel + c];
-                    }
-                }
-                
-                // Clamp to valid range
-                filtered[y * rowSize + x * bytesPerPixel + c] = 
-                    static_cast<unsigned char>(std::max(0.0f, std::min(255.0f, sum)));
-            }
-        }
+    totalOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::rotateClockwise(const PixelView& source, std::vector<unsigned char>& result) {
+    if (source.size != static_cast<size_t>(dataSize)) {
+        throw std::runtime_error("Image data size mismatch for rotation");
     }
-    
-    imageData = std::move(filtered);
+    auto sourceDesc = getDescriptor();
+    rotateTiled(source.data, sourceDesc, result, callSettings(1), true);
+    setGeometry(ImageKernels::rotatedDescriptor(sourceDesc));
+    totalOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::rotateCounterClockwise(const PixelView& source, std::vector<unsigned char>& result) {
+    if (source.size != static_cast<size_t>(dataSize)) {
+        throw std::runtime_error("Image data size mismatch for rotation");
+    }
+    auto sourceDesc = getDescriptor();
+    rotateTiled(source.data, sourceDesc, result, callSettings(1), false);
+    setGeometry(ImageKernels::rotatedDescriptor(sourceDesc));
+    totalOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::applyGaussianFilter(const PixelView& source, std::vector<unsigned char>& result) {
+    if (source.size != static_cast<size_t>(dataSize)) {
+        throw std::runtime_error("Image data size mismatch for filtering");
+    }
+    result.resize(dataSize);
+    runGaussian3x3(source.data, result.data(), getDescriptor(), callSettings(1));
     totalOperations.fetch_add(1);
 }
 
 // Optimized parallel implementations
 
-int BMPImageOptimized::calculateOptimalChunkSize(int totalWork, int numThreads) const {
+int BMPImageOptimized::calculateOptimalChunkSize(int totalWork, const CallSettings& call) {
     // Calculate optimal chunk size based on work size and number of threads
     int minChunkSize = 1;
-    int maxChunkSize = totalWork / numThreads;
+    int maxChunkSize = totalWork / call.threads;
     
     // Ensure chunk size is not too small (avoid overhead) or too large (poor load balancing)
-    int optimalChunkSize = std::max(minChunkSize, std::min(maxChunkSize, totalWork / (numThreads * 4)));
+    int optimalChunkSize = std::max(minChunkSize,
+                                    std::min(maxChunkSize, totalWork / (call.threads * call.chunksPerThread)));
     
     return optimalChunkSize;
 }
 
-std::vector<std::pair<int, int>> BMPImageOptimized::createWorkChunks(int totalWork, int numThreads) const {
+std::vector<std::pair<int, int>> BMPImageOptimized::createWorkChunks(int totalWork, const CallSettings& call) {
     std::vector<std::pair<int, int>> chunks;
-    int chunkSize = calculateOptimalChunkSize(totalWork, numThreads);
+    int chunkSize = calculateOptimalChunkSize(totalWork, call);
     
     for (int i = 0; i < totalWork; i += chunkSize) {
         int end = std::min(i + chunkSize, totalWork);
@@ -336,254 +549,1156 @@ std::vector<std::pair<int, int>> BMPImageOptimized::createWorkChunks(int totalWo
     return chunks;
 }
 
-void BMPImageOptimized::processChunkClockwise(const std::vector<unsigned char>& source, 
-                                             std::vector<unsigned char>& dest,
-                                             int startY, int endY, int oldWidth, int /* oldHeight */,
-                                             int oldRowSize, int bytesPerPixel) {
-    for (int y = startY; y < endY; ++y) {
-        for (int x = 0; x < oldWidth; ++x) {
-            for (int c = 0; c < bytesPerPixel; ++c) {
-                int newX = y;
-                int newY = oldWidth - 1 - x;
-                if (newX < width && newY < height) {
-                    dest[newY * rowSize + newX * bytesPerPixel + c] = 
-                        source[y * oldRowSize + x * bytesPerPixel + c];
-                }
-            }
+int BMPImageOptimized::resolveThreadCount(int numThreads) const {
+    if (numThreads <= 0) {
+        numThreads = std::thread::hardware_concurrency();
+        if (numThreads == 0) numThreads = 4; // fallback
+    }
+    return numThreads;
+}
+
+BMPImageOptimized::CallSettings BMPImageOptimized::CallSettings::limitedTo(int maxThreads) const {
+    CallSettings limited = *this;
+    limited.threads = std::max(1, std::min(threads, maxThreads));
+    return limited;
+}
+
+BMPImageOptimized::CallSettings BMPImageOptimized::callSettings(int numThreads) const {
+    return CallSettings{resolveThreadCount(numThreads), tileSize, chunksPerThread, scheduler};
+}
+
+BMPImageOptimized::CallSettings BMPImageOptimized::tunedCall(TuningProfile::Kernel kernel,
+                                                             const ImageKernels::ImageDescriptor& desc,
+                                                             int numThreads) const {
+    auto call = callSettings(numThreads);
+    if (numThreads > 0) {
+        return call;
+    }
+    auto profile = getTuningProfile();
+    const auto* settings = profile->find(kernel, static_cast<uint64_t>(desc.width) * static_cast<uint64_t>(desc.height));
+    if (settings == nullptr) {
+        return call;
+    }
+    call.threads = settings->threads;
+    call.tileSize = settings->tileSize;
+    call.chunksPerThread = settings->chunksPerThread;
+#ifdef _OPENMP
+    call.scheduler = parseScheduler(settings->scheduler);
+#endif
+    return call;
+}
+
+TuningProfile::Kernel BMPImageOptimized::filterKernel(int radius, double sigma) {
+    return radius == 1 && sigma <= 0.0 ? TuningProfile::Kernel::Gaussian3x3 : TuningProfile::Kernel::GaussianBlur;
+}
+
+CostModel::Decision BMPImageOptimized::planCall(CostModel::Operation operation, TuningProfile::Kernel kernel,
+                                                const ImageKernels::ImageDescriptor& desc, int maxThreads,
+                                                double workScale) {
+    // Covers the estimate; named after the mode once it is decided
+    BMP_TRACE_SCOPE(trace, "plan", "cutover");
+    auto model = getCostModel();
+    auto decision = model->decide(operation, desc, resolveThreadCount(maxThreads), workScale);
+    // A measured setting beats the estimate
+    auto profile = getTuningProfile();
+    if (const auto* settings = profile->find(kernel, decision.pixels)) {
+        decision.threads = std::min(settings->threads, decision.maxThreads);
+        decision.mode = CostModel::modeFor(decision.threads, decision.maxThreads);
+        decision.estimatedMicroseconds = model->estimateMicroseconds(operation, decision.workingSetBytes,
+                                                                     decision.threads, workScale);
+        decision.fromProfile = true;
+    }
+    
+    decisionCounts[static_cast<int>(decision.mode)].fetch_add(1);
+    BMP_TRACE_NAME(trace, CostModel::modeName(decision.mode));
+    BMP_TRACE_ARG(trace, "threads", decision.threads);
+    BMP_TRACE_ARG(trace, "estimated us", static_cast<int64_t>(decision.estimatedMicroseconds));
+    std::lock_guard<std::mutex> lock(decisionMutex);
+    lastDecision = decision;
+    return decision;
+}
+
+void BMPImageOptimized::setCostModel(std::shared_ptr<const CostModel> model) {
+    costModel = std::move(model);
+}
+
+std::shared_ptr<const CostModel> BMPImageOptimized::getCostModel() const {
+    return costModel ? costModel : CostModel::sharedInstance();
+}
+
+void BMPImageOptimized::setChunksPerThread(int chunks) {
+    if (chunks <= 0) {
+        throw std::invalid_argument("Chunks per thread must be positive");
+    }
+    chunksPerThread = chunks;
+}
+
+void BMPImageOptimized::setTuningProfile(std::shared_ptr<const TuningProfile> profile) {
+    tuningProfile = std::move(profile);
+}
+
+std::shared_ptr<const TuningProfile> BMPImageOptimized::getTuningProfile() const {
+    return tuningProfile ? tuningProfile : TuningProfile::active();
+}
+
+void BMPImageOptimized::setThreadPool(std::shared_ptr<ThreadPool> pool) {
+    threadPool = std::move(pool);
+}
+
+std::shared_ptr<ThreadPool> BMPImageOptimized::getThreadPool() const {
+    return threadPool ? threadPool : ThreadPool::sharedInstance();
+}
+
+void BMPImageOptimized::setAsyncIO(std::shared_ptr<AsyncIO> io) {
+    asyncIO = std::move(io);
+}
+
+std::shared_ptr<AsyncIO> BMPImageOptimized::getAsyncIO() const {
+    return asyncIO ? asyncIO : AsyncIO::sharedInstance();
+}
+
+void BMPImageOptimized::setFramePool(std::shared_ptr<FramePool> pool) {
+    framePool = std::move(pool);
+}
+
+std::shared_ptr<FramePool> BMPImageOptimized::getFramePool() const {
+    return framePool ? framePool : FramePool::sharedInstance();
+}
+
+void BMPImageOptimized::parallelForRows(int first, int last, const CallSettings& call,
+                                        const std::function<void(int, int)>& body) {
+    int totalWork = last - first;
+    if (totalWork <= 0) {
+        return;
+    }
+    
+#ifdef _OPENMP
+    if (call.scheduler == Scheduler::OpenMP) {
+        #pragma omp parallel for num_threads(call.threads) schedule(dynamic)
+        for (int y = first; y < last; ++y) {
+            BMP_TRACE_SCOPE(trace, "range", "scheduler", "first", y, "last", y + 1);
+            body(y, y + 1);
         }
+        return;
     }
+#endif
+    // Work stealing on the persistent pool: contiguous ranges, split only
+    // when another thread runs dry
+    getThreadPool()->parallelForRange(first, last, std::max(1, totalWork / (call.threads * call.chunksPerThread)),
+                                      call.threads, body);
 }
 
-void BMPImageOptimized::processChunkCounterClockwise(const std::vector<unsigned char>& source, 
-                                                    std::vector<unsigned char>& dest,
-                                                    int startY, int endY, int oldWidth, int oldHeight,
-                                                    int oldRowSize, int bytesPerPixel) {
-    for (int y = startY; y < endY; ++y) {
-        for (int x = 0; x < oldWidth; ++x) {
-            for (int c = 0; c < bytesPerPixel; ++c) {
-                int newX = oldHeight - 1 - y;
-                int newY = x;
-                if (newX < width && newY < height) {
-                    dest[newY * rowSize + newX * bytesPerPixel + c] = 
-                        source[y * oldRowSize + x * bytesPerPixel + c];
-                }
-            }
+void BMPImageOptimized::setScheduler(Scheduler kind) {
+#ifndef _OPENMP
+    if (kind == Scheduler::OpenMP) {
+        throw std::invalid_argument("This build has no OpenMP support");
+    }
+#endif
+    scheduler = kind;
+}
+
+void BMPImageOptimized::setDefaultScheduler(Scheduler kind) {
+#ifndef _OPENMP
+    if (kind == Scheduler::OpenMP) {
+        throw std::invalid_argument("This build has no OpenMP support");
+    }
+#endif
+    defaultSchedulerKind().store(static_cast<int>(kind));
+}
+
+BMPImageOptimized::Scheduler BMPImageOptimized::defaultScheduler() {
+    return static_cast<Scheduler>(defaultSchedulerKind().load());
+}
+
+void BMPImageOptimized::setNumaFirstTouch(bool enabled) {
+    numaFirstTouch().store(enabled);
+}
+
+bool BMPImageOptimized::isNumaFirstTouch() {
+    return numaFirstTouch().load();
+}
+
+BMPImageOptimized::Scheduler BMPImageOptimized::parseScheduler(const std::string& name) {
+    if (name == "steal") {
+        return Scheduler::WorkStealing;
+    }
+    if (name == "openmp") {
+        return Scheduler::OpenMP;
+    }
+    throw std::invalid_argument("Unknown scheduler: " + name + " (expected steal or openmp)");
+}
+
+const char* BMPImageOptimized::schedulerName(Scheduler kind) {
+    return kind == Scheduler::OpenMP ? "openmp" : "steal";
+}
+
+void BMPImageOptimized::setTileSize(int pixels) {
+    if (pixels <= 0) {
+        throw std::invalid_argument("Tile size must be positive");
+    }
+    tileSize = pixels;
+}
+
+void BMPImageOptimized::forEachRange(int first, int last, const CallSettings& call,
+                                     const std::function<void(int, int)>& body) {
+    if (call.threads <= 1) {
+        body(first, last);
+    } else {
+        parallelForRows(first, last, call, body);
+    }
+}
+
+int BMPImageOptimized::rotateTiled(const unsigned char* source, const ImageKernels::ImageDescriptor& sourceDesc,
+                                   std::vector<unsigned char>& result, const CallSettings& call, bool clockwise) {
+    // Create new data with proper padding
+    result.assign(ImageKernels::rotatedDescriptor(sourceDesc).dataSize(), 0);
+    return rotateTiled(source, sourceDesc, result.data(), call, clockwise);
+}
+
+int BMPImageOptimized::rotateTiled(const unsigned char* source, const ImageKernels::ImageDescriptor& sourceDesc,
+                                   unsigned char* result, const CallSettings& call, bool clockwise) {
+    auto destDesc = ImageKernels::rotatedDescriptor(sourceDesc);
+    int bytesPerPixel = sourceDesc.bytesPerPixel();
+    const int tileSize = call.tileSize;
+    
+    // Work is split by bands of destination tiles, so each thread owns its output lines
+    int numBands = (destDesc.height + tileSize - 1) / tileSize;
+    auto banded = call.limitedTo(numBands);
+    BMP_TRACE_SCOPE(trace, clockwise ? "rotate clockwise" : "rotate counter-clockwise", "kernel",
+                    "pixels", static_cast<int64_t>(sourceDesc.width) * sourceDesc.height, "threads", banded.threads);
+    
+    forEachRange(0, numBands, banded, [&](int firstBand, int lastBand) {
+        int startY = firstBand * tileSize;
+        int endY = std::min(lastBand * tileSize, destDesc.height);
+        if (clockwise) {
+            ImageKernels::rotateBandClockwise(source, sourceDesc.width, sourceDesc.height, sourceDesc.stride,
+                                              result, destDesc.stride, bytesPerPixel,
+                                              startY, endY, tileSize);
+        } else {
+            ImageKernels::rotateBandCounterClockwise(source, sourceDesc.width, sourceDesc.height, sourceDesc.stride,
+                                                     result, destDesc.stride, bytesPerPixel,
+                                                     startY, endY, tileSize);
+        }
+    });
+    return banded.threads;
+}
+
+int BMPImageOptimized::runGaussian3x3(const unsigned char* source, unsigned char* dest,
+                                      const ImageKernels::ImageDescriptor& desc, const CallSettings& call) {
+    BMP_TRACE_SCOPE(trace, "gaussian 3x3", "kernel", "pixels", static_cast<int64_t>(desc.width) * desc.height);
+    int bytesPerPixel = desc.bytesPerPixel();
+    int width = desc.width;
+    int height = desc.height;
+    size_t rowSize = desc.stride;
+    int workHeight = height - 2; // Exclude borders
+    
+    if (source != dest) {
+        // Border rows are not filtered; interior border columns are copied by the kernel
+        if (width < 3 || workHeight <= 0) {
+            std::memcpy(dest, source, desc.dataSize());
+            return 1;
         }
+        std::memcpy(dest, source, rowSize);
+        std::memcpy(dest + static_cast<size_t>(height - 1) * rowSize,
+                    source + static_cast<size_t>(height - 1) * rowSize, rowSize);
+    }
+    if (width < 3 || workHeight <= 0) {
+        return 1;
     }
+    
+    // Limit threads based on work size
+    auto limited = call.limitedTo(workHeight);
+    BMP_TRACE_ARG(trace, "threads", limited.threads);
+    
+    // Each strip filters through its own ring buffer. Halo rows are captured
+    // first so that, in place, no strip reads a neighbour's filtered rows.
+    std::vector<std::pair<int, int>> strips;
+    if (limited.threads <= 1) {
+        strips.emplace_back(0, workHeight);
+    } else {
+        strips = createWorkChunks(workHeight, limited);
+    }
+    std::vector<ImageKernels::GaussianStripHalo> halos(strips.size());
+    int numStrips = static_cast<int>(strips.size());
+    
+    forEachRange(0, numStrips, limited, [&](int firstStrip, int lastStrip) {
+        for (int i = firstStrip; i < lastStrip; ++i) {
+            ImageKernels::captureGaussianHalo(source, rowSize, width, bytesPerPixel,
+                                              strips[i].first + 1, strips[i].second + 1, halos[i]);
+        }
+    });
+    
+    forEachRange(0, numStrips, limited, [&](int firstStrip, int lastStrip) {
+        for (int i = firstStrip; i < lastStrip; ++i) {
+            ImageKernels::gaussianStrip3x3(source, dest, rowSize, width, bytesPerPixel,
+                                           strips[i].first + 1, strips[i].second + 1, halos[i]);
+        }
+    });
+    return limited.threads;
 }
 
-void BMPImageOptimized::processChunkGaussian(const std::vector<unsigned char>& source, 
-                                            std::vector<unsigned char>& dest,
-                                            int startY, int endY, int bytesPerPixel) {
-    const float kernel[3][3] = {
-        {1.0f/16, 2.0f/16, 1.0f/16},
-        {2.0f/16, 4.0f/16, 2.0f/16},
-        {1.0f/16, 2.0f/16, 1.0f/16}
-    };
+int BMPImageOptimized::rotateGaussianFused(const unsigned char* source,
+                                           const ImageKernels::ImageDescriptor& sourceDesc,
+                                           std::vector<unsigned char>& result, const CallSettings& call,
+                                           bool clockwise) {
+    result.assign(ImageKernels::rotatedDescriptor(sourceDesc).dataSize(), 0);
+    return rotateGaussianFused(source, sourceDesc, result.data(), call, clockwise);
+}
+
+int BMPImageOptimized::rotateGaussianFused(const unsigned char* source,
+                                           const ImageKernels::ImageDescriptor& sourceDesc,
+                                           unsigned char* result, const CallSettings& call, bool clockwise) {
+    auto destDesc = ImageKernels::rotatedDescriptor(sourceDesc);
+    const int tileSize = call.tileSize;
+    
+    // Same destination tile bands as rotateTiled; the filter halo is re-read
+    // from the source, so bands stay independent
+    int numBands = (destDesc.height + tileSize - 1) / tileSize;
+    auto banded = call.limitedTo(numBands);
+    BMP_TRACE_SCOPE(trace, "rotate + gaussian 3x3", "kernel",
+                    "pixels", static_cast<int64_t>(sourceDesc.width) * sourceDesc.height, "threads", banded.threads);
+    
+    forEachRange(0, numBands, banded, [&](int firstBand, int lastBand) {
+        int startY = firstBand * tileSize;
+        int endY = std::min(lastBand * tileSize, destDesc.height);
+        ImageKernels::rotateGaussianBand(source, sourceDesc, result, clockwise, startY, endY, tileSize);
+    });
+    return banded.threads;
+}
+
+size_t BMPImageOptimized::inPlaceRotationSize(const ImageKernels::ImageDescriptor& desc) {
+    return std::max(desc.dataSize(), ImageKernels::rotatedDescriptor(desc).dataSize());
+}
+
+int BMPImageOptimized::rotateBufferInPlace(unsigned char* data, const ImageKernels::ImageDescriptor& desc,
+                                           const CallSettings& call, bool clockwise) {
+    BMP_TRACE_SCOPE(trace, "rotate in place", "kernel", "pixels", static_cast<int64_t>(desc.width) * desc.height);
+    int bytesPerPixel = desc.bytesPerPixel();
+    const int tileSize = call.tileSize;
+    
+    if (desc.width == desc.height) {
+        // Same stride before and after: rotate 4-pixel cycles in bands of
+        // tileSize rows from the top half, each band owning its cycles
+        int half = desc.width / 2;
+        int numBands = std::max(1, (half + tileSize - 1) / tileSize);
+        auto banded = call.limitedTo(numBands);
+        forEachRange(0, numBands, banded, [&](int firstBand, int lastBand) {
+            ImageKernels::rotateSquareRowsInPlace(data, desc.width, desc.stride, bytesPerPixel, clockwise,
+                                                  std::min(firstBand * tileSize, half),
+                                                  std::min(lastBand * tileSize, half), tileSize);
+        });
+        // Out-of-place results always carry zeroed padding, whatever the input had
+        ImageKernels::clearRowPadding(data, desc);
+        return banded.threads;
+    }
     
-    for (int y = startY; y < endY; ++y) {
-        for (int x = 1; x < width - 1; ++x) {
-            for (int c = 0; c < bytesPerPixel; ++c) {
-                float sum = 0.0f;
-                
-                for (int ky = 0; ky < 3; ++ky) {
-                    for (int kx = 0; kx < 3; ++kx) {
-                        int px = x + kx - 1;
-                        int py = y + ky - 1;
-                        sum += kernel[ky][kx] * source[py * rowSize + px * bytesPerPixel + c];
-                    }
-                }
-                
-                dest[y * rowSize + x * bytesPerPixel + c] = 
-                    static_cast<unsigned char>(std::max(0.0f, std::min(255.0f, sum)));
-            }
+    // Rectangles: drop the padding, transpose the packed pixels by following
+    // permutation cycles, then mirror the rows (clockwise) or the pixels
+    // within them (counter-clockwise) and spread rows to the new stride
+    auto destDesc = ImageKernels::rotatedDescriptor(desc);
+    ImageKernels::packRows(data, desc);
+    
+    auto cycles = ImageKernels::transposeCycles(desc.height, desc.width);
+    size_t totalLength = 0;
+    for (const auto& cycle : cycles) {
+        totalLength += cycle.second;
+    }
+    // Cycles are disjoint; hand out consecutive runs of similar total length
+    int numParts = std::max(1, std::min(call.threads, static_cast<int>(cycles.size())));
+    std::vector<size_t> partStart(1, 0);
+    size_t covered = 0;
+    for (size_t i = 0; i < cycles.size() && static_cast<int>(partStart.size()) < numParts; ++i) {
+        covered += cycles[i].second;
+        if (covered * numParts >= totalLength * partStart.size()) {
+            partStart.push_back(i + 1);
         }
     }
+    partStart.push_back(cycles.size());
+    numParts = static_cast<int>(partStart.size()) - 1;
+    auto transpose = call.limitedTo(numParts);
+    forEachRange(0, numParts, transpose, [&](int firstPart, int lastPart) {
+        for (size_t i = partStart[firstPart]; i < partStart[lastPart]; ++i) {
+            ImageKernels::followTransposeCycle(data, desc.height, desc.width, bytesPerPixel, cycles[i].first);
+        }
+    });
+    
+    int rows = destDesc.height;
+    int cols = destDesc.width;
+    size_t packedRowBytes = static_cast<size_t>(cols) * bytesPerPixel;
+    int mirrorRows = clockwise ? rows / 2 : rows;
+    auto mirror = call.limitedTo(mirrorRows);
+    forEachRange(0, mirrorRows, mirror, [&](int firstRow, int lastRow) {
+        if (clockwise) {
+            ImageKernels::mirrorPackedRows(data, rows, packedRowBytes, firstRow, lastRow);
+        } else {
+            ImageKernels::reversePackedPixels(data, cols, bytesPerPixel, firstRow, lastRow);
+        }
+    });
+    
+    ImageKernels::unpackRows(data, destDesc);
+    return std::max(transpose.threads, mirror.threads);
 }
 
-void BMPImageOptimized::rotateClockwiseParallel(std::vector<unsigned char>& imageData, int numThreads) {
+void BMPImageOptimized::rotateVectorInPlace(std::vector<unsigned char>& imageData, int numThreads,
+                                            bool clockwise) {
     if (imageData.size() != static_cast<size_t>(dataSize)) {
         throw std::runtime_error("Image data size mismatch for rotation");
     }
     
-    int bytesPerPixel = bitsPerPixel / 8;
-    int oldWidth = width;
-    int oldHeight = height;
-    int oldRowSize = rowSize;
+    auto sourceDesc = getDescriptor();
+    auto destDesc = ImageKernels::rotatedDescriptor(sourceDesc);
+    auto call = tunedCall(TuningProfile::Kernel::Rotate, sourceDesc, numThreads);
+    imageData.resize(inPlaceRotationSize(sourceDesc));
+    numThreads = rotateBufferInPlace(imageData.data(), sourceDesc, call, clockwise);
+    imageData.resize(destDesc.dataSize());
+    setGeometry(destDesc);
     
-    // Update dimensions first
-    std::swap(width, height);
-    rowSize = calculateRowSize(width, bitsPerPixel);
-    dataSize = rowSize * height;
+    totalOperations.fetch_add(1);
+    if (numThreads > 1) parallelOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::rotateClockwiseParallel(std::vector<unsigned char>& imageData, int numThreads) {
+    if (inPlaceRotation) {
+        rotateVectorInPlace(imageData, numThreads, true);
+        return;
+    }
+    rotateClockwiseParallel(PixelView{imageData.data(), imageData.size()}, imageData, numThreads);
+}
+
+void BMPImageOptimized::rotateCounterClockwiseParallel(std::vector<unsigned char>& imageData, int numThreads) {
+    if (inPlaceRotation) {
+        rotateVectorInPlace(imageData, numThreads, false);
+        return;
+    }
+    rotateCounterClockwiseParallel(PixelView{imageData.data(), imageData.size()}, imageData, numThreads);
+}
+
+void BMPImageOptimized::rotateClockwiseParallel(const PixelView& source, std::vector<unsigned char>& result,
+                                                int numThreads) {
+    if (source.size != static_cast<size_t>(dataSize)) {
+        throw std::runtime_error("Image data size mismatch for rotation");
+    }
     
-    // Create new data with proper padding
-    std::vector<unsigned char> newData(dataSize, 0);
+    // The source may alias result, so rotate into a fresh buffer first
+    auto sourceDesc = getDescriptor();
+    std::vector<unsigned char> newData;
+    auto call = tunedCall(TuningProfile::Kernel::Rotate, sourceDesc, numThreads);
+    rotateTiled(source.data, sourceDesc, newData, call, true);
+    setGeometry(ImageKernels::rotatedDescriptor(sourceDesc));
     
-    // Determine number of threads
-    if (numThreads <= 0) {
-        numThreads = std::thread::hardware_concurrency();
-        if (numThreads == 0) numThreads = 4; // fallback
+    result = std::move(newData);
+    totalOperations.fetch_add(1);
+    parallelOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::rotateCounterClockwiseParallel(const PixelView& source, std::vector<unsigned char>& result,
+                                                       int numThreads) {
+    if (source.size != static_cast<size_t>(dataSize)) {
+        throw std::runtime_error("Image data size mismatch for rotation");
     }
     
-    // Limit threads based on work size
-    numThreads = std::min(numThreads, oldHeight);
+    // The source may alias result, so rotate into a fresh buffer first
+    auto sourceDesc = getDescriptor();
+    std::vector<unsigned char> newData;
+    auto call = tunedCall(TuningProfile::Kernel::Rotate, sourceDesc, numThreads);
+    rotateTiled(source.data, sourceDesc, newData, call, false);
+    setGeometry(ImageKernels::rotatedDescriptor(sourceDesc));
+    
+    result = std::move(newData);
+    totalOperations.fetch_add(1);
+    parallelOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::applyGaussianFilterParallel(std::vector<unsigned char>& imageData, int numThreads) {
+    if (imageData.size() != static_cast<size_t>(dataSize)) {
+        throw std::runtime_error("Image data size mismatch for filtering");
+    }
     
-    auto startTime = std::chrono::high_resolution_clock::now();
+    // Filter in place: no full-frame copy
+    auto call = tunedCall(TuningProfile::Kernel::Gaussian3x3, getDescriptor(), numThreads);
+    runGaussian3x3(imageData.data(), imageData.data(), getDescriptor(), call);
     
-#ifdef _OPENMP
-    #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
-    for (int y = 0; y < oldHeight; ++y) {
-        processChunkClockwise(imageData, newData, y, y + 1, oldWidth, oldHeight, oldRowSize, bytesPerPixel);
+    totalOperations.fetch_add(1);
+    parallelOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::applyGaussianFilterParallel(const PixelView& source, std::vector<unsigned char>& result,
+                                                    int numThreads) {
+    if (source.size != static_cast<size_t>(dataSize)) {
+        throw std::runtime_error("Image data size mismatch for filtering");
     }
-#else
-    // Use std::thread with dynamic load balancing
-    std::vector<std::thread> threads;
-    auto chunks = createWorkChunks(oldHeight, numThreads);
     
-    for (const auto& chunk : chunks) {
-        threads.emplace_back([&, chunk]() {
-            processChunkClockwise(imageData, newData, chunk.first, chunk.second, 
-                                oldWidth, oldHeight, oldRowSize, bytesPerPixel);
-        });
+    result.resize(dataSize);
+    auto call = tunedCall(TuningProfile::Kernel::Gaussian3x3, getDescriptor(), numThreads);
+    runGaussian3x3(source.data, result.data(), getDescriptor(), call);
+    
+    totalOperations.fetch_add(1);
+    parallelOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::runGaussianBlur(const unsigned char* source, unsigned char* dest,
+                                        const ImageKernels::ImageDescriptor& desc,
+                                        const ImageKernels::GaussianPlan& plan, const CallSettings& call) {
+    BMP_TRACE_SCOPE(trace, plan.useBoxBlur ? "box blur" : "gaussian blur", "kernel", "radius", plan.radius,
+                    "threads", call.threads);
+    int bytesPerPixel = desc.bytesPerPixel();
+    int width = desc.width;
+    int height = desc.height;
+    size_t rowSize = desc.stride;
+    size_t rowBytes = static_cast<size_t>(width) * bytesPerPixel;
+    
+    if (plan.useBoxBlur) {
+        // Box blurs commute, so all horizontal passes run before the vertical
+        // ones; the first pass reads the source, the rest work in place
+        const int blockBytes = 64;
+        int numBlocks = static_cast<int>((rowBytes + blockBytes - 1) / blockBytes);
+        const unsigned char* passSource = source;
+        for (int radius : plan.boxRadii) {
+            forEachRange(0, height, call, [&](int startY, int endY) {
+                ImageKernels::boxBlurRows(passSource, dest, rowSize, width, bytesPerPixel, startY, endY, radius);
+            });
+            passSource = dest;
+        }
+        for (int radius : plan.boxRadii) {
+            forEachRange(0, numBlocks, call, [&](int firstBlock, int lastBlock) {
+                ImageKernels::boxBlurColumns(dest, rowSize, height,
+                                             static_cast<size_t>(firstBlock) * blockBytes,
+                                             std::min(rowBytes, static_cast<size_t>(lastBlock) * blockBytes),
+                                             radius);
+            });
+        }
+        return;
     }
     
-    for (auto& thread : threads) {
-        thread.join();
+    // Direct convolution in strips, halos captured before any strip writes
+    std::vector<std::pair<int, int>> strips;
+    if (call.threads <= 1) {
+        strips.emplace_back(0, height);
+    } else {
+        strips = createWorkChunks(height, call);
+    }
+    int numStrips = static_cast<int>(strips.size());
+    std::vector<ImageKernels::GaussianRadiusHalo> halos(strips.size());
+    
+    forEachRange(0, numStrips, call, [&](int firstStrip, int lastStrip) {
+        for (int i = firstStrip; i < lastStrip; ++i) {
+            ImageKernels::captureRadiusHalo(plan, source, rowSize, width, height, bytesPerPixel,
+                                            strips[i].first, strips[i].second, halos[i]);
+        }
+    });
+    forEachRange(0, numStrips, call, [&](int firstStrip, int lastStrip) {
+        for (int i = firstStrip; i < lastStrip; ++i) {
+            ImageKernels::gaussianStripRadius(plan, source, dest, rowSize, width, height, bytesPerPixel,
+                                              strips[i].first, strips[i].second, halos[i]);
+        }
+    });
+}
+
+void BMPImageOptimized::applyGaussianBlur(std::vector<unsigned char>& imageData, int radius, double sigma) {
+    applyGaussianBlur(PixelView{imageData.data(), imageData.size()}, imageData, radius, sigma);
+}
+
+void BMPImageOptimized::applyGaussianBlur(const PixelView& source, std::vector<unsigned char>& result,
+                                          int radius, double sigma) {
+    if (source.size != static_cast<size_t>(dataSize)) {
+        throw std::runtime_error("Image data size mismatch for filtering");
     }
-#endif
     
-    auto endTime = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
+    // resize keeps an aliased source intact (the size already matches)
+    if (radius == 1 && sigma <= 0.0) {
+        // Classic 3x3 filter
+        result.resize(dataSize);
+        runGaussian3x3(source.data, result.data(), getDescriptor(), callSettings(1));
+    } else {
+        auto plan = ImageKernels::planGaussian(radius, sigma);
+        result.resize(dataSize);
+        runGaussianBlur(source.data, result.data(), getDescriptor(), plan, callSettings(1));
+    }
+    totalOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::applyGaussianBlurParallel(std::vector<unsigned char>& imageData, int radius, double sigma,
+                                                  int numThreads) {
+    applyGaussianBlurParallel(PixelView{imageData.data(), imageData.size()}, imageData, radius, sigma, numThreads);
+}
+
+void BMPImageOptimized::applyGaussianBlurParallel(const PixelView& source, std::vector<unsigned char>& result,
+                                                  int radius, double sigma, int numThreads) {
+    if (radius == 1 && sigma <= 0.0) {
+        applyGaussianFilterParallel(source, result, numThreads);
+        return;
+    }
+    if (source.size != static_cast<size_t>(dataSize)) {
+        throw std::runtime_error("Image data size mismatch for filtering");
+    }
+    
+    auto plan = ImageKernels::planGaussian(radius, sigma);
+    auto call = tunedCall(TuningProfile::Kernel::GaussianBlur, getDescriptor(), numThreads).limitedTo(height);
+    
+    result.resize(dataSize);
+    runGaussianBlur(source.data, result.data(), getDescriptor(), plan, call);
     
-    imageData = std::move(newData);
     totalOperations.fetch_add(1);
     parallelOperations.fetch_add(1);
-    
-    std::cout << "Parallel clockwise rotation completed in " << duration.count() << " μs with " 
-              << numThreads << " threads" << std::endl;
 }
 
-void BMPImageOptimized::rotateCounterClockwiseParallel(std::vector<unsigned char>& imageData, int numThreads) {
-    if (imageData.size() != static_cast<size_t>(dataSize)) {
-        throw std::runtime_error("Image data size mismatch for rotation");
+int BMPImageOptimized::rotateFrame(BMPFrame& frame, const CallSettings& call, bool clockwise) {
+    if (frame.empty()) {
+        throw std::runtime_error("Frame holds no image data");
+    }
+    auto turn = clockwise ? ImageKernels::Orientation::clockwise() : ImageKernels::Orientation::counterClockwise();
+    frame.setOrientation(frame.getOrientation().then(turn));
+    if (lazyOrientation) {
+        return 1;
+    }
+    return materializeFrame(frame, call);
+}
+
+int BMPImageOptimized::orientInto(const unsigned char* source, const ImageKernels::ImageDescriptor& sourceDesc,
+                                  unsigned char* result, const ImageKernels::Orientation& orientation,
+                                  const CallSettings& call) {
+    if (orientation.isIdentity()) {
+        std::memcpy(result, source, sourceDesc.dataSize());
+        return 1;
+    }
+    if (orientation.swapsAxes() && !orientation.mirrored) {
+        return rotateTiled(source, sourceDesc, result, call, orientation.quarterTurns == 1);
     }
     
-    int bytesPerPixel = bitsPerPixel / 8;
-    int oldWidth = width;
-    int oldHeight = height;
-    int oldRowSize = rowSize;
+    auto destDesc = ImageKernels::orientedDescriptor(sourceDesc, orientation);
+    const int tileSize = call.tileSize;
+    int numBands = (destDesc.height + tileSize - 1) / tileSize;
+    auto banded = call.limitedTo(numBands);
+    BMP_TRACE_SCOPE(trace, "orient", "kernel",
+                    "pixels", static_cast<int64_t>(sourceDesc.width) * sourceDesc.height, "threads", banded.threads);
+    forEachRange(0, numBands, banded, [&](int firstBand, int lastBand) {
+        ImageKernels::orientBand(source, sourceDesc, result, destDesc, orientation,
+                                 firstBand * tileSize, std::min(lastBand * tileSize, destDesc.height), tileSize);
+    });
+    return banded.threads;
+}
+
+void BMPImageOptimized::prepareDestination(unsigned char* buffer, const ImageKernels::ImageDescriptor& desc,
+                                           const CallSettings& call) {
+    if (!isNumaFirstTouch() || call.threads <= 1) {
+        ImageKernels::clearRowPadding(buffer, desc);
+        return;
+    }
+    const int tileSize = call.tileSize;
+    int numBands = (desc.height + tileSize - 1) / tileSize;
+    BMP_TRACE_SCOPE(trace, "first touch", "memory", "bytes", static_cast<int64_t>(desc.dataSize()));
+    forEachRange(0, numBands, call.limitedTo(numBands), [&](int firstBand, int lastBand) {
+        size_t startY = static_cast<size_t>(firstBand) * tileSize;
+        size_t endY = std::min(static_cast<size_t>(lastBand) * tileSize, static_cast<size_t>(desc.height));
+        std::memset(buffer + startY * desc.stride, 0, (endY - startY) * desc.stride);
+    });
+}
+
+int BMPImageOptimized::materializeFrame(BMPFrame& frame, const CallSettings& call) {
+    if (!frame.isOriented()) {
+        return 1;
+    }
+    const auto orientation = frame.getOrientation();
+    const auto sourceDesc = frame.getDescriptor();
+    const auto destDesc = ImageKernels::orientedDescriptor(sourceDesc, orientation);
+    if (inPlaceRotation && orientation.swapsAxes() && !orientation.mirrored && frame.isExclusive() &&
+        frame.capacity() >= inPlaceRotationSize(sourceDesc)) {
+        int usedThreads = rotateBufferInPlace(frame.mutableData(), sourceDesc, call, orientation.quarterTurns == 1);
+        frame.reshape(destDesc);
+        return usedThreads;
+    }
+    // Recycled buffer: the kernel writes every pixel byte, only padding needs clearing
+    auto buffer = getFramePool()->acquire(destDesc.dataSize());
+    prepareDestination(buffer.get(), destDesc, call);
+    int usedThreads = orientInto(frame.data(), sourceDesc, buffer.get(), orientation, call);
+    frame.assign(destDesc, std::move(buffer), FramePool::sizeClass(destDesc.dataSize()));
+    return usedThreads;
+}
+
+bool BMPImageOptimized::filterCommutes(const ImageKernels::GaussianPlan* plan,
+                                       const ImageKernels::Orientation& orientation) {
+    return plan == nullptr || !orientation.swapsAxes();
+}
+
+int BMPImageOptimized::filterFrame(BMPFrame& frame, const ImageKernels::GaussianPlan* plan,
+                                   const CallSettings& call) {
+    if (frame.empty()) {
+        throw std::runtime_error("Frame holds no image data");
+    }
+    if (!filterCommutes(plan, frame.getOrientation())) {
+        materializeFrame(frame, call);
+    }
+    const auto orientation = frame.getOrientation();
+    if (plan == nullptr && orientation.swapsAxes() && !orientation.mirrored) {
+        // A pending quarter turn and the 3x3 filter fuse into one pass that
+        // also materializes the frame
+        const auto sourceDesc = frame.getDescriptor();
+        const auto destDesc = ImageKernels::orientedDescriptor(sourceDesc, orientation);
+        auto buffer = getFramePool()->acquire(destDesc.dataSize());
+        prepareDestination(buffer.get(), destDesc, call);
+        int usedThreads = rotateGaussianFused(frame.data(), sourceDesc, buffer.get(), call,
+                                              orientation.quarterTurns == 1);
+        frame.assign(destDesc, std::move(buffer), FramePool::sizeClass(destDesc.dataSize()));
+        return usedThreads;
+    }
+    // Other commuting filters run on the stored pixels; the orientation stays pending
+    const auto desc = frame.getDescriptor();
+    
+    // Exclusive frames are filtered in place; shared or mapped ones are read
+    // directly into a new buffer instead of being copied first
+    unsigned char* dest = nullptr;
+    std::shared_ptr<unsigned char> buffer;
+    if (frame.isExclusive()) {
+        dest = frame.mutableData();
+    } else {
+        buffer = getFramePool()->acquire(desc.dataSize());
+        prepareDestination(buffer.get(), desc, call);
+        dest = buffer.get();
+    }
     
-    // Update dimensions first
-    std::swap(width, height);
-    rowSize = calculateRowSize(width, bitsPerPixel);
-    dataSize = rowSize * height;
+    int usedThreads = 1;
+    if (plan == nullptr) {
+        usedThreads = runGaussian3x3(frame.data(), dest, desc, call);
+    } else {
+        auto limited = call.limitedTo(desc.height);
+        runGaussianBlur(frame.data(), dest, desc, *plan, limited);
+        usedThreads = limited.threads;
+    }
     
-    // Create new data with proper padding
-    std::vector<unsigned char> newData(dataSize, 0);
+    if (buffer) {
+        frame.assign(desc, std::move(buffer));
+        frame.setOrientation(orientation);
+    }
+    return usedThreads;
+}
+
+std::shared_ptr<MappedFile> BMPImageOptimized::createMappedOutput(const std::string& filename, const BMPFrame& frame,
+                                                               const ImageKernels::ImageDescriptor& desc,
+                                                               size_t& pixelOffset) {
+    if (frame.empty()) {
+        throw std::runtime_error("Frame holds no image data");
+    }
+    std::vector<unsigned char> prefix = bitmapPrefix(frame.getFileHeader(), frame.getInfoHeader(),
+                                                     frame.getPalette(), desc);
+    auto output = std::make_shared<MappedFile>(filename, prefix.size() + desc.dataSize());
+    std::memcpy(output->writableData(), prefix.data(), prefix.size());
+    pixelOffset = prefix.size();
+    return output;
+}
+
+BMPFrame BMPImageOptimized::mappedOutputFrame(const BMPFrame& frame, const std::shared_ptr<MappedFile>& output,
+                                              size_t pixelOffset) {
+    // The headers at the start of the mapping already describe the new geometry
+    return BMPFrame(output->data(), output->data() + FILE_HEADER_SIZE, frame.getPalette(), output, pixelOffset);
+}
+
+BMPFrame BMPImageOptimized::rotateToFile(const BMPFrame& frame, const std::string& filename, bool clockwise,
+                                         int numThreads) {
+    // A pending orientation folds into the same single pass
+    auto turn = clockwise ? ImageKernels::Orientation::clockwise() : ImageKernels::Orientation::counterClockwise();
+    auto orientation = frame.getOrientation().then(turn);
+    auto destDesc = ImageKernels::orientedDescriptor(frame.getDescriptor(), orientation);
+    size_t pixelOffset = 0;
+    auto output = createMappedOutput(filename, frame, destDesc, pixelOffset);
+    auto call = tunedCall(TuningProfile::Kernel::Rotate, frame.getDescriptor(), numThreads);
+    numThreads = orientInto(frame.data(), frame.getDescriptor(), output->writableData() + pixelOffset,
+                            orientation, call);
     
-    // Determine number of threads
-    if (numThreads <= 0) {
-        numThreads = std::thread::hardware_concurrency();
-        if (numThreads == 0) numThreads = 4; // fallback
+    totalOperations.fetch_add(1);
+    if (numThreads > 1) parallelOperations.fetch_add(1);
+    return mappedOutputFrame(frame, output, pixelOffset);
+}
+
+BMPFrame BMPImageOptimized::filterToFile(const BMPFrame& oriented, const std::string& filename, int radius,
+                                         double sigma, int numThreads) {
+    // The output needs the logical layout, so a pending orientation is applied first
+    BMPFrame frame = oriented;
+    if (frame.isOriented()) {
+        auto call = tunedCall(TuningProfile::Kernel::Rotate, frame.getDescriptor(), numThreads);
+        materializeFrame(frame, call);
+    }
+    const auto desc = frame.getDescriptor();
+    size_t pixelOffset = 0;
+    auto output = createMappedOutput(filename, frame, desc, pixelOffset);
+    unsigned char* dest = output->writableData() + pixelOffset;
+    auto call = tunedCall(filterKernel(radius, sigma), desc, numThreads);
+    if (radius == 1 && sigma <= 0.0) {
+        numThreads = runGaussian3x3(frame.data(), dest, desc, call);
+    } else {
+        auto plan = ImageKernels::planGaussian(radius, sigma);
+        auto limited = call.limitedTo(desc.height);
+        runGaussianBlur(frame.data(), dest, desc, plan, limited);
+        numThreads = limited.threads;
     }
     
-    // Limit threads based on work size
-    numThreads = std::min(numThreads, oldHeight);
+    totalOperations.fetch_add(1);
+    if (numThreads > 1) parallelOperations.fetch_add(1);
+    return mappedOutputFrame(frame, output, pixelOffset);
+}
+
+BMPFrame BMPImageOptimized::rotateAndFilterToFile(const BMPFrame& frame, const std::string& filename,
+                                                  bool clockwise, int numThreads) {
+    auto turn = clockwise ? ImageKernels::Orientation::clockwise() : ImageKernels::Orientation::counterClockwise();
+    auto orientation = frame.getOrientation().then(turn);
+    // The 3x3 filter commutes with every orientation: a pending one that
+    // combines into a single quarter turn still takes the fused pass
+    BMPFrame source = frame;
+    if (!orientation.swapsAxes() || orientation.mirrored) {
+        auto call = tunedCall(TuningProfile::Kernel::Rotate, source.getDescriptor(), numThreads);
+        materializeFrame(source, call);
+        orientation = turn;
+    }
+    auto destDesc = ImageKernels::orientedDescriptor(source.getDescriptor(), orientation);
+    size_t pixelOffset = 0;
+    auto output = createMappedOutput(filename, source, destDesc, pixelOffset);
+    auto call = tunedCall(TuningProfile::Kernel::Gaussian3x3, source.getDescriptor(), numThreads);
+    numThreads = rotateGaussianFused(source.data(), source.getDescriptor(), output->writableData() + pixelOffset,
+                                     call, orientation.quarterTurns == 1);
+    
+    totalOperations.fetch_add(2);
+    if (numThreads > 1) parallelOperations.fetch_add(2);
+    return mappedOutputFrame(frame, output, pixelOffset);
+}
+
+void BMPImageOptimized::checkSpans(std::span<const unsigned char> source,
+                                   const ImageKernels::ImageDescriptor& sourceDesc,
+                                   std::span<unsigned char> dest, const ImageKernels::ImageDescriptor& destDesc,
+                                   bool allowInPlace) {
+    int bytesPerPixel = sourceDesc.bytesPerPixel();
+    if (sourceDesc.width <= 0 || sourceDesc.height <= 0 || bytesPerPixel <= 0 || sourceDesc.bitsPerPixel % 8 != 0 ||
+        sourceDesc.stride < static_cast<size_t>(sourceDesc.width) * bytesPerPixel) {
+        throw std::invalid_argument("Invalid image descriptor");
+    }
+    if (source.size() < sourceDesc.dataSize()) {
+        throw std::invalid_argument("Source span is smaller than the image");
+    }
+    if (dest.size() < destDesc.dataSize()) {
+        throw std::invalid_argument("Destination span is smaller than the result");
+    }
     
-    auto startTime = std::chrono::high_resolution_clock::now();
+    const unsigned char* sourceBegin = source.data();
+    const unsigned char* sourceEnd = sourceBegin + sourceDesc.dataSize();
+    const unsigned char* destBegin = dest.data();
+    const unsigned char* destEnd = destBegin + destDesc.dataSize();
+    bool overlaps = sourceBegin < destEnd && destBegin < sourceEnd;
+    if (overlaps && !(allowInPlace && sourceBegin == destBegin)) {
+        throw std::invalid_argument(allowInPlace ? "Source and destination spans partially overlap"
+                                                 : "Source and destination spans must not overlap");
+    }
+}
+
+ImageKernels::ImageDescriptor BMPImageOptimized::rotateSpan(std::span<const unsigned char> source,
+                                                            std::span<unsigned char> dest,
+                                                            const ImageKernels::ImageDescriptor& desc,
+                                                            bool clockwise, bool filter, int numThreads) {
+    auto destDesc = ImageKernels::rotatedDescriptor(desc);
+    checkSpans(source, desc, dest, destDesc, false);
+    ImageKernels::clearRowPadding(dest.data(), destDesc);
+    auto call = tunedCall(filter ? TuningProfile::Kernel::Gaussian3x3 : TuningProfile::Kernel::Rotate, desc,
+                          numThreads);
+    if (filter) {
+        numThreads = rotateGaussianFused(source.data(), desc, dest.data(), call, clockwise);
+    } else {
+        numThreads = rotateTiled(source.data(), desc, dest.data(), call, clockwise);
+    }
     
-#ifdef _OPENMP
-    #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
-    for (int y = 0; y < oldHeight; ++y) {
-        processChunkCounterClockwise(imageData, newData, y, y + 1, oldWidth, oldHeight, oldRowSize, bytesPerPixel);
+    int operations = filter ? 2 : 1;
+    totalOperations.fetch_add(operations);
+    if (numThreads > 1) parallelOperations.fetch_add(operations);
+    return destDesc;
+}
+
+ImageKernels::ImageDescriptor BMPImageOptimized::rotateClockwise(std::span<const unsigned char> source,
+                                                                 std::span<unsigned char> dest,
+                                                                 const ImageKernels::ImageDescriptor& desc,
+                                                                 int numThreads) {
+    return rotateSpan(source, dest, desc, true, false, numThreads);
+}
+
+ImageKernels::ImageDescriptor BMPImageOptimized::rotateCounterClockwise(std::span<const unsigned char> source,
+                                                                        std::span<unsigned char> dest,
+                                                                        const ImageKernels::ImageDescriptor& desc,
+                                                                        int numThreads) {
+    return rotateSpan(source, dest, desc, false, false, numThreads);
+}
+
+ImageKernels::ImageDescriptor BMPImageOptimized::rotateAndFilter(std::span<const unsigned char> source,
+                                                                 std::span<unsigned char> dest,
+                                                                 const ImageKernels::ImageDescriptor& desc,
+                                                                 bool clockwise, int numThreads) {
+    return rotateSpan(source, dest, desc, clockwise, true, numThreads);
+}
+
+ImageKernels::ImageDescriptor BMPImageOptimized::rotateInPlace(std::span<unsigned char> buffer,
+                                                               const ImageKernels::ImageDescriptor& desc,
+                                                               bool clockwise, int numThreads) {
+    auto destDesc = ImageKernels::rotatedDescriptor(desc);
+    checkSpans(buffer, desc, buffer, destDesc, true);
+    if (buffer.size() < inPlaceRotationSize(desc)) {
+        throw std::invalid_argument("Buffer is smaller than the in-place rotation needs");
     }
-#else
-    // Use std::thread with dynamic load balancing
-    std::vector<std::thread> threads;
-    auto chunks = createWorkChunks(oldHeight, numThreads);
+    auto call = tunedCall(TuningProfile::Kernel::Rotate, desc, numThreads);
+    numThreads = rotateBufferInPlace(buffer.data(), desc, call, clockwise);
     
-    for (const auto& chunk : chunks) {
-        threads.emplace_back([&, chunk]() {
-            processChunkCounterClockwise(imageData, newData, chunk.first, chunk.second, 
-                                       oldWidth, oldHeight, oldRowSize, bytesPerPixel);
-        });
+    totalOperations.fetch_add(1);
+    if (numThreads > 1) parallelOperations.fetch_add(1);
+    return destDesc;
+}
+
+void BMPImageOptimized::applyGaussianFilter(std::span<const unsigned char> source, std::span<unsigned char> dest,
+                                            const ImageKernels::ImageDescriptor& desc, int numThreads) {
+    applyGaussianBlur(source, dest, desc, 1, 0.0, numThreads);
+}
+
+void BMPImageOptimized::applyGaussianBlur(std::span<const unsigned char> source, std::span<unsigned char> dest,
+                                          const ImageKernels::ImageDescriptor& desc, int radius, double sigma,
+                                          int numThreads) {
+    checkSpans(source, desc, dest, desc, true);
+    if (source.data() != dest.data()) {
+        ImageKernels::clearRowPadding(dest.data(), desc);
+    }
+    auto call = tunedCall(filterKernel(radius, sigma), desc, numThreads);
+    if (radius == 1 && sigma <= 0.0) {
+        numThreads = runGaussian3x3(source.data(), dest.data(), desc, call);
+    } else {
+        auto plan = ImageKernels::planGaussian(radius, sigma);
+        auto limited = call.limitedTo(desc.height);
+        runGaussianBlur(source.data(), dest.data(), desc, plan, limited);
+        numThreads = limited.threads;
     }
     
-    for (auto& thread : threads) {
-        thread.join();
+    totalOperations.fetch_add(1);
+    if (numThreads > 1) parallelOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::transform(BMPFrame& frame, const ImageKernels::Orientation& orientation, int numThreads) {
+    if (frame.empty()) {
+        throw std::runtime_error("Frame holds no image data");
     }
-#endif
+    frame.setOrientation(frame.getOrientation().then(orientation));
+    if (!lazyOrientation) {
+        auto call = tunedCall(TuningProfile::Kernel::Rotate, frame.getDescriptor(), numThreads);
+        numThreads = materializeFrame(frame, call);
+        if (numThreads > 1) parallelOperations.fetch_add(1);
+    }
+    totalOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::materialize(BMPFrame& frame, int numThreads) {
+    if (frame.empty()) {
+        throw std::runtime_error("Frame holds no image data");
+    }
+    auto call = tunedCall(TuningProfile::Kernel::Rotate, frame.getDescriptor(), numThreads);
+    numThreads = materializeFrame(frame, call);
+    if (numThreads > 1) parallelOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::rotateClockwise(BMPFrame& frame) {
+    rotateFrame(frame, callSettings(1), true);
+    totalOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::rotateCounterClockwise(BMPFrame& frame) {
+    rotateFrame(frame, callSettings(1), false);
+    totalOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::applyGaussianFilter(BMPFrame& frame) {
+    filterFrame(frame, nullptr, callSettings(1));
+    totalOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::applyGaussianBlur(BMPFrame& frame, int radius, double sigma) {
+    if (radius == 1 && sigma <= 0.0) {
+        filterFrame(frame, nullptr, callSettings(1));
+    } else {
+        auto plan = ImageKernels::planGaussian(radius, sigma);
+        filterFrame(frame, &plan, callSettings(1));
+    }
+    totalOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::rotateClockwiseParallel(BMPFrame& frame, int numThreads) {
+    auto call = tunedCall(TuningProfile::Kernel::Rotate, frame.getDescriptor(), numThreads);
+    rotateFrame(frame, call, true);
     
-    auto endTime = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
+    totalOperations.fetch_add(1);
+    parallelOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::rotateCounterClockwiseParallel(BMPFrame& frame, int numThreads) {
+    auto call = tunedCall(TuningProfile::Kernel::Rotate, frame.getDescriptor(), numThreads);
+    rotateFrame(frame, call, false);
     
-    imageData = std::move(newData);
     totalOperations.fetch_add(1);
     parallelOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::applyGaussianFilterParallel(BMPFrame& frame, int numThreads) {
+    auto call = tunedCall(TuningProfile::Kernel::Gaussian3x3, frame.getDescriptor(), numThreads);
+    filterFrame(frame, nullptr, call);
     
-    std::cout << "Parallel counter-clockwise rotation completed in " << duration.count() << " μs with " 
-              << numThreads << " threads" << std::endl;
+    totalOperations.fetch_add(1);
+    parallelOperations.fetch_add(1);
 }
 
-void BMPImageOptimized::applyGaussianFilterParallel(std::vector<unsigned char>& imageData, int numThreads) {
-    if (imageData.size() != static_cast<size_t>(dataSize)) {
-        throw std::runtime_error("Image data size mismatch for filtering");
+void BMPImageOptimized::applyGaussianBlurParallel(BMPFrame& frame, int radius, double sigma, int numThreads) {
+    if (radius == 1 && sigma <= 0.0) {
+        applyGaussianFilterParallel(frame, numThreads);
+        return;
     }
     
-    int bytesPerPixel = bitsPerPixel / 8;
-    std::vector<unsigned char> filtered(dataSize);
+    auto plan = ImageKernels::planGaussian(radius, sigma);
+    auto call = tunedCall(TuningProfile::Kernel::GaussianBlur, frame.getDescriptor(), numThreads);
+    filterFrame(frame, &plan, call);
     
-    // Copy original data to filtered
-    std::copy(imageData.begin(), imageData.end(), filtered.begin());
+    totalOperations.fetch_add(1);
+    parallelOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::rotateAndFilterParallel(BMPFrame& frame, bool clockwise, int numThreads) {
+    if (frame.empty()) {
+        throw std::runtime_error("Frame holds no image data");
+    }
     
-    // Determine number of threads
-    if (numThreads <= 0) {
-        numThreads = std::thread::hardware_concurrency();
-        if (numThreads == 0) numThreads = 4; // fallback
+    // filterFrame fuses a pending quarter turn into the filter pass; other
+    // combined orientations stay pending after filtering unless not lazy
+    auto turn = clockwise ? ImageKernels::Orientation::clockwise() : ImageKernels::Orientation::counterClockwise();
+    frame.setOrientation(frame.getOrientation().then(turn));
+    auto call = tunedCall(TuningProfile::Kernel::Gaussian3x3, frame.getDescriptor(), numThreads);
+    numThreads = filterFrame(frame, nullptr, call);
+    if (!lazyOrientation) {
+        materializeFrame(frame, call.limitedTo(numThreads));
     }
     
-    // Limit threads based on work size
-    int workHeight = height - 2; // Exclude borders
-    numThreads = std::min(numThreads, workHeight);
+    totalOperations.fetch_add(2);
+    parallelOperations.fetch_add(2);
+}
+
+void BMPImageOptimized::rotate(BMPFrame& frame, bool clockwise, int maxThreads) {
+    if (frame.empty()) {
+        throw std::runtime_error("Frame holds no image data");
+    }
     
-    auto startTime = std::chrono::high_resolution_clock::now();
+    auto decision = planCall(CostModel::Operation::Rotate, TuningProfile::Kernel::Rotate, frame.getDescriptor(),
+                             maxThreads);
+    // numThreads 0 lets the profile's tile, chunking and scheduler apply too
+    auto call = tunedCall(TuningProfile::Kernel::Rotate, frame.getDescriptor(),
+                          decision.fromProfile ? 0 : decision.threads);
+    call.threads = decision.threads;
+    int usedThreads = rotateFrame(frame, call, clockwise);
     
-#ifdef _OPENMP
-    #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
-    for (int y = 1; y < height - 1; ++y) {
-        processChunkGaussian(imageData, filtered, y, y + 1, bytesPerPixel);
-    }
-#else
-    // Use std::thread with dynamic load balancing
-    std::vector<std::thread> threads;
-    auto chunks = createWorkChunks(workHeight, numThreads);
-    
-    for (const auto& chunk : chunks) {
-        threads.emplace_back([&, chunk]() {
-            processChunkGaussian(imageData, filtered, chunk.first + 1, chunk.second + 1, bytesPerPixel);
-        });
+    totalOperations.fetch_add(1);
+    if (usedThreads > 1) parallelOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::filter(BMPFrame& frame, int radius, double sigma, int maxThreads) {
+    if (frame.empty()) {
+        throw std::runtime_error("Frame holds no image data");
     }
     
-    for (auto& thread : threads) {
-        thread.join();
+    auto kernel = filterKernel(radius, sigma);
+    ImageKernels::GaussianPlan plan;
+    CostModel::Decision decision;
+    if (kernel == TuningProfile::Kernel::Gaussian3x3) {
+        decision = planCall(CostModel::Operation::Gaussian3x3, kernel, frame.getDescriptor(), maxThreads);
+    } else {
+        plan = ImageKernels::planGaussian(radius, sigma);
+        decision = planCall(CostModel::Operation::GaussianBlur, kernel, frame.getDescriptor(), maxThreads,
+                            CostModel::blurWorkScale(plan));
     }
-#endif
+    auto call = tunedCall(kernel, frame.getDescriptor(), decision.fromProfile ? 0 : decision.threads);
+    call.threads = decision.threads;
+    int usedThreads = filterFrame(frame, kernel == TuningProfile::Kernel::Gaussian3x3 ? nullptr : &plan, call);
     
-    auto endTime = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
-    
-    imageData = std::move(filtered);
     totalOperations.fetch_add(1);
-    parallelOperations.fetch_add(1);
+    if (usedThreads > 1) parallelOperations.fetch_add(1);
+}
+
+void BMPImageOptimized::rotateAndFilter(BMPFrame& frame, bool clockwise, int maxThreads) {
+    if (frame.empty()) {
+        throw std::runtime_error("Frame holds no image data");
+    }
+    
+    auto decision = planCall(CostModel::Operation::RotateAndFilter, TuningProfile::Kernel::Gaussian3x3,
+                             frame.getDescriptor(), maxThreads);
+    auto turn = clockwise ? ImageKernels::Orientation::clockwise() : ImageKernels::Orientation::counterClockwise();
+    frame.setOrientation(frame.getOrientation().then(turn));
+    auto call = tunedCall(TuningProfile::Kernel::Gaussian3x3, frame.getDescriptor(),
+                          decision.fromProfile ? 0 : decision.threads);
+    call.threads = decision.threads;
+    int usedThreads = filterFrame(frame, nullptr, call);
+    if (!lazyOrientation) {
+        materializeFrame(frame, call);
+    }
+    
+    totalOperations.fetch_add(2);
+    if (usedThreads > 1) parallelOperations.fetch_add(2);
+}
+
+void BMPImageOptimized::processImagePipeline(const std::string& inputFile, int numThreads, bool mapOutputs) {
+    BMPFrame source = loadFrame(inputFile);
+    
+    std::filesystem::path inputPath(inputFile);
+    std::string stem = inputPath.stem().string();
+    std::string extension = inputPath.extension().string();
+    
+    if (mapOutputs) {
+        // The fused kernel stores straight into each output file
+        for (bool clockwise : {true, false}) {
+            std::string outputFile = stem + (clockwise ? "_filtered_clockwise_opt" : "_filtered_counter_clockwise_opt")
+                                     + extension;
+            auto startTime = std::chrono::high_resolution_clock::now();
+            rotateAndFilterToFile(source, outputFile, clockwise, numThreads);
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::high_resolution_clock::now() - startTime);
+            std::cout << "Fused " << (clockwise ? "clockwise" : "counter-clockwise")
+                      << " rotation + Gaussian filter into mapped output completed in "
+                      << duration.count() << " μs" << std::endl;
+            std::cout << "Saved " << outputFile << std::endl;
+        }
+        return;
+    }
     
-    std::cout << "Parallel Gaussian filter completed in " << duration.count() << " μs with " 
-              << numThreads << " threads" << std::endl;
+    // The clockwise output is written while the counter-clockwise one is computed
+    std::vector<std::pair<std::string, std::future<void>>> saves;
+    for (bool clockwise : {true, false}) {
+        // The last branch may consume the source frame
+        BMPFrame frame = clockwise ? source.clone() : std::move(source);
+        rotateAndFilterParallel(frame, clockwise, numThreads);
+        
+        std::string outputFile = stem + (clockwise ? "_filtered_clockwise_opt" : "_filtered_counter_clockwise_opt")
+                                 + extension;
+        saves.emplace_back(outputFile, saveToFileAsync(outputFile, frame));
+    }
+    for (auto& save : saves) {
+        save.second.get();
+        std::cout << "Saved " << save.first << std::endl;
+    }
 }
 
 // Performance monitoring methods
 void BMPImageOptimized::resetPerformanceCounters() {
     totalOperations.store(0);
     parallelOperations.store(0);
+    for (auto& count : decisionCounts) {
+        count.store(0);
+    }
+    std::lock_guard<std::mutex> lock(decisionMutex);
+    lastDecision = CostModel::Decision();
+}
+
+BMPImageOptimized::DecisionStats BMPImageOptimized::getDecisionStats() const {
+    DecisionStats stats;
+    stats.sequential = decisionCounts[static_cast<int>(CostModel::Mode::Sequential)].load();
+    stats.partial = decisionCounts[static_cast<int>(CostModel::Mode::Partial)].load();
+    stats.full = decisionCounts[static_cast<int>(CostModel::Mode::Full)].load();
+    return stats;
+}
+
+CostModel::Decision BMPImageOptimized::getLastDecision() const {
+    std::lock_guard<std::mutex> lock(decisionMutex);
+    return lastDecision;
 }
 
 double BMPImageOptimized::getParallelEfficiency() const {
@@ -599,105 +1714,106 @@ size_t BMPImageOptimized::calculateMemoryUsage() const {
 }
 
 // Benchmark methods
-BMPImageOptimized::BenchmarkResult BMPImageOptimized::benchmarkRotation(int numThreads, int iterations) {
-    if (numThreads <= 0) {
-        numThreads = std::thread::hardware_concurrency();
-        if (numThreads == 0) numThreads = 4;
-    }
+BMPImageOptimized::BenchmarkResult BMPImageOptimized::benchmark(BenchmarkKernel kernel, int numThreads,
+                                                                int iterations, bool collectCounters) {
+    numThreads = resolveThreadCount(numThreads);
+    auto source = getImageData();
+    std::vector<unsigned char> dest(std::max(dataSize, ImageKernels::rotatedDescriptor(getDescriptor()).dataSize()));
     
     BenchmarkResult result;
     result.numThreads = numThreads;
-    
-    // Sequential benchmark
-    double totalSequential = 0.0;
-    for (int i = 0; i < iterations; ++i) {
-        // Create a fresh copy for each iteration
-        BMPImageOptimized tempImage;
-        tempImage.loadFromFile(path);
-        auto data = tempImage.getImageData();
-        auto start = std::chrono::high_resolution_clock::now();
-        tempImage.rotateClockwise(data);
-        auto end = std::chrono::high_resolution_clock::now();
-        totalSequential += std::chrono::duration<double, std::milli>(end - start).count();
-    }
-    result.sequentialTime = totalSequential / iterations;
-    
-    // Parallel benchmark
-    double totalParallel = 0.0;
-    for (int i = 0; i < iterations; ++i) {
-        // Create a fresh copy for each iteration
-        BMPImageOptimized tempImage;
-        tempImage.loadFromFile(path);
-        auto data = tempImage.getImageData();
-        auto start = std::chrono::high_resolution_clock::now();
-        tempImage.rotateClockwiseParallel(data, numThreads);
-        auto end = std::chrono::high_resolution_clock::now();
-        totalParallel += std::chrono::duration<double, std::milli>(end - start).count();
-    }
-    result.parallelTime = totalParallel / iterations;
-    
+    result.sequentialTime = timeBenchmarkKernel(kernel, source, dest, 1, iterations,
+                                                collectCounters ? &result.sequentialCounters : nullptr,
+                                                result.countersNote);
+    result.parallelTime = timeBenchmarkKernel(kernel, source, dest, numThreads, iterations,
+                                              collectCounters ? &result.parallelCounters : nullptr,
+                                              result.countersNote);
     result.speedup = result.sequentialTime / result.parallelTime;
     result.efficiency = result.speedup / numThreads;
-    
     return result;
 }
 
-BMPImageOptimized::BenchmarkResult BMPImageOptimized::benchmarkGaussianFilter(int numThreads, int iterations) {
-    if (numThreads <= 0) {
-        numThreads = std::thread::hardware_concurrency();
-        if (numThreads == 0) numThreads = 4;
-    }
-    
-    BenchmarkResult result;
-    result.numThreads = numThreads;
-    
-    // Sequential benchmark
-    double totalSequential = 0.0;
-    for (int i = 0; i < iterations; ++i) {
-        // Create a fresh copy for each iteration
-        BMPImageOptimized tempImage;
-        tempImage.loadFromFile(path);
-        auto data = tempImage.getImageData();
-        auto start = std::chrono::high_resolution_clock::now();
-        tempImage.applyGaussianFilter(data);
-        auto end = std::chrono::high_resolution_clock::now();
-        totalSequential += std::chrono::duration<double, std::milli>(end - start).count();
-    }
-    result.sequentialTime = totalSequential / iterations;
-    
-    // Parallel benchmark
-    double totalParallel = 0.0;
-    for (int i = 0; i < iterations; ++i) {
-        // Create a fresh copy for each iteration
-        BMPImageOptimized tempImage;
-        tempImage.loadFromFile(path);
-        auto data = tempImage.getImageData();
-        auto start = std::chrono::high_resolution_clock::now();
-        tempImage.applyGaussianFilterParallel(data, numThreads);
-        auto end = std::chrono::high_resolution_clock::now();
-        totalParallel += std::chrono::duration<double, std::milli>(end - start).count();
-    }
-    result.parallelTime = totalParallel / iterations;
-    
-    result.speedup = result.sequentialTime / result.parallelTime;
-    result.efficiency = result.speedup / numThreads;
-    
-    return result;
+BMPImageOptimized::BenchmarkResult BMPImageOptimized::benchmarkRotation(int numThreads, int iterations,
+                                                                        bool collectCounters) {
+    return benchmark(BenchmarkKernel::Rotation, numThreads, iterations, collectCounters);
 }
 
-std::vector<BMPImageOptimized::BenchmarkResult> BMPImageOptimized::benchmarkScaling(int maxThreads) {
-    std::vector<BenchmarkResult> results;
+BMPImageOptimized::BenchmarkResult BMPImageOptimized::benchmarkGaussianFilter(int numThreads, int iterations,
+                                                                              bool collectCounters) {
+    return benchmark(BenchmarkKernel::GaussianFilter, numThreads, iterations, collectCounters);
+}
+
+std::vector<BMPImageOptimized::BenchmarkResult> BMPImageOptimized::benchmarkScaling(int maxThreads,
+                                                                                    BenchmarkKernel kernel,
+                                                                                    int iterations) {
+    if (maxThreads < 1) {
+        throw std::invalid_argument("Scaling benchmark needs at least one thread");
+    }
+    auto source = getImageData();
+    std::vector<unsigned char> dest(std::max(dataSize, ImageKernels::rotatedDescriptor(getDescriptor()).dataSize()));
+    std::string countersNote;
     
+    // The 1-thread run is the baseline of every speedup
+    std::vector<BenchmarkResult> results;
+    double sequentialTime = 0.0;
     for (int threads = 1; threads <= maxThreads; ++threads) {
-        auto rotationResult = benchmarkRotation(threads, 3);
-        auto filterResult = benchmarkGaussianFilter(threads, 3);
-        
-        std::cout << "Threads: " << threads 
-                  << " | Rotation speedup: " << std::fixed << std::setprecision(2) << rotationResult.speedup
-                  << " | Filter speedup: " << filterResult.speedup << std::endl;
+        BenchmarkResult result;
+        result.numThreads = threads;
+        result.parallelTime = timeBenchmarkKernel(kernel, source, dest, threads, iterations, nullptr, countersNote);
+        if (threads == 1) {
+            sequentialTime = result.parallelTime;
+        }
+        result.sequentialTime = sequentialTime;
+        result.speedup = sequentialTime / result.parallelTime;
+        result.efficiency = result.speedup / threads;
         
-        results.push_back(rotationResult);
+        std::cout << "Threads: " << threads << " | " << std::fixed << std::setprecision(3)
+                  << result.parallelTime << " ms | Speedup: " << std::setprecision(2) << result.speedup
+                  << " | Efficiency: " << result.efficiency << std::endl;
+        results.push_back(std::move(result));
     }
     
     return results;
 }
+
+double BMPImageOptimized::timeBenchmarkKernel(BenchmarkKernel kernel, const std::vector<unsigned char>& source,
+                                              std::vector<unsigned char>& dest, int numThreads, int iterations,
+                                              PerfCounters::Sample* counters, std::string& countersNote) {
+    if (iterations <= 0) {
+        throw std::invalid_argument("Benchmarks need at least one timed run");
+    }
+    auto desc = getDescriptor();
+    auto run = [&]() {
+        if (kernel == BenchmarkKernel::Rotation) {
+            rotateClockwise(std::span<const unsigned char>(source), std::span<unsigned char>(dest), desc, numThreads);
+        } else {
+            applyGaussianFilter(std::span<const unsigned char>(source), std::span<unsigned char>(dest), desc,
+                                numThreads);
+        }
+    };
+    run();
+    
+    std::vector<double> times;
+    for (int i = 0; i < iterations; ++i) {
+        std::unique_ptr<PerfCounters> perf;
+        if (counters != nullptr) {
+            perf = std::make_unique<PerfCounters>();
+            countersNote = perf->unavailableReason();
+            if (!perf->available()) {
+                counters = nullptr;     // refused for the process: stop asking
+                perf.reset();
+            } else {
+                perf->start();
+            }
+        }
+        auto start = std::chrono::steady_clock::now();
+        run();
+        auto end = std::chrono::steady_clock::now();
+        if (perf) {
+            *counters += perf->stop();
+        }
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+    return times[times.size() / 2];
+}
@@ -21,6 +21,16 @@
 #include <atomic>
 #include <chrono>
 #include <random>
+#include <functional>
+#include <span>
+#include "ThreadPool.h"
+#include "ImageKernels.h"
+#include "MappedFile.h"
+#include "BMPFrame.h"
+#include "AsyncIO.h"
+#include "PerfCounters.h"
+#include "TuningProfile.h"
+#include "CostModel.h"
 #ifdef _OPENMP
 #include <omp.h>
 #elif defined(NO_OPENMP)
@@ -28,6 +38,19 @@
 #endif
 
 class BMPImageOptimized {
+public:
+    // Distribution of rows, bands and strips across threads
+    enum class Scheduler {
+        WorkStealing,   // per-thread deques on the thread pool, ranges split on demand
+        OpenMP          // schedule(dynamic) with one item per iteration
+    };
+    
+    // Kernels of the built-in benchmark methods
+    enum class BenchmarkKernel {
+        Rotation,           // clockwise
+        GaussianFilter      // classic 3x3
+    };
+    
 private:
     // BMP file structure constants
     static constexpr int FILE_HEADER_SIZE = 14;
@@ -41,40 +64,207 @@ private:
     int width;
     int height;
     int bitsPerPixel;
-    int rowSize;
-    int dataSize;
+    size_t rowSize;     // 64-bit so pixel arrays above 2 GB are addressable
+    size_t dataSize;
     std::string path;
     
+    // Bytes between the info header and the pixel array (palette / extended header)
+    std::vector<unsigned char> palette;
+    
+    // Source file mapping when loaded with LoadMode::Mapped
+    std::shared_ptr<const MappedFile> mapping;
+    
     // Performance monitoring
     mutable std::atomic<size_t> totalOperations{0};
     mutable std::atomic<size_t> parallelOperations{0};
     
+    // Cutover decisions of the auto entry points, by CostModel::Mode
+    mutable std::atomic<size_t> decisionCounts[3] = {0, 0, 0};
+    mutable std::mutex decisionMutex;
+    CostModel::Decision lastDecision;
+    
+    // Sequential / parallel cutover model (shared instance unless injected)
+    std::shared_ptr<const CostModel> costModel;
+    
+    // Worker pool used by the std::thread backend (shared library pool unless injected)
+    std::shared_ptr<ThreadPool> threadPool;
+    
+    // Backend for the *Async file operations (shared library instance unless injected)
+    std::shared_ptr<AsyncIO> asyncIO;
+    
+    // Source of result buffers for the frame API (shared library pool unless injected)
+    std::shared_ptr<FramePool> framePool;
+    
+    // Edge of the square destination tiles used by the parallel rotation
+    int tileSize;
+    
+    // How parallel kernels distribute their rows, bands and strips
+    Scheduler scheduler;
+    
+    // Work items per thread for filter strips and the work-stealing grain
+    int chunksPerThread;
+    
+    // Settings for calls that pass numThreads <= 0 (active profile unless injected)
+    std::shared_ptr<const TuningProfile> tuningProfile;
+    
+    // Opt-in: frame and vector rotations reuse the source buffer (see setInPlaceRotation)
+    bool inPlaceRotation;
+    
+    // Opt-in: frame rotations only update the frame's orientation (see setLazyOrientation)
+    bool lazyOrientation;
+    
     // Helper methods
     void readHeaders(std::ifstream& file);
+    void readPixels(unsigned char* dest) const;
+    void extractImageProperties();
     void writeHeaders(std::ofstream& file);
-    int calculateRowSize(int width, int bpp);
+    size_t calculateRowSize(int width, int bpp);
     void validateImage();
+    void setGeometry(const ImageKernels::ImageDescriptor& desc);
     
-    // Optimized parallel processing helpers
-    void processChunkClockwise(const std::vector<unsigned char>& source, 
-                              std::vector<unsigned char>& dest,
-                              int startY, int endY, int oldWidth, int oldHeight,
-                              int oldRowSize, int bytesPerPixel);
+    // Headers patched for desc followed by the palette: everything before the pixels
+    static std::vector<unsigned char> bitmapPrefix(const unsigned char* fileHeaderBytes,
+                                                   const unsigned char* infoHeaderBytes,
+                                                   const std::vector<unsigned char>& paletteBytes,
+                                                   const ImageKernels::ImageDescriptor& desc);
     
-    void processChunkCounterClockwise(const std::vector<unsigned char>& source, 
-                                    std::vector<unsigned char>& dest,
-                                    int startY, int endY, int oldWidth, int oldHeight,
-                                    int oldRowSize, int bytesPerPixel);
+    // Write headers (patched for desc), palette and pixels to filename
+    static void writeBitmap(const std::string& filename, const unsigned char* fileHeaderBytes,
+                            const unsigned char* infoHeaderBytes, const std::vector<unsigned char>& paletteBytes,
+                            const ImageKernels::ImageDescriptor& desc, const unsigned char* pixels);
     
-    void processChunkGaussian(const std::vector<unsigned char>& source, 
-                             std::vector<unsigned char>& dest,
-                             int startY, int endY, int bytesPerPixel);
+    // Threads, tile size, chunking and scheduler of one call. Entry points
+    // resolve them once and pass them down, so calls running at the same
+    // time on one image never see each other's settings.
+    struct CallSettings {
+        int threads;
+        int tileSize;
+        int chunksPerThread;
+        Scheduler scheduler;
+        
+        // The same settings on at most maxThreads threads (at least one)
+        CallSettings limitedTo(int maxThreads) const;
+    };
+    // This image's tiling, chunking and scheduler on numThreads (<= 0 = all cores)
+    CallSettings callSettings(int numThreads) const;
+    // callSettings(numThreads), except that when numThreads <= 0 and the
+    // tuning profile has an entry for kernel at desc's size, that entry's
+    // threads, tile size, chunking and scheduler are used
+    CallSettings tunedCall(TuningProfile::Kernel kernel, const ImageKernels::ImageDescriptor& desc,
+                           int numThreads) const;
     
+    // Shared engines: source may be a mapped view or alias the destination.
+    // They return the number of threads actually used.
+    // The pointer forms write into a caller-provided buffer of
+    // rotatedDescriptor(sourceDesc).dataSize() bytes and leave row padding as is.
+    int rotateTiled(const unsigned char* source, const ImageKernels::ImageDescriptor& sourceDesc,
+                    std::vector<unsigned char>& result, const CallSettings& call, bool clockwise);
+    int rotateTiled(const unsigned char* source, const ImageKernels::ImageDescriptor& sourceDesc,
+                    unsigned char* result, const CallSettings& call, bool clockwise);
+    int runGaussian3x3(const unsigned char* source, unsigned char* dest,
+                       const ImageKernels::ImageDescriptor& desc, const CallSettings& call);
+    int rotateGaussianFused(const unsigned char* source, const ImageKernels::ImageDescriptor& sourceDesc,
+                            std::vector<unsigned char>& result, const CallSettings& call, bool clockwise);
+    int rotateGaussianFused(const unsigned char* source, const ImageKernels::ImageDescriptor& sourceDesc,
+                            unsigned char* result, const CallSettings& call, bool clockwise);
+    // Rotate data (inPlaceRotationSize(desc) bytes) without a second image buffer
+    int rotateBufferInPlace(unsigned char* data, const ImageKernels::ImageDescriptor& desc,
+                            const CallSettings& call, bool clockwise);
+    // In-place rotation of a vector holding this image (grown to the larger layout while rotating)
+    void rotateVectorInPlace(std::vector<unsigned char>& imageData, int numThreads, bool clockwise);
+    // Copy source into result (orientedDescriptor(sourceDesc, orientation) bytes)
+    // transformed by orientation; single quarter turns take the tiled rotation
+    int orientInto(const unsigned char* source, const ImageKernels::ImageDescriptor& sourceDesc,
+                   unsigned char* result, const ImageKernels::Orientation& orientation,
+                   const CallSettings& call);
+    // Get a pooled buffer ready for a kernel that writes every pixel of desc.
+    // With NUMA first touch the rows are zeroed in tileSize bands on the
+    // scheduler, the partition the rotation uses, so each page lands on the
+    // node of the worker that fills it; otherwise only the padding is cleared.
+    void prepareDestination(unsigned char* buffer, const ImageKernels::ImageDescriptor& desc,
+                            const CallSettings& call);
+    // Apply the frame's pending orientation to its pixels (no-op when there is none)
+    int materializeFrame(BMPFrame& frame, const CallSettings& call);
+    // Whether filtering the stored pixels equals filtering the oriented image.
+    // The 3x3 kernel is symmetric in x and y; the radius and box passes round
+    // between the horizontal and vertical steps, so they only commute with
+    // orientations that keep the axes.
+    static bool filterCommutes(const ImageKernels::GaussianPlan* plan,
+                               const ImageKernels::Orientation& orientation);
+    
+    // Profile kernel of a radius/sigma request (radius 1, sigma 0 is the 3x3 filter)
+    static TuningProfile::Kernel filterKernel(int radius, double sigma);
+    
+    // Thread count for an auto entry point, capped at maxThreads (<= 0 =
+    // all cores): the tuning profile's entry when the host was tuned for
+    // kernel at desc's size, the cost model's estimate otherwise. The
+    // decision is counted and kept as the last one.
+    CostModel::Decision planCall(CostModel::Operation operation, TuningProfile::Kernel kernel,
+                                 const ImageKernels::ImageDescriptor& desc, int maxThreads,
+                                 double workScale = 1.0);
+
+    // Median ms of kernel on numThreads over source (the loaded pixels) into
+    // dest, after one untimed warm-up run that also brings up the pool or
+    // OpenMP workers before counter groups are opened. With counters, adds
+    // the runs' counters and leaves the reason any are missing.
+    double timeBenchmarkKernel(BenchmarkKernel kernel, const std::vector<unsigned char>& source,
+                               std::vector<unsigned char>& dest, int numThreads, int iterations,
+                               PerfCounters::Sample* counters, std::string& countersNote);
+
     // Dynamic load balancing
-    int calculateOptimalChunkSize(int totalWork, int numThreads) const;
-    std::vector<std::pair<int, int>> createWorkChunks(int totalWork, int numThreads) const;
+    static int calculateOptimalChunkSize(int totalWork, const CallSettings& call);
+    static std::vector<std::pair<int, int>> createWorkChunks(int totalWork, const CallSettings& call);
+    int resolveThreadCount(int numThreads) const;
+    
+    // Runs body(begin, end) over [first, last) rows on call's threads and scheduler
+    void parallelForRows(int first, int last, const CallSettings& call,
+                         const std::function<void(int, int)>& body);
+    
+    // parallelForRows, or a single inline call when call.threads <= 1
+    void forEachRange(int first, int last, const CallSettings& call,
+                      const std::function<void(int, int)>& body);
+    
+    // Radius/sigma Gaussian engine shared by the sequential and parallel entry points
+    void runGaussianBlur(const unsigned char* source, unsigned char* dest,
+                         const ImageKernels::ImageDescriptor& desc,
+                         const ImageKernels::GaussianPlan& plan, const CallSettings& call);
+    
+    // Frame engines: rotate out of place, filter in place when the frame is exclusive
+    int rotateFrame(BMPFrame& frame, const CallSettings& call, bool clockwise);
+    // plan == nullptr selects the classic 3x3 filter
+    int filterFrame(BMPFrame& frame, const ImageKernels::GaussianPlan* plan, const CallSettings& call);
+    
+    // Create filename sized for desc, write its headers and palette, and map
+    // it read-write; the pixel region starts at the returned offset
+    static std::shared_ptr<MappedFile> createMappedOutput(const std::string& filename, const BMPFrame& frame,
+                                                          const ImageKernels::ImageDescriptor& desc,
+                                                          size_t& pixelOffset);
+    // Size, geometry and aliasing checks shared by the span API
+    static void checkSpans(std::span<const unsigned char> source, const ImageKernels::ImageDescriptor& sourceDesc,
+                           std::span<unsigned char> dest, const ImageKernels::ImageDescriptor& destDesc,
+                           bool allowInPlace);
+    // Rotation through the span API, optionally fused with the 3x3 filter
+    ImageKernels::ImageDescriptor rotateSpan(std::span<const unsigned char> source, std::span<unsigned char> dest,
+                                             const ImageKernels::ImageDescriptor& desc, bool clockwise,
+                                             bool filter, int numThreads);
+    
+    // Frame reading the pixels just written to a mapped output
+    static BMPFrame mappedOutputFrame(const BMPFrame& frame, const std::shared_ptr<MappedFile>& output,
+                                      size_t pixelOffset);
     
 public:
+    // How loadFromFile obtains pixel data
+    enum class LoadMode {
+        Buffered,   // getImageData() reads the pixels into a vector
+        Mapped      // pixels stay in a read-only mmap of the file (see getPixelView)
+    };
+    
+    // Read-only window onto pixel data that the image does not own
+    struct PixelView {
+        const unsigned char* data;
+        size_t size;
+    };
+    
     // Constructor
     BMPImageOptimized();
     
@@ -85,14 +275,30 @@ public:
     BMPImageOptimized(const BMPImageOptimized& other) = delete;
     BMPImageOptimized& operator=(const BMPImageOptimized& other) = delete;
     
-    // Move constructor and assignment operator (deleted due to atomic members)
-    BMPImageOptimized(BMPImageOptimized&& other) noexcept = delete;
-    BMPImageOptimized& operator=(BMPImageOptimized&& other) noexcept = delete;
+    // Move constructor and assignment operator (counters are carried over by value)
+    BMPImageOptimized(BMPImageOptimized&& other) noexcept;
+    BMPImageOptimized& operator=(BMPImageOptimized&& other) noexcept;
     
     // Main interface methods
-    void loadFromFile(const std::string& filename);
+    void loadFromFile(const std::string& filename, LoadMode mode = LoadMode::Buffered);
     void saveToFile(const std::string& filename, const std::vector<unsigned char>& imageData);
     std::vector<unsigned char> getImageData() const;
+    
+    // Load headers, palette and pixels once into a self-contained frame.
+    // This image keeps the headers too, so the vector API keeps working.
+    BMPFrame loadFrame(const std::string& filename, LoadMode mode = LoadMode::Buffered);
+    void saveToFile(const std::string& filename, const BMPFrame& frame);
+    
+    // Queue the save on the async I/O backend and return at once. The frame's
+    // pixels are shared with the request, so later writes to frame detach it
+    // instead of racing with the transfer.
+    std::future<void> saveToFileAsync(const std::string& filename, const BMPFrame& frame);
+    // Headers are read now; the pixel read is queued and the future yields the frame
+    std::future<BMPFrame> loadFrameAsync(const std::string& filename);
+    
+    // Pixels of a mapped image, valid while the image (or a later load) keeps the mapping
+    PixelView getPixelView() const;
+    bool isMapped() const { return mapping != nullptr; }
     void setPath(const std::string& filepath);
     
     // Image processing methods
@@ -100,41 +306,228 @@ public:
     void rotateCounterClockwise(std::vector<unsigned char>& imageData);
     void applyGaussianFilter(std::vector<unsigned char>& imageData);
     
+    // Out-of-place variants reading straight from a (typically mapped) pixel view
+    void rotateClockwise(const PixelView& source, std::vector<unsigned char>& result);
+    void rotateCounterClockwise(const PixelView& source, std::vector<unsigned char>& result);
+    void applyGaussianFilter(const PixelView& source, std::vector<unsigned char>& result);
+    
     // Advanced parallel processing methods
     void rotateClockwiseParallel(std::vector<unsigned char>& imageData, int numThreads = 0);
     void rotateCounterClockwiseParallel(std::vector<unsigned char>& imageData, int numThreads = 0);
     void applyGaussianFilterParallel(std::vector<unsigned char>& imageData, int numThreads = 0);
     
-    // Pipeline processing (combines multiple operations)
-    void processImagePipeline(const std::string& inputFile, int numThreads = 0);
+    void rotateClockwiseParallel(const PixelView& source, std::vector<unsigned char>& result, int numThreads = 0);
+    void rotateCounterClockwiseParallel(const PixelView& source, std::vector<unsigned char>& result,
+                                        int numThreads = 0);
+    void applyGaussianFilterParallel(const PixelView& source, std::vector<unsigned char>& result,
+                                     int numThreads = 0);
+    
+    // Gaussian blur with configurable radius (1..15) and sigma (<= 0 = derived from radius).
+    // Radius 1 without an explicit sigma is the classic 3x3 filter above; other
+    // settings filter every pixel with replicated edges and switch to three box
+    // blurs (constant cost per pixel) when sigma exceeds BOX_BLUR_SIGMA_THRESHOLD.
+    void applyGaussianBlur(std::vector<unsigned char>& imageData, int radius, double sigma = 0.0);
+    void applyGaussianBlurParallel(std::vector<unsigned char>& imageData, int radius, double sigma = 0.0,
+                                   int numThreads = 0);
+    void applyGaussianBlur(const PixelView& source, std::vector<unsigned char>& result,
+                           int radius, double sigma = 0.0);
+    void applyGaussianBlurParallel(const PixelView& source, std::vector<unsigned char>& result,
+                                   int radius, double sigma = 0.0, int numThreads = 0);
+    
+    // Frame variants: geometry comes from the frame, not from this image, so
+    // one BMPImageOptimized can process any number of frames
+    void rotateClockwise(BMPFrame& frame);
+    void rotateCounterClockwise(BMPFrame& frame);
+    void applyGaussianFilter(BMPFrame& frame);
+    void applyGaussianBlur(BMPFrame& frame, int radius, double sigma = 0.0);
+    void rotateClockwiseParallel(BMPFrame& frame, int numThreads = 0);
+    void rotateCounterClockwiseParallel(BMPFrame& frame, int numThreads = 0);
+    void applyGaussianFilterParallel(BMPFrame& frame, int numThreads = 0);
+    void applyGaussianBlurParallel(BMPFrame& frame, int radius, double sigma = 0.0, int numThreads = 0);
+    
+    // Auto entry points: one per operation, no sequential / parallel choice
+    // for the caller. Each picks 1, k or maxThreads threads (<= 0 = all
+    // cores) from the frame's pixel count, bytes per pixel and the cache
+    // sizes via the cost model, or takes the tuning profile's measured
+    // setting; see getLastDecision() and getDecisionStats().
+    void rotate(BMPFrame& frame, bool clockwise, int maxThreads = 0);
+    void filter(BMPFrame& frame, int radius = 1, double sigma = 0.0, int maxThreads = 0);
+    void rotateAndFilter(BMPFrame& frame, bool clockwise, int maxThreads = 0);
+    
+    // Any rotation or mirror (see ImageKernels::Orientation), composed with
+    // the frame's pending orientation and applied now unless lazy
+    void transform(BMPFrame& frame, const ImageKernels::Orientation& orientation, int numThreads = 1);
+    // Permute the pixels into the frame's logical orientation now
+    void materialize(BMPFrame& frame, int numThreads = 1);
+    
+    // Fused rotate + classic 3x3 Gaussian in one pass over the source: each
+    // destination tile is rotated into a cache-resident buffer and filtered
+    // there, so the rotated image is never stored. Same bytes as rotating and
+    // then calling applyGaussianFilter.
+    void rotateAndFilterParallel(BMPFrame& frame, bool clockwise, int numThreads = 0);
+    
+    // Save modes that skip the result vector and the copy into the file: the
+    // output BMP is created at its final size, its headers are written, and
+    // the kernel stores straight into the mapped pixel region. The returned
+    // frame reads those pixels back from the mapping, so it can feed the next
+    // kernel (writes to it copy first). numThreads <= 0 takes the tuning
+    // profile's threads, tile size, chunking and scheduler when it has an
+    // entry for the kernel at this size, and all cores otherwise.
+    BMPFrame rotateToFile(const BMPFrame& frame, const std::string& filename, bool clockwise,
+                          int numThreads = 1);
+    BMPFrame filterToFile(const BMPFrame& frame, const std::string& filename, int radius = 1,
+                          double sigma = 0.0, int numThreads = 1);
+    BMPFrame rotateAndFilterToFile(const BMPFrame& frame, const std::string& filename, bool clockwise,
+                                   int numThreads = 1);
+    
+    // Span API: source and destination are caller-owned (a reused buffer,
+    // shared memory, a mapping) and the geometry is explicit, so nothing
+    // frame-sized is allocated and a whole pipeline can run on two ping-pong
+    // buffers. Rotations return the destination geometry and need disjoint
+    // buffers; filters also accept dest == source (in place). Spans that are
+    // too small or partially overlap throw std::invalid_argument.
+    // numThreads <= 0 applies the tuning profile as for the *ToFile modes.
+    ImageKernels::ImageDescriptor rotateClockwise(std::span<const unsigned char> source,
+                                                  std::span<unsigned char> dest,
+                                                  const ImageKernels::ImageDescriptor& desc, int numThreads = 1);
+    ImageKernels::ImageDescriptor rotateCounterClockwise(std::span<const unsigned char> source,
+                                                         std::span<unsigned char> dest,
+                                                         const ImageKernels::ImageDescriptor& desc,
+                                                         int numThreads = 1);
+    void applyGaussianFilter(std::span<const unsigned char> source, std::span<unsigned char> dest,
+                             const ImageKernels::ImageDescriptor& desc, int numThreads = 1);
+    void applyGaussianBlur(std::span<const unsigned char> source, std::span<unsigned char> dest,
+                           const ImageKernels::ImageDescriptor& desc, int radius, double sigma = 0.0,
+                           int numThreads = 1);
+    ImageKernels::ImageDescriptor rotateAndFilter(std::span<const unsigned char> source,
+                                                  std::span<unsigned char> dest,
+                                                  const ImageKernels::ImageDescriptor& desc, bool clockwise,
+                                                  int numThreads = 1);
+    // Rotate inside buffer, which must hold inPlaceRotationSize(desc) bytes
+    ImageKernels::ImageDescriptor rotateInPlace(std::span<unsigned char> buffer,
+                                                const ImageKernels::ImageDescriptor& desc, bool clockwise,
+                                                int numThreads = 1);
+    
+    // Load inputFile once and save <stem>_filtered_clockwise_opt and
+    // <stem>_filtered_counter_clockwise_opt through the fused engine, either
+    // with async writes or straight into mapped output files
+    void processImagePipeline(const std::string& inputFile, int numThreads = 0, bool mapOutputs = false);
+    
+    // Thread pool injection (nullptr restores the shared library pool)
+    void setThreadPool(std::shared_ptr<ThreadPool> pool);
+    std::shared_ptr<ThreadPool> getThreadPool() const;
+    
+    // Async I/O backend injection (nullptr restores the shared instance)
+    void setAsyncIO(std::shared_ptr<AsyncIO> io);
+    std::shared_ptr<AsyncIO> getAsyncIO() const;
+    
+    // Frame buffer pool injection, e.g. one pool per pipeline run
+    // (nullptr restores the shared library pool)
+    void setFramePool(std::shared_ptr<FramePool> pool);
+    std::shared_ptr<FramePool> getFramePool() const;
+    
+    // Rotation tile size in pixels (tiles of tileSize x tileSize should fit in L1/L2)
+    void setTileSize(int pixels);
+    int getTileSize() const { return tileSize; }
+    
+    // Scheduler for every parallel kernel; OpenMP throws std::invalid_argument
+    // in builds without it. New images start with the process default.
+    void setScheduler(Scheduler kind);
+    Scheduler getScheduler() const { return scheduler; }
+    static void setDefaultScheduler(Scheduler kind);
+    static Scheduler defaultScheduler();
+    // Process-wide: pooled frame buffers are first touched in parallel (see
+    // prepareDestination). Pair with ThreadPool::pinWorkers on NUMA hosts.
+    static void setNumaFirstTouch(bool enabled);
+    static bool isNumaFirstTouch();
+    // "steal" or "openmp"
+    static Scheduler parseScheduler(const std::string& name);
+    static const char* schedulerName(Scheduler kind);
+    
+    // Work items per thread: filter strips and work-stealing grain (default 4)
+    void setChunksPerThread(int chunks);
+    int getChunksPerThread() const { return chunksPerThread; }
+    
+    // Cost model injection, e.g. with coefficients measured on another host
+    // (nullptr restores CostModel::sharedInstance())
+    void setCostModel(std::shared_ptr<const CostModel> model);
+    std::shared_ptr<const CostModel> getCostModel() const;
+    
+    // Tuning profile injection (nullptr restores TuningProfile::active())
+    void setTuningProfile(std::shared_ptr<const TuningProfile> profile);
+    std::shared_ptr<const TuningProfile> getTuningProfile() const;
+    
+    // Memory-tight mode: rotations of exclusive frames and of vectors permute
+    // the pixels inside their own buffer instead of allocating a second image.
+    // Square images swap 4-pixel cycles tile by tile; rectangles go through a
+    // cycle-following transpose, which is slower than the tiled copy. Shared,
+    // mapped or too small frames still rotate out of place.
+    void setInPlaceRotation(bool enabled) { inPlaceRotation = enabled; }
+    bool isInPlaceRotation() const { return inPlaceRotation; }
+    
+    // Buffer size an in-place rotation of desc needs: the larger of the two
+    // layouts, since the rotated rows may carry more padding
+    static size_t inPlaceRotationSize(const ImageKernels::ImageDescriptor& desc);
+    
+    // Deferred transforms: frame rotations compose into the frame's
+    // orientation instead of moving pixels, so chains such as clockwise then
+    // counter-clockwise cost nothing. Pixels are permuted once, by the first
+    // kernel that needs the physical layout or by the save (straight into
+    // the output file's mapping). Filters that commute with the pending
+    // orientation run on the stored pixels and keep it pending.
+    void setLazyOrientation(bool enabled) { lazyOrientation = enabled; }
+    bool isLazyOrientation() const { return lazyOrientation; }
     
     // Performance monitoring
     void resetPerformanceCounters();
     size_t getTotalOperations() const { return totalOperations.load(); }
     size_t getParallelOperations() const { return parallelOperations.load(); }
     double getParallelEfficiency() const;
+    // Auto entry point decisions since the last reset
+    struct DecisionStats {
+        size_t sequential = 0;
+        size_t partial = 0;
+        size_t full = 0;
+        size_t total() const { return sequential + partial + full; }
+    };
+    DecisionStats getDecisionStats() const;
+    // Most recent auto entry point decision (default-constructed before the first)
+    CostModel::Decision getLastDecision() const;
     
     // Getters
     int getWidth() const { return width; }
     int getHeight() const { return height; }
     int getBitsPerPixel() const { return bitsPerPixel; }
-    int getDataSize() const { return dataSize; }
+    size_t getDataSize() const { return dataSize; }
+    ImageKernels::ImageDescriptor getDescriptor() const;
     
     // Memory usage calculation
     size_t calculateMemoryUsage() const;
     
-    // Benchmark methods
+    // Benchmark methods. The pixels are read once and every run works on the
+    // same in-memory buffers; times are medians in ms. bmp_bench (make
+    // bench) covers every kernel on synthetic sizes.
     struct BenchmarkResult {
         double sequentialTime;
         double parallelTime;
         double speedup;
         double efficiency;
         int numThreads;
+        // Summed over the timed runs; filled when counters were asked for
+        PerfCounters::Sample sequentialCounters;
+        PerfCounters::Sample parallelCounters;
+        std::string countersNote;    // why some or all counters are missing
     };
     
-    BenchmarkResult benchmarkRotation(int numThreads = 0, int iterations = 5);
-    BenchmarkResult benchmarkGaussianFilter(int numThreads = 0, int iterations = 5);
-    std::vector<BenchmarkResult> benchmarkScaling(int maxThreads = 16);
+    // collectCounters adds per-thread hardware counters (see PerfCounters)
+    BenchmarkResult benchmark(BenchmarkKernel kernel, int numThreads = 0, int iterations = 5,
+                              bool collectCounters = false);
+    BenchmarkResult benchmarkRotation(int numThreads = 0, int iterations = 5, bool collectCounters = false);
+    BenchmarkResult benchmarkGaussianFilter(int numThreads = 0, int iterations = 5, bool collectCounters = false);
+    // 1..maxThreads threads, speedups relative to the 1-thread run
+    std::vector<BenchmarkResult> benchmarkScaling(int maxThreads = 16,
+                                                  BenchmarkKernel kernel = BenchmarkKernel::Rotation,
+                                                  int iterations = 5);
 };
 
 #endif // WORKWITHBMP_OPTIMIZED_H
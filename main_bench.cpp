@@ -0,0 +1,440 @@
+/*
+   Micro-Benchmark Suite
+   Author: Gleb Shikunov
+   Student ID: st128274@student.spbu.ru
+   Lab1 - BMP Image Processing
+*/
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "WorkWithBMP.h"
+#include "WorkWithBMP_optimized.h"
+#include "ImageKernels.h"
+
+namespace {
+
+struct BenchOptions {
+    std::vector<int> sizes = {256, 1024, 4096, 16384};     // square edge in pixels
+    int threads = 0;                // parallel variants; 0 = all cores
+    int warmupRuns = 1;
+    int minRuns = 5;
+    int maxRuns = 50;
+    double budgetSeconds = 1.0;     // per case: timed runs stop after maxRuns or past the budget (minRuns first)
+    bool original = true;           // include the original BMPImage
+    std::string jsonPath;
+    std::string csvPath;
+};
+
+struct Stats {
+    int runs = 0;
+    double medianMs = 0.0;
+    double p95Ms = 0.0;
+    double meanMs = 0.0;
+    double stddevMs = 0.0;          // sample standard deviation
+    double minMs = 0.0;
+};
+
+struct CaseResult {
+    std::string kernel;             // e.g. "rotate-cw"
+    std::string variant;            // sequential, parallel, original, original-parallel
+    int threads = 1;
+    int width = 0;
+    int height = 0;
+    size_t bytes = 0;               // source pixel array
+    Stats stats;
+    double mbPerSecond = 0.0;       // source bytes per median run
+    double mpixPerSecond = 0.0;
+    double vsOriginal = 0.0;        // original's median / this median (0 = no original run)
+};
+
+// Page-aligned buffer, faulted in up front and locked when RLIMIT_MEMLOCK
+// allows, so no run pays for page faults or gets paged out
+class PinnedBuffer {
+public:
+    explicit PinnedBuffer(size_t size) : bytes(std::max<size_t>(size, 1)) {
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t rounded = (bytes + page - 1) / page * page;
+        data = static_cast<unsigned char*>(std::aligned_alloc(page, rounded));
+        if (data == nullptr) {
+            throw std::bad_alloc();
+        }
+        std::memset(data, 0, rounded);
+        locked = mlock(data, rounded) == 0;
+        lockedBytes = locked ? rounded : 0;
+    }
+    ~PinnedBuffer() {
+        if (locked) {
+            munlock(data, lockedBytes);
+        }
+        std::free(data);
+    }
+    PinnedBuffer(const PinnedBuffer& other) = delete;
+    PinnedBuffer& operator=(const PinnedBuffer& other) = delete;
+
+    unsigned char* get() { return data; }
+    size_t size() const { return bytes; }
+    bool isLocked() const { return locked; }
+    std::span<unsigned char> span() { return {data, bytes}; }
+
+private:
+    unsigned char* data = nullptr;
+    size_t bytes;
+    size_t lockedBytes = 0;
+    bool locked = false;
+};
+
+Stats summarize(std::vector<double> times) {
+    Stats stats;
+    stats.runs = static_cast<int>(times.size());
+    std::sort(times.begin(), times.end());
+    size_t n = times.size();
+    stats.medianMs = n % 2 == 1 ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2.0;
+    // Nearest rank
+    stats.p95Ms = times[static_cast<size_t>(std::ceil(0.95 * n)) - 1];
+    stats.minMs = times.front();
+    double sum = 0.0;
+    for (double t : times) sum += t;
+    stats.meanMs = sum / n;
+    double squares = 0.0;
+    for (double t : times) squares += (t - stats.meanMs) * (t - stats.meanMs);
+    stats.stddevMs = n > 1 ? std::sqrt(squares / (n - 1)) : 0.0;
+    return stats;
+}
+
+// Warm-up runs, then timed runs of run() until the options' run count and
+// budget are met; reset() restores the input outside the timed region
+Stats measure(const BenchOptions& options, const std::function<void()>& run,
+              const std::function<void()>& reset = nullptr) {
+    for (int i = 0; i < options.warmupRuns; ++i) {
+        if (reset) reset();
+        run();
+    }
+    std::vector<double> times;
+    double elapsed = 0.0;
+    while (static_cast<int>(times.size()) < options.minRuns ||
+           (static_cast<int>(times.size()) < options.maxRuns && elapsed < options.budgetSeconds)) {
+        if (reset) reset();
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        times.push_back(seconds * 1000.0);
+        elapsed += seconds;
+    }
+    return summarize(std::move(times));
+}
+
+// 24-bit headers for desc. BMPImage::loadFromFile only parses the headers;
+// the pixels always come from the in-memory source.
+void writeBitmapHeaders(const std::string& filename, const ImageKernels::ImageDescriptor& desc) {
+    unsigned char header[54] = {};
+    auto put32 = [&header](int offset, uint32_t value) {
+        for (int i = 0; i < 4; ++i) header[offset + i] = static_cast<unsigned char>(value >> (8 * i));
+    };
+    header[0] = 'B';
+    header[1] = 'M';
+    put32(2, static_cast<uint32_t>(54 + desc.dataSize()));
+    put32(10, 54);
+    put32(14, 40);
+    put32(18, static_cast<uint32_t>(desc.width));
+    put32(22, static_cast<uint32_t>(desc.height));
+    header[26] = 1;
+    header[28] = static_cast<unsigned char>(desc.bitsPerPixel);
+    put32(34, static_cast<uint32_t>(desc.dataSize()));
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    if (!file) {
+        throw std::runtime_error("Cannot write " + filename);
+    }
+}
+
+std::vector<int> parseSizes(const std::string& text) {
+    std::vector<int> sizes;
+    std::stringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        int size = std::stoi(item);
+        if (size < 3 || size > 32768) {
+            throw std::invalid_argument("Image sizes must be between 3 and 32768: " + item);
+        }
+        sizes.push_back(size);
+    }
+    if (sizes.empty()) {
+        throw std::invalid_argument("--sizes needs at least one size");
+    }
+    return sizes;
+}
+
+void printRow(const CaseResult& result) {
+    std::cout << std::left << std::setw(7) << std::to_string(result.width) << std::setw(18) << result.kernel
+              << std::setw(18) << result.variant << std::right << std::setw(4) << result.threads << std::setw(6)
+              << result.stats.runs << std::fixed << std::setprecision(3) << std::setw(11) << result.stats.medianMs
+              << std::setw(11) << result.stats.p95Ms << std::setw(10) << result.stats.stddevMs
+              << std::setprecision(1) << std::setw(10) << result.mbPerSecond << std::setw(9)
+              << result.mpixPerSecond;
+    if (result.vsOriginal > 0.0) {
+        std::cout << std::setprecision(2) << std::setw(9) << result.vsOriginal << "x";
+    }
+    std::cout << std::endl;
+}
+
+void writeJson(const std::string& filename, const std::vector<CaseResult>& results, const BenchOptions& options,
+               int threads, bool pinned) {
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot write " + filename);
+    }
+    file << std::fixed << std::setprecision(4);
+    file << "{\n  \"threads\": " << threads << ",\n  \"hardware_concurrency\": "
+         << std::thread::hardware_concurrency() << ",\n  \"warmup_runs\": " << options.warmupRuns
+         << ",\n  \"buffers_locked\": " << (pinned ? "true" : "false") << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        file << (i == 0 ? "\n" : ",\n") << "    {\"kernel\": \"" << r.kernel << "\", \"variant\": \"" << r.variant
+             << "\", \"threads\": " << r.threads << ", \"width\": " << r.width << ", \"height\": " << r.height
+             << ", \"bytes\": " << r.bytes << ", \"runs\": " << r.stats.runs << ", \"median_ms\": "
+             << r.stats.medianMs << ", \"p95_ms\": " << r.stats.p95Ms << ", \"mean_ms\": " << r.stats.meanMs
+             << ", \"stddev_ms\": " << r.stats.stddevMs << ", \"min_ms\": " << r.stats.minMs
+             << ", \"mb_per_s\": " << r.mbPerSecond << ", \"mpix_per_s\": " << r.mpixPerSecond
+             << ", \"speedup_vs_original\": " << r.vsOriginal << "}";
+    }
+    file << "\n  ]\n}\n";
+    if (!file) {
+        throw std::runtime_error("Failed to write " + filename);
+    }
+}
+
+void writeCsv(const std::string& filename, const std::vector<CaseResult>& results) {
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot write " + filename);
+    }
+    file << "kernel,variant,threads,width,height,bytes,runs,median_ms,p95_ms,mean_ms,stddev_ms,min_ms,"
+            "mb_per_s,mpix_per_s,speedup_vs_original\n";
+    file << std::fixed << std::setprecision(4);
+    for (const auto& r : results) {
+        file << r.kernel << ',' << r.variant << ',' << r.threads << ',' << r.width << ',' << r.height << ','
+             << r.bytes << ',' << r.stats.runs << ',' << r.stats.medianMs << ',' << r.stats.p95Ms << ','
+             << r.stats.meanMs << ',' << r.stats.stddevMs << ',' << r.stats.minMs << ',' << r.mbPerSecond << ','
+             << r.mpixPerSecond << ',' << r.vsOriginal << '\n';
+    }
+    if (!file) {
+        throw std::runtime_error("Failed to write " + filename);
+    }
+}
+
+// Every kernel at one size: the original BMPImage, then the optimized
+// engines on 1 and threads threads. Prints and returns the rows in run order.
+std::vector<CaseResult> benchmarkSize(int size, int threads, const BenchOptions& options, bool& pinned) {
+    auto desc = ImageKernels::makeDescriptor(size, size, 24);
+    auto rotatedDesc = ImageKernels::rotatedDescriptor(desc);
+    PinnedBuffer source(desc.dataSize());
+    PinnedBuffer dest(std::max({desc.dataSize(), rotatedDesc.dataSize(),
+                                BMPImageOptimized::inPlaceRotationSize(desc)}));
+    pinned = pinned && source.isLocked() && dest.isLocked();
+    std::mt19937 random(12345);
+    std::generate(source.get(), source.get() + source.size(),
+                  [&random]() { return static_cast<unsigned char>(random()); });
+    std::span<const unsigned char> input(source.get(), source.size());
+
+    std::vector<CaseResult> rows;
+    std::map<std::string, double> originalMedians;
+    auto record = [&](const std::string& kernel, const std::string& variant, int caseThreads, const Stats& stats) {
+        CaseResult result;
+        result.kernel = kernel;
+        result.variant = variant;
+        result.threads = caseThreads;
+        result.width = desc.width;
+        result.height = desc.height;
+        result.bytes = desc.dataSize();
+        result.stats = stats;
+        result.mbPerSecond = desc.dataSize() / 1e6 / (stats.medianMs / 1000.0);
+        result.mpixPerSecond = static_cast<double>(desc.width) * desc.height / 1e6 / (stats.medianMs / 1000.0);
+        if (variant == "original") {
+            originalMedians[kernel] = stats.medianMs;
+        } else if (variant != "original-parallel" && originalMedians.count(kernel) > 0) {
+            result.vsOriginal = originalMedians[kernel] / stats.medianMs;
+        }
+        printRow(result);
+        rows.push_back(result);
+    };
+
+    // The original first: the other rows compare against its sequential medians
+    if (options.original) {
+        auto headerPath = (std::filesystem::temp_directory_path() /
+                           ("bmp_bench_" + std::to_string(getpid()) + ".bmp")).string();
+        writeBitmapHeaders(headerPath, desc);
+        BMPImage original;
+        original.loadFromFile(headerPath);
+        std::filesystem::remove(headerPath);
+
+        // The original rotates through its object (width and height swap), so
+        // every run starts from a fresh copy of the image and of the pixels
+        std::vector<unsigned char> pixels;
+        pixels.reserve(std::max(desc.dataSize(), rotatedDesc.dataSize()));
+        BMPImage work;
+        auto reset = [&]() {
+            work = original;
+            pixels.assign(source.get(), source.get() + desc.dataSize());
+        };
+        struct OriginalKernel {
+            const char* name;
+            std::function<void()> sequential;
+            std::function<void()> parallel;
+        };
+        std::vector<OriginalKernel> originalKernels = {
+            {"rotate-cw", [&]() { work.rotateClockwise(pixels); },
+             [&]() { work.rotateClockwiseParallel(pixels, threads); }},
+            {"rotate-ccw", [&]() { work.rotateCounterClockwise(pixels); },
+             [&]() { work.rotateCounterClockwiseParallel(pixels, threads); }},
+            {"gaussian-3x3", [&]() { work.applyGaussianFilter(pixels); },
+             [&]() { work.applyGaussianFilterParallel(pixels, threads); }},
+        };
+        for (const auto& kernel : originalKernels) {
+            record(kernel.name, "original", 1, measure(options, kernel.sequential, reset));
+            record(kernel.name, "original-parallel", threads, measure(options, kernel.parallel, reset));
+        }
+    }
+
+    BMPImageOptimized image;
+    struct OptimizedKernel {
+        const char* name;
+        std::function<void(int)> run;
+        std::function<void()> reset;
+    };
+    std::vector<OptimizedKernel> kernels = {
+        {"rotate-cw", [&](int t) { image.rotateClockwise(input, dest.span(), desc, t); }, nullptr},
+        {"rotate-ccw", [&](int t) { image.rotateCounterClockwise(input, dest.span(), desc, t); }, nullptr},
+        {"rotate-in-place", [&](int t) { image.rotateInPlace(dest.span(), desc, true, t); },
+         [&]() { std::memcpy(dest.get(), source.get(), desc.dataSize()); }},
+        {"gaussian-3x3", [&](int t) { image.applyGaussianFilter(input, dest.span(), desc, t); }, nullptr},
+        {"gaussian-r3", [&](int t) { image.applyGaussianBlur(input, dest.span(), desc, 3, 0.0, t); }, nullptr},
+        {"gaussian-r15-box", [&](int t) { image.applyGaussianBlur(input, dest.span(), desc, 15, 0.0, t); },
+         nullptr},
+        {"rotate-gaussian", [&](int t) { image.rotateAndFilter(input, dest.span(), desc, true, t); }, nullptr},
+    };
+    for (const auto& kernel : kernels) {
+        record(kernel.name, "sequential", 1, measure(options, [&]() { kernel.run(1); }, kernel.reset));
+        record(kernel.name, "parallel", threads, measure(options, [&]() { kernel.run(threads); }, kernel.reset));
+    }
+
+    return rows;
+}
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [options]" << std::endl;
+    std::cout << "Times every kernel (sequential, parallel and the original BMPImage) on synthetic"
+              << " 24-bit images" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --sizes LIST       Square edges in pixels (default 256,1024,4096,16384)" << std::endl;
+    std::cout << "  -t, --threads N    Threads of the parallel variants (default: all cores)" << std::endl;
+    std::cout << "  --warmup N         Untimed runs per case (default 1)" << std::endl;
+    std::cout << "  --min-runs N       Timed runs per case at least (default 5)" << std::endl;
+    std::cout << "  --max-runs N       Timed runs per case at most (default 50)" << std::endl;
+    std::cout << "  --budget SEC       Keep adding runs up to max-runs while under SEC (default 1)" << std::endl;
+    std::cout << "  --no-original      Skip the original BMPImage" << std::endl;
+    std::cout << "  --json FILE        Write the results as JSON" << std::endl;
+    std::cout << "  --csv FILE         Write the results as CSV" << std::endl;
+    std::cout << "  -h, --help         Show this help message" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        BenchOptions options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument(arg + " requires a value");
+                }
+                return argv[++i];
+            };
+            if (arg == "-h" || arg == "--help") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg == "--sizes") {
+                options.sizes = parseSizes(value());
+            } else if (arg == "-t" || arg == "--threads") {
+                options.threads = std::stoi(value());
+            } else if (arg == "--warmup") {
+                options.warmupRuns = std::stoi(value());
+            } else if (arg == "--min-runs") {
+                options.minRuns = std::stoi(value());
+            } else if (arg == "--max-runs") {
+                options.maxRuns = std::stoi(value());
+            } else if (arg == "--budget") {
+                options.budgetSeconds = std::stod(value());
+            } else if (arg == "--no-original") {
+                options.original = false;
+            } else if (arg == "--json") {
+                options.jsonPath = value();
+            } else if (arg == "--csv") {
+                options.csvPath = value();
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        if (options.minRuns < 1 || options.maxRuns < options.minRuns || options.warmupRuns < 0) {
+            throw std::invalid_argument("Need 1 <= --min-runs <= --max-runs and --warmup >= 0");
+        }
+
+        int threads = options.threads > 0 ? options.threads
+                                           : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        std::cout << "=== BMP Kernel Micro-Benchmarks ===" << std::endl;
+        std::cout << "Parallel variants: " << threads << " threads, " << options.warmupRuns
+                  << " warm-up run(s), " << options.minRuns << ".." << options.maxRuns << " timed runs per case"
+                  << std::endl;
+        std::cout << std::left << std::setw(7) << "Size" << std::setw(18) << "Kernel" << std::setw(18) << "Variant"
+                  << std::right << std::setw(4) << "Thr" << std::setw(6) << "Runs" << std::setw(11) << "Median ms"
+                  << std::setw(11) << "p95 ms" << std::setw(10) << "Stddev" << std::setw(10) << "MB/s"
+                  << std::setw(9) << "Mpix/s" << std::setw(10) << "vs orig" << std::endl;
+
+        std::vector<CaseResult> results;
+        bool pinned = true;
+        for (int size : options.sizes) {
+            try {
+                auto rows = benchmarkSize(size, threads, options, pinned);
+                results.insert(results.end(), rows.begin(), rows.end());
+            } catch (const std::bad_alloc&) {
+                std::cout << "Skipped " << size << "x" << size << ": not enough memory" << std::endl;
+            }
+        }
+        std::cout << "(MB/s and Mpix/s of the source image per median run; vs orig = original sequential"
+                  << " median / this median)" << std::endl;
+        std::cout << "Buffers: " << (pinned ? "locked in RAM" : "pre-faulted (mlock refused, see ulimit -l)")
+                  << std::endl;
+
+        if (!options.jsonPath.empty()) {
+            writeJson(options.jsonPath, results, options, threads, pinned);
+            std::cout << "JSON written to " << options.jsonPath << std::endl;
+        }
+        if (!options.csvPath.empty()) {
+            writeCsv(options.csvPath, results);
+            std::cout << "CSV written to " << options.csvPath << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -12,7 +12,18 @@
 #include <filesystem>
 #include <iomanip>
 #include <vector>
+#include <thread>
+#include <algorithm>
 #include "WorkWithBMP_optimized.h"
+#include "ImageKernels.h"
+#include "StreamingRotator.h"
+#include "TaskGraph.h"
+#include "BatchProcessor.h"
+#include "StagedPipeline.h"
+#include "NumaTopology.h"
+#include "AutoTuner.h"
+#include "TuningProfile.h"
+#include "Trace.h"
 
 std::string generateOutputFilename(const std::string& inputFile, const std::string& suffix) {
     std::filesystem::path inputPath(inputFile);
@@ -33,21 +44,137 @@ void printPerformanceStats(const BMPImageOptimized& image) {
     std::cout << "  Parallel operations: " << image.getParallelOperations() << std::endl;
     std::cout << "  Parallel efficiency: " << std::fixed << std::setprecision(2) 
               << image.getParallelEfficiency() * 100.0 << "%" << std::endl;
+    auto decisions = image.getDecisionStats();
+    if (decisions.total() > 0) {
+        std::cout << "  Cutover decisions: " << decisions.sequential << " sequential, " << decisions.partial
+                  << " partial, " << decisions.full << " full" << std::endl;
+        std::cout << "  Last decision: " << CostModel::describe(image.getLastDecision()) << std::endl;
+    }
+}
+
+void printFramePoolStats(const FramePool::Stats& stats) {
+    std::cout << "Frame pool: " << stats.hits << " hits, " << stats.misses << " misses ("
+              << std::fixed << std::setprecision(1) << stats.hitRate() * 100.0 << "% reused)";
+    if (stats.dropped > 0) {
+        std::cout << ", " << stats.dropped << " dropped over the cache limit";
+    }
+    std::cout << std::endl;
+}
+
+// Command line settings shared by the processing modes
+struct ProcessingOptions {
+    bool useParallel = false;
+    int numThreads = 0;
+    bool autoCutover = false;  // each kernel picks its own thread count, numThreads caps it
+    int tileSize = 0;      // 0 = library default
+    int blurRadius = 1;    // 1 with sigma 0 = classic 3x3 kernel
+    double blurSigma = 0.0;
+    bool useMmap = false;  // read pixels through a read-only file mapping
+    bool usePipeline = false;        // fused rotate + filter engine, filtered outputs only
+    bool streaming = false;          // out-of-core rotation through a temp file
+    size_t memoryBudgetMB = 256;     // per-phase buffer budget in streaming mode
+    std::string batchSpec;           // directory, glob or list file for --batch
+    std::string stageSpec;           // R:W:S thread counts for the staged --batch pipeline
+    size_t queueDepth = 4;           // frames in flight between pipeline stages
+    bool mapOutputs = false;         // kernels write straight into mapped output files
+    bool inPlaceRotation = false;    // rotate exclusive frames without a second buffer
+    bool lazyOrientation = false;    // defer rotations until a save or kernel needs the pixels
+    NumaTopology::Placement placement = NumaTopology::Placement::None;  // pool worker pinning
+    bool firstTouch = false;         // parallel first touch of frame buffers
+    std::string profilePath;         // tuning profile to load or write (empty = default path)
+    std::string tracePath;           // Chrome trace JSON of the run (empty = no tracing)
+    bool hardwareCounters = false;   // perf_event counters around the benchmark kernels
+    std::string outputDirectory = ".";
+};
+
+void rotateConfigured(BMPImageOptimized& image, BMPFrame& frame, bool clockwise,
+                      const ProcessingOptions& options) {
+    if (options.autoCutover) {
+        image.rotate(frame, clockwise, options.numThreads);
+    } else if (options.useParallel) {
+        if (clockwise) image.rotateClockwiseParallel(frame, options.numThreads);
+        else image.rotateCounterClockwiseParallel(frame, options.numThreads);
+    } else {
+        if (clockwise) image.rotateClockwise(frame);
+        else image.rotateCounterClockwise(frame);
+    }
 }
 
-void processImageOptimized(const std::string& inputFile, bool useParallel = false, int numThreads = 0) {
+void applyConfiguredFilter(BMPImageOptimized& image, BMPFrame& frame, const ProcessingOptions& options) {
+    if (options.autoCutover) {
+        image.filter(frame, options.blurRadius, options.blurSigma, options.numThreads);
+    } else if (options.useParallel) {
+        image.applyGaussianBlurParallel(frame, options.blurRadius, options.blurSigma, options.numThreads);
+    } else {
+        image.applyGaussianBlur(frame, options.blurRadius, options.blurSigma);
+    }
+}
+
+// Rotate images larger than RAM without ever holding the full pixel array
+void processImageStreaming(const std::string& inputFile, const ProcessingOptions& options) {
+    std::cout << "=== Streaming BMP Rotation ===" << std::endl;
+    std::cout << "Input file: " << inputFile << std::endl;
+    std::cout << "Memory budget: " << options.memoryBudgetMB << " MB" << std::endl;
+    
+    StreamingRotator rotator(options.memoryBudgetMB << 20, options.useParallel ? options.numThreads : 1);
+    if (options.tileSize > 0) {
+        rotator.setTileSize(options.tileSize);
+    }
+    
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (bool clockwise : {true, false}) {
+        std::string outputFile = generateOutputFilename(
+            inputFile, clockwise ? "rotated_clockwise_opt" : "rotated_counter_clockwise_opt");
+        auto result = rotator.rotateFile(inputFile, outputFile, clockwise);
+        
+        std::cout << "\n--- " << (clockwise ? "Clockwise" : "Counter-Clockwise") << " Rotation ---" << std::endl;
+        std::cout << "  Output: " << result.width << "x" << result.height << ", "
+                  << result.pixelBytes << " bytes of pixel data" << std::endl;
+        std::cout << "  Strip phase: " << result.strips << " strips in " << std::fixed << std::setprecision(1)
+                  << result.stripPhaseMs << " ms (" << result.tempBytes << " bytes staged)" << std::endl;
+        std::cout << "  Band phase: " << result.bands << " bands in " << result.bandPhaseMs << " ms" << std::endl;
+        std::cout << "Saved rotated image: " << outputFile << std::endl;
+    }
+    std::cout << "Gaussian filtering is not applied in streaming mode" << std::endl;
+    
+    auto totalDuration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - startTime);
+    std::cout << "\n=== Processing Complete ===" << std::endl;
+    std::cout << "Total processing time: " << totalDuration.count() << " ms" << std::endl;
+}
+
+void processImageOptimized(const std::string& inputFile, const ProcessingOptions& options) {
+    bool useParallel = options.useParallel;
+    int numThreads = options.numThreads;
     try {
         std::cout << "=== Optimized BMP Image Processing ===" << std::endl;
         std::cout << "Input file: " << inputFile << std::endl;
         std::cout << "Parallel processing: " << (useParallel ? "Enabled" : "Disabled") << std::endl;
+        if (options.autoCutover) {
+            std::cout << "Cutover: per kernel, cost model" << std::endl;
+        }
         if (useParallel) {
             std::cout << "Number of threads: " << (numThreads > 0 ? std::to_string(numThreads) : "Auto") << std::endl;
+            std::cout << "Scheduler: " << BMPImageOptimized::schedulerName(BMPImageOptimized::defaultScheduler())
+                      << std::endl;
+        }
+        if (options.blurRadius != 1 || options.blurSigma > 0.0) {
+            std::cout << "Gaussian radius: " << options.blurRadius << ", sigma: "
+                      << (options.blurSigma > 0.0 ? std::to_string(options.blurSigma) : "auto") << std::endl;
         }
+        std::cout << "Gaussian kernel ISA: " << ImageKernels::simdLevelName(ImageKernels::activeSimdLevel()) << std::endl;
         
         // Load image
         auto startTime = std::chrono::high_resolution_clock::now();
         BMPImageOptimized image;
-        image.loadFromFile(inputFile);
+        if (options.tileSize > 0) {
+            image.setTileSize(options.tileSize);
+        }
+        image.setInPlaceRotation(options.inPlaceRotation);
+        image.setLazyOrientation(options.lazyOrientation);
+        auto loadMode = options.useMmap ? BMPImageOptimized::LoadMode::Mapped : BMPImageOptimized::LoadMode::Buffered;
+        // One read: both branches below start from copy-on-write clones of this frame
+        BMPFrame source = image.loadFrame(inputFile, loadMode);
         
         std::cout << "Image loaded successfully:" << std::endl;
         std::cout << "  Width: " << image.getWidth() << " pixels" << std::endl;
@@ -57,95 +184,117 @@ void processImageOptimized(const std::string& inputFile, bool useParallel = fals
         
         printMemoryUsage(image);
         
-        // Get image data
-        auto imageData = image.getImageData();
-        std::cout << "Image data loaded: " << imageData.size() << " bytes" << std::endl;
+        // Mapped frames are read in place by the kernels
+        if (image.isMapped()) {
+            std::cout << "Image data mapped: " << source.size() << " bytes" << std::endl;
+        } else {
+            std::cout << "Image data loaded: " << source.size() << " bytes" << std::endl;
+        }
         
         auto loadTime = std::chrono::high_resolution_clock::now();
         auto loadDuration = std::chrono::duration_cast<std::chrono::milliseconds>(loadTime - startTime);
         std::cout << "Load time: " << loadDuration.count() << " ms" << std::endl;
         
-        // Process clockwise rotation
-        std::cout << "\n--- Processing Clockwise Rotation ---" << std::endl;
-        auto clockwiseData = imageData;
-        auto rotateStart = std::chrono::high_resolution_clock::now();
-        
+        // Two independent branches (rotate -> save, rotate -> filter -> save)
+        // as a task graph, so both directions and their saves overlap. Kernels
+        // in concurrent branches split the thread budget between them.
+        int graphParallelism = 1;
+        ProcessingOptions kernelOptions = options;
         if (useParallel) {
-            image.rotateClockwiseParallel(clockwiseData, numThreads);
-        } else {
-            image.rotateClockwise(clockwiseData);
+            int totalThreads = numThreads > 0 ? numThreads : static_cast<int>(std::thread::hardware_concurrency());
+            graphParallelism = std::max(1, totalThreads);
+            // Without -t, a tuned host lets each kernel take its profiled thread count
+            bool tuned = numThreads <= 0 && !TuningProfile::active()->empty();
+            kernelOptions.numThreads = tuned ? 0 : std::max(1, totalThreads / 2);
         }
         
-        auto rotateEnd = std::chrono::high_resolution_clock::now();
-        auto rotateDuration = std::chrono::duration_cast<std::chrono::milliseconds>(rotateEnd - rotateStart);
-        std::cout << "Clockwise rotation completed in: " << rotateDuration.count() << " ms" << std::endl;
-        
-        // Save clockwise rotated image
-        std::string clockwiseFile = generateOutputFilename(inputFile, "rotated_clockwise_opt");
-        image.saveToFile(clockwiseFile, clockwiseData);
-        std::cout << "Saved clockwise rotated image: " << clockwiseFile << std::endl;
-        
-        // Apply Gaussian filter to clockwise rotated image
-        std::cout << "\n--- Applying Gaussian Filter to Clockwise Rotated Image ---" << std::endl;
-        auto filterStart = std::chrono::high_resolution_clock::now();
-        
-        if (useParallel) {
-            image.applyGaussianFilterParallel(clockwiseData, numThreads);
-        } else {
-            image.applyGaussianFilter(clockwiseData);
+        struct Branch {
+            bool clockwise;
+            std::string name;
+            std::string rotatedFile;
+            std::string filteredFile;
+            BMPFrame rotated;
+            BMPFrame filtered;
+        };
+        Branch branches[2] = {
+            {true, "clockwise", generateOutputFilename(inputFile, "rotated_clockwise_opt"),
+             generateOutputFilename(inputFile, "filtered_clockwise_opt"), BMPFrame(), BMPFrame()},
+            {false, "counter-clockwise", generateOutputFilename(inputFile, "rotated_counter_clockwise_opt"),
+             generateOutputFilename(inputFile, "filtered_counter_clockwise_opt"), BMPFrame(), BMPFrame()}
+        };
+        
+        TaskGraph graph;
+        int kernelThreads = useParallel ? kernelOptions.numThreads : 1;
+        std::vector<TaskGraph::TaskId> sourceReaders;   // tasks that must finish before source is consumed
+        for (Branch& branch : branches) {
+            if (options.mapOutputs) {
+                // Each kernel stores into its mapped output, so there is no save step;
+                // the filter reads the rotated pixels back from the first file
+                auto rotate = graph.addTask("Rotate " + branch.name + " into mapped file", [&, kernelThreads]() {
+                    branch.rotated = image.rotateToFile(source, branch.rotatedFile, branch.clockwise, kernelThreads);
+                });
+                graph.addTask("Filter " + branch.name + " into mapped file", [&, kernelThreads]() {
+                    branch.filtered = image.filterToFile(branch.rotated, branch.filteredFile, options.blurRadius,
+                                                         options.blurSigma, kernelThreads);
+                }, {rotate});
+                continue;
+            }
+            if (options.inPlaceRotation) {
+                // Memory-tight order: the second rotation consumes the source
+                // after the first has copied out of it, and each filter takes
+                // over its rotated frame once that is saved, so every kernel
+                // after the first works inside an existing buffer
+                bool lastReader = &branch == &branches[1];
+                auto rotate = graph.addTask("Rotate " + branch.name + (lastReader ? " in place" : ""),
+                                            [&, lastReader]() {
+                    branch.rotated = lastReader ? std::move(source) : source.clone();
+                    rotateConfigured(image, branch.rotated, branch.clockwise, kernelOptions);
+                }, lastReader ? sourceReaders : std::vector<TaskGraph::TaskId>());
+                sourceReaders.push_back(rotate);
+                auto save = graph.addTask("Save rotated " + branch.name, [&]() {
+                    image.saveToFile(branch.rotatedFile, branch.rotated);
+                }, {rotate});
+                auto filter = graph.addTask("Filter " + branch.name + " in place", [&]() {
+                    branch.filtered = std::move(branch.rotated);
+                    applyConfiguredFilter(image, branch.filtered, kernelOptions);
+                }, {save});
+                graph.addTask("Save filtered " + branch.name, [&]() {
+                    image.saveToFile(branch.filteredFile, branch.filtered);
+                }, {filter});
+                continue;
+            }
+            auto rotate = graph.addTask("Rotate " + branch.name, [&]() {
+                branch.rotated = source.clone();
+                rotateConfigured(image, branch.rotated, branch.clockwise, kernelOptions);
+            });
+            graph.addTask("Save rotated " + branch.name, [&]() {
+                image.saveToFile(branch.rotatedFile, branch.rotated);
+            }, {rotate});
+            // The filter works on a copy-on-write clone: the concurrent save
+            // above still reads the rotated pixels
+            auto filter = graph.addTask("Filter " + branch.name, [&]() {
+                branch.filtered = branch.rotated.clone();
+                applyConfiguredFilter(image, branch.filtered, kernelOptions);
+            }, {rotate});
+            graph.addTask("Save filtered " + branch.name, [&]() {
+                image.saveToFile(branch.filteredFile, branch.filtered);
+            }, {filter});
         }
         
-        auto filterEnd = std::chrono::high_resolution_clock::now();
-        auto filterDuration = std::chrono::duration_cast<std::chrono::milliseconds>(filterEnd - filterStart);
-        std::cout << "Gaussian filter applied in: " << filterDuration.count() << " ms" << std::endl;
-        
-        // Save filtered clockwise image
-        std::string filteredClockwiseFile = generateOutputFilename(inputFile, "filtered_clockwise_opt");
-        image.saveToFile(filteredClockwiseFile, clockwiseData);
-        std::cout << "Saved filtered clockwise image: " << filteredClockwiseFile << std::endl;
+        std::cout << "\n--- Processing Task Graph (" << graph.size() << " tasks, up to "
+                  << graphParallelism << " concurrent) ---" << std::endl;
+        graph.run(graphParallelism);
         
-        // Process counter-clockwise rotation
-        std::cout << "\n--- Processing Counter-Clockwise Rotation ---" << std::endl;
-        // Reload image for counter-clockwise rotation
-        BMPImageOptimized image2;
-        image2.loadFromFile(inputFile);
-        auto counterClockwiseData = image2.getImageData();
-        auto counterRotateStart = std::chrono::high_resolution_clock::now();
-        
-        if (useParallel) {
-            image2.rotateCounterClockwiseParallel(counterClockwiseData, numThreads);
-        } else {
-            image2.rotateCounterClockwise(counterClockwiseData);
+        for (TaskGraph::TaskId id = 0; id < static_cast<TaskGraph::TaskId>(graph.size()); ++id) {
+            const auto& timing = graph.getTiming(id);
+            std::cout << "  " << timing.name << ": " << std::fixed << std::setprecision(2)
+                      << timing.durationMs << " ms (started at " << timing.startMs << " ms)" << std::endl;
         }
-        
-        auto counterRotateEnd = std::chrono::high_resolution_clock::now();
-        auto counterRotateDuration = std::chrono::duration_cast<std::chrono::milliseconds>(counterRotateEnd - counterRotateStart);
-        std::cout << "Counter-clockwise rotation completed in: " << counterRotateDuration.count() << " ms" << std::endl;
-        
-        // Save counter-clockwise rotated image
-        std::string counterClockwiseFile = generateOutputFilename(inputFile, "rotated_counter_clockwise_opt");
-        image2.saveToFile(counterClockwiseFile, counterClockwiseData);
-        std::cout << "Saved counter-clockwise rotated image: " << counterClockwiseFile << std::endl;
-        
-        // Apply Gaussian filter to counter-clockwise rotated image
-        std::cout << "\n--- Applying Gaussian Filter to Counter-Clockwise Rotated Image ---" << std::endl;
-        auto counterFilterStart = std::chrono::high_resolution_clock::now();
-        
-        if (useParallel) {
-            image2.applyGaussianFilterParallel(counterClockwiseData, numThreads);
-        } else {
-            image2.applyGaussianFilter(counterClockwiseData);
+        for (const Branch& branch : branches) {
+            std::cout << "Saved " << branch.name << " rotated image: " << branch.rotatedFile << std::endl;
+            std::cout << "Saved filtered " << branch.name << " image: " << branch.filteredFile << std::endl;
         }
         
-        auto counterFilterEnd = std::chrono::high_resolution_clock::now();
-        auto counterFilterDuration = std::chrono::duration_cast<std::chrono::milliseconds>(counterFilterEnd - counterFilterStart);
-        std::cout << "Gaussian filter applied in: " << counterFilterDuration.count() << " ms" << std::endl;
-        
-        // Save filtered counter-clockwise image
-        std::string filteredCounterClockwiseFile = generateOutputFilename(inputFile, "filtered_counter_clockwise_opt");
-        image2.saveToFile(filteredCounterClockwiseFile, counterClockwiseData);
-        std::cout << "Saved filtered counter-clockwise image: " << filteredCounterClockwiseFile << std::endl;
-        
         // Final timing summary
         auto endTime = std::chrono::high_resolution_clock::now();
         auto totalDuration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
@@ -156,7 +305,7 @@ void processImageOptimized(const std::string& inputFile, bool useParallel = fals
         
         // Print performance statistics
         printPerformanceStats(image);
-        printPerformanceStats(image2);
+        printFramePoolStats(image.getFramePool()->getStats());
         
         // Verify memory usage is within limits (200% of original data size)
         size_t maxAllowedMemory = image.getDataSize() * 2;
@@ -172,57 +321,196 @@ void processImageOptimized(const std::string& inputFile, bool useParallel = fals
     }
 }
 
-void runAdvancedBenchmark() {
+// Many independent files: spread images across workers
+void processBatch(const ProcessingOptions& options) {
+    std::cout << "=== Batch BMP Processing ===" << std::endl;
+    auto inputs = BatchProcessor::collectInputs(options.batchSpec);
+    
+    BatchProcessor::Options batchOptions;
+    batchOptions.numThreads = options.numThreads;
+    batchOptions.tileSize = options.tileSize;
+    batchOptions.blurRadius = options.blurRadius;
+    batchOptions.blurSigma = options.blurSigma;
+    batchOptions.useMmap = options.useMmap;
+    batchOptions.outputDirectory = options.outputDirectory;
+    batchOptions.mapOutputs = options.mapOutputs;
+    batchOptions.inPlaceRotation = options.inPlaceRotation;
+    batchOptions.lazyOrientation = options.lazyOrientation;
+    BatchProcessor batch(batchOptions);
+    
+    std::cout << "Input: " << options.batchSpec << " (" << inputs.size() << " files)" << std::endl;
+    std::cout << "Output directory: " << options.outputDirectory << std::endl;
+    BatchProcessor::Report report;
+    if (!options.stageSpec.empty()) {
+        if (options.mapOutputs) {
+            throw std::invalid_argument("--map-output cannot be combined with --stages (the writer stage saves)");
+        }
+        // Dedicated reader, compute and writer threads overlap I/O with the kernels
+        auto stageSizes = StagedPipeline::parseStageSizes(options.stageSpec);
+        stageSizes.queueCapacity = options.queueDepth;
+        StagedPipeline pipeline(batchOptions, stageSizes);
+        auto stagedReport = pipeline.run(inputs);
+        report = stagedReport.batch;
+        
+        std::cout << "\n=== Pipeline Stages ===" << std::endl;
+        const StagedPipeline::StageStats* slowest = &stagedReport.load;
+        for (const auto* stage : {&stagedReport.load, &stagedReport.compute, &stagedReport.save}) {
+            std::cout << "  " << std::left << std::setw(8) << stage->name << std::right
+                      << stage->threads << " thread(s), " << stage->items << " items, busy "
+                      << std::fixed << std::setprecision(3) << stage->busySeconds << " s, critical "
+                      << stage->criticalSeconds() << " s" << std::endl;
+            if (stage->criticalSeconds() > slowest->criticalSeconds()) {
+                slowest = stage;
+            }
+        }
+        std::cout << "Slowest stage: " << slowest->name << " (" << std::fixed << std::setprecision(3)
+                  << slowest->criticalSeconds() << " s of " << report.seconds << " s wall)" << std::endl;
+    } else {
+        std::cout << "I/O backend: " << AsyncIO::backendName(AsyncIO::sharedInstance()->backend()) << std::endl;
+        report = batch.run(inputs);
+    }
+    
+    std::cout << "\n=== Batch Complete ===" << std::endl;
+    std::cout << "Images processed: " << report.images;
+    if (options.stageSpec.empty()) {
+        std::cout << " (" << report.largeFrames << " large frames with intra-image parallelism)";
+    }
+    std::cout << std::endl;
+    if (report.failed > 0) {
+        std::cout << "Images failed: " << report.failed << std::endl;
+    }
+    std::cout << "Workers: " << report.workers << std::endl;
+    std::cout << "Total time: " << std::fixed << std::setprecision(3) << report.seconds << " s" << std::endl;
+    std::cout << "Throughput: " << std::setprecision(1) << report.imagesPerSecond() << " images/s, "
+              << std::setprecision(2) << report.megapixelsPerSecond() << " Mpix/s" << std::endl;
+    printFramePoolStats(report.framePool);
+    if (report.failed > 0) {
+        throw std::runtime_error(std::to_string(report.failed) + " batch image(s) failed");
+    }
+}
+
+// Per-run counters of the rotation and 3x3 filter benchmarks on file
+void printKernelCounters(const std::string& file, int numThreads) {
+    std::cout << "\n=== Hardware Counters (per run) ===" << std::endl;
+    BMPImageOptimized image;
+    image.loadFromFile(file);
+    auto rotation = image.benchmarkRotation(numThreads, 3, true);
+    auto filter = image.benchmarkGaussianFilter(numThreads, 3, true);
+    if (rotation.sequentialCounters.runs == 0) {
+        std::cout << "Hardware counters unavailable: " << rotation.countersNote << std::endl;
+        return;
+    }
+    std::string parallel = " (" + std::to_string(rotation.numThreads) + " threads)";
+    PerfCounters::printTable(std::cout, {{"rotate (1 thread)", rotation.sequentialCounters},
+                                         {"rotate" + parallel, rotation.parallelCounters},
+                                         {"gaussian 3x3 (1 thread)", filter.sequentialCounters},
+                                         {"gaussian 3x3" + parallel, filter.parallelCounters}});
+    if (!rotation.countersNote.empty()) {
+        std::cout << "Note: " << rotation.countersNote << std::endl;
+    }
+}
+
+void runAdvancedBenchmark(const std::string& inputFile, const ProcessingOptions& options) {
     std::cout << "=== Advanced Performance Benchmark ===" << std::endl;
     
     try {
         BMPImageOptimized image;
-        image.loadFromFile("example.bmp");
+        image.loadFromFile(inputFile);
+        int maxThreads = options.numThreads > 0 ? options.numThreads : 8;
         
         std::cout << "Testing rotation performance scaling..." << std::endl;
-        auto rotationResults = image.benchmarkScaling(8);
+        auto rotationResults = image.benchmarkScaling(maxThreads, BMPImageOptimized::BenchmarkKernel::Rotation);
         
         std::cout << "\nTesting Gaussian filter performance scaling..." << std::endl;
-        image.resetPerformanceCounters();
-        auto filterResults = image.benchmarkScaling(8);
-        
+        auto filterResults = image.benchmarkScaling(maxThreads, BMPImageOptimized::BenchmarkKernel::GaussianFilter);
+        
+        auto best = [](const std::vector<BMPImageOptimized::BenchmarkResult>& results) {
+            return *std::max_element(results.begin(), results.end(),
+                                     [](const auto& a, const auto& b) { return a.speedup < b.speedup; });
+        };
+        auto bestRotation = best(rotationResults);
+        auto bestFilter = best(filterResults);
         std::cout << "\n=== Benchmark Summary ===" << std::endl;
-        std::cout << "Best rotation speedup: " << std::fixed << std::setprecision(2) 
-                  << std::max_element(rotationResults.begin(), rotationResults.end(),
-                                     [](const auto& a, const auto& b) { return a.speedup < b.speedup; })->speedup
-                  << "x" << std::endl;
-        
-        std::cout << "Best filter speedup: " << std::fixed << std::setprecision(2)
-                  << std::max_element(filterResults.begin(), filterResults.end(),
-                                     [](const auto& a, const auto& b) { return a.speedup < b.speedup; })->speedup
-                  << "x" << std::endl;
+        std::cout << "Best rotation speedup: " << std::fixed << std::setprecision(2) << bestRotation.speedup
+                  << "x on " << bestRotation.numThreads << " thread(s)" << std::endl;
+        std::cout << "Best filter speedup: " << std::fixed << std::setprecision(2) << bestFilter.speedup
+                  << "x on " << bestFilter.numThreads << " thread(s)" << std::endl;
         
+        if (options.hardwareCounters) {
+            printKernelCounters(inputFile, maxThreads);
+        }
     } catch (const std::exception& e) {
         std::cerr << "Benchmark error: " << e.what() << std::endl;
     }
 }
 
+void runTuning(const std::string& profilePath, const ProcessingOptions& options) {
+    std::cout << "=== Kernel Auto-Tuning ===" << std::endl;
+    AutoTuner::Options tunerOptions;
+    tunerOptions.maxThreads = options.numThreads;
+    if (options.blurRadius > 1) {
+        tunerOptions.blurRadius = options.blurRadius;
+    }
+    AutoTuner tuner(tunerOptions);
+    TuningProfile profile = tuner.run(&std::cout);
+    profile.save(profilePath);
+    std::cout << "Tuning profile written to " << profilePath << std::endl;
+    std::cout << "Calls with 0 threads (e.g. -p without -t) now use these settings" << std::endl;
+}
+
 void printUsage(const char* programName) {
     std::cout << "Usage: " << programName << " [options] [input_file]" << std::endl;
     std::cout << "Options:" << std::endl;
     std::cout << "  -p, --parallel     Enable parallel processing" << std::endl;
     std::cout << "  -t, --threads N    Number of threads (0 = auto)" << std::endl;
+    std::cout << "      --auto         Each kernel runs sequential, on k threads or on all of them,"
+              << " as the cost model estimates fastest (-t caps it)" << std::endl;
+    std::cout << "      --tile-size N  Rotation tile edge in pixels (default 64)" << std::endl;
+    std::cout << "  -r, --radius N     Gaussian radius 1..15 (0 = from sigma, default 1)" << std::endl;
+    std::cout << "  -s, --sigma S      Gaussian sigma (0 = from radius)" << std::endl;
+    std::cout << "  -m, --mmap         Memory-map the input instead of copying its pixels" << std::endl;
+    std::cout << "      --scheduler S  Row distribution: steal (work stealing, default) or openmp" << std::endl;
+    std::cout << "      --simd LEVEL   Cap Gaussian ISA: scalar, sse2, avx2, avx512" << std::endl;
+    std::cout << "      --io BACKEND   Async output writes: auto, uring, blocking (default auto)" << std::endl;
+    std::cout << "      --batch SPEC   Process a directory, glob or list file, one image per worker" << std::endl;
+    std::cout << "      --output-dir DIR  Where --batch writes its outputs (default .)" << std::endl;
+    std::cout << "      --stages R:W:S  Run --batch as a reader/worker/writer pipeline (W = 0 for auto)" << std::endl;
+    std::cout << "      --queue-depth N  Frames in flight between pipeline stages (default 4)" << std::endl;
+    std::cout << "      --pipeline     Fused rotate + 3x3 filter, saves the filtered outputs only" << std::endl;
+    std::cout << "      --map-output   Kernels write straight into memory-mapped output files" << std::endl;
+    std::cout << "      --in-place     Rotate inside the frame's own buffer (lower peak memory)" << std::endl;
+    std::cout << "      --lazy         Defer rotations; pixels are permuted once, on save or filter" << std::endl;
+    std::cout << "      --pin MODE     Pin pool workers to CPUs: none, compact, spread (default none)" << std::endl;
+    std::cout << "      --first-touch  Fault frame buffers in on the workers that fill them" << std::endl;
+    std::cout << "      --numa         Same as --pin spread --first-touch" << std::endl;
+    std::cout << "      --stream       Rotate out of core (images larger than RAM, no filtering)" << std::endl;
+    std::cout << "      --memory-budget MB  Buffer budget for --stream (default 256)" << std::endl;
+    std::cout << "      --trace FILE   Record loads, kernels, scheduler ranges and saves per thread as"
+              << " Chrome trace JSON" << std::endl;
+    std::cout << "      --tune         Measure kernel settings on this host and write the tuning profile" << std::endl;
+    std::cout << "      --profile FILE  Tuning profile to use or write (default $BMP_TUNING_PROFILE or"
+              << " ~/.bmp_processor_tuning)" << std::endl;
+    std::cout << "      --counters     With -b or -a: per-kernel hardware counters (IPC, LLC/dTLB/branch"
+              << " misses, bandwidth)" << std::endl;
     std::cout << "  -b, --benchmark    Run performance benchmark" << std::endl;
-    std::cout << "  -a, --advanced     Run advanced scaling benchmark" << std::endl;
+    std::cout << "  -a, --advanced     Run advanced scaling benchmark on the input (up to -t threads,"
+              << " default 8)" << std::endl;
     std::cout << "  -h, --help         Show this help message" << std::endl;
     std::cout << std::endl;
     std::cout << "Examples:" << std::endl;
     std::cout << "  " << programName << " example.bmp" << std::endl;
     std::cout << "  " << programName << " -p -t 8 example.bmp" << std::endl;
+    std::cout << "  " << programName << " --batch 'frames/*.bmp' --output-dir out" << std::endl;
+    std::cout << "  " << programName << " --batch frames --stages 2:4:2 -t 4" << std::endl;
     std::cout << "  " << programName << " --advanced" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
     try {
-        bool useParallel = false;
-        int numThreads = 0;
+        ProcessingOptions options;
         bool shouldRunBenchmark = false;
         bool shouldRunAdvancedBenchmark = false;
+        bool shouldRunTuning = false;
         std::string inputFile = "example.bmp";
         
         // Parse command line arguments
@@ -233,15 +521,151 @@ int main(int argc, char* argv[]) {
                 printUsage(argv[0]);
                 return 0;
             } else if (arg == "-p" || arg == "--parallel") {
-                useParallel = true;
+                options.useParallel = true;
             } else if (arg == "-t" || arg == "--threads") {
                 if (i + 1 < argc) {
-                    numThreads = std::stoi(argv[++i]);
-                    useParallel = true;
+                    options.numThreads = std::stoi(argv[++i]);
+                    options.useParallel = true;
                 } else {
                     std::cerr << "Error: --threads requires a number" << std::endl;
                     return 1;
                 }
+            } else if (arg == "--tile-size") {
+                if (i + 1 < argc) {
+                    options.tileSize = std::stoi(argv[++i]);
+                } else {
+                    std::cerr << "Error: --tile-size requires a number" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--batch") {
+                if (i + 1 < argc) {
+                    options.batchSpec = argv[++i];
+                } else {
+                    std::cerr << "Error: --batch requires a directory, glob or list file" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--stages") {
+                if (i + 1 < argc) {
+                    options.stageSpec = argv[++i];
+                } else {
+                    std::cerr << "Error: --stages requires R:W:S thread counts" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--queue-depth") {
+                if (i + 1 < argc) {
+                    int depth = std::stoi(argv[++i]);
+                    if (depth <= 0) {
+                        std::cerr << "Error: --queue-depth must be positive" << std::endl;
+                        return 1;
+                    }
+                    options.queueDepth = static_cast<size_t>(depth);
+                } else {
+                    std::cerr << "Error: --queue-depth requires a number" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--output-dir") {
+                if (i + 1 < argc) {
+                    options.outputDirectory = argv[++i];
+                } else {
+                    std::cerr << "Error: --output-dir requires a directory" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--map-output") {
+                options.mapOutputs = true;
+            } else if (arg == "--in-place") {
+                options.inPlaceRotation = true;
+            } else if (arg == "--auto") {
+                options.autoCutover = true;
+                options.useParallel = true;
+            } else if (arg == "--lazy") {
+                options.lazyOrientation = true;
+            } else if (arg == "--pin") {
+                if (i + 1 < argc) {
+                    options.placement = NumaTopology::parsePlacement(argv[++i]);
+                } else {
+                    std::cerr << "Error: --pin requires none, compact or spread" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--first-touch") {
+                options.firstTouch = true;
+            } else if (arg == "--numa") {
+                options.placement = NumaTopology::Placement::Spread;
+                options.firstTouch = true;
+            } else if (arg == "--pipeline") {
+                options.usePipeline = true;
+            } else if (arg == "--stream") {
+                options.streaming = true;
+            } else if (arg == "--memory-budget") {
+                if (i + 1 < argc) {
+                    long long budget = std::stoll(argv[++i]);
+                    if (budget <= 0) {
+                        std::cerr << "Error: --memory-budget must be positive" << std::endl;
+                        return 1;
+                    }
+                    options.memoryBudgetMB = static_cast<size_t>(budget);
+                    options.streaming = true;
+                } else {
+                    std::cerr << "Error: --memory-budget requires a number of megabytes" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "-m" || arg == "--mmap") {
+                options.useMmap = true;
+            } else if (arg == "-r" || arg == "--radius") {
+                if (i + 1 < argc) {
+                    options.blurRadius = std::stoi(argv[++i]);
+                } else {
+                    std::cerr << "Error: --radius requires a number" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "-s" || arg == "--sigma") {
+                if (i + 1 < argc) {
+                    options.blurSigma = std::stod(argv[++i]);
+                } else {
+                    std::cerr << "Error: --sigma requires a number" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--io") {
+                if (i + 1 < argc) {
+                    AsyncIO::setDefaultBackend(AsyncIO::parseBackend(argv[++i]));
+                } else {
+                    std::cerr << "Error: --io requires a backend" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--scheduler") {
+                if (i + 1 < argc) {
+                    BMPImageOptimized::setDefaultScheduler(BMPImageOptimized::parseScheduler(argv[++i]));
+                } else {
+                    std::cerr << "Error: --scheduler requires steal or openmp" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--simd") {
+                if (i + 1 < argc) {
+                    ImageKernels::setSimdLevel(ImageKernels::parseSimdLevel(argv[++i]));
+                } else {
+                    std::cerr << "Error: --simd requires a level" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--trace") {
+                if (i + 1 >= argc) {
+                    std::cerr << "Error: --trace requires a file path" << std::endl;
+                    return 1;
+                }
+                if (!Trace::ENABLED) {
+                    std::cerr << "Error: this build has no tracing (rebuild with make TRACE=1)" << std::endl;
+                    return 1;
+                }
+                options.tracePath = argv[++i];
+            } else if (arg == "--tune") {
+                shouldRunTuning = true;
+            } else if (arg == "--profile") {
+                if (i + 1 < argc) {
+                    options.profilePath = argv[++i];
+                } else {
+                    std::cerr << "Error: --profile requires a file path" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--counters") {
+                options.hardwareCounters = true;
             } else if (arg == "-b" || arg == "--benchmark") {
                 shouldRunBenchmark = true;
             } else if (arg == "-a" || arg == "--advanced") {
@@ -255,15 +679,77 @@ int main(int argc, char* argv[]) {
             }
         }
         
+        // NUMA placement applies to the shared pool every mode runs on
+        if (options.placement != NumaTopology::Placement::None) {
+            auto topology = NumaTopology::discover();
+            ThreadPool::sharedInstance()->pinWorkers(topology.cpuOrder(options.placement));
+            std::cout << "NUMA: " << topology.nodes().size() << " node(s), " << topology.cpuCount()
+                      << " CPUs, workers pinned " << NumaTopology::placementName(options.placement) << std::endl;
+        }
+        BMPImageOptimized::setNumaFirstTouch(options.firstTouch);
+        
+        std::string profilePath = options.profilePath.empty() ? TuningProfile::defaultPath() : options.profilePath;
+        if (shouldRunTuning) {
+            runTuning(profilePath, options);
+            return 0;
+        }
+        if (!options.profilePath.empty()) {
+            TuningProfile::setActive(std::make_shared<TuningProfile>(TuningProfile::load(profilePath)));
+        }
+        
+        if (!options.tracePath.empty()) {
+            Trace::setThreadName("main");
+            Trace::start();
+        }
+        
         if (shouldRunAdvancedBenchmark) {
-            runAdvancedBenchmark();
+            runAdvancedBenchmark(inputFile, options);
         } else if (shouldRunBenchmark) {
             // Run basic benchmark
-            processImageOptimized(inputFile, false, 0);
-            processImageOptimized(inputFile, true, 4);
+            ProcessingOptions sequentialOptions = options;
+            sequentialOptions.useParallel = false;
+            sequentialOptions.numThreads = 0;
+            processImageOptimized(inputFile, sequentialOptions);
+            
+            ProcessingOptions parallelOptions = options;
+            parallelOptions.useParallel = true;
+            parallelOptions.numThreads = 4;
+            processImageOptimized(inputFile, parallelOptions);
+            if (options.hardwareCounters) {
+                printKernelCounters(inputFile, parallelOptions.numThreads);
+            }
+        } else if (!options.batchSpec.empty()) {
+            processBatch(options);
+        } else if (options.usePipeline) {
+            BMPImageOptimized image;
+            if (options.tileSize > 0) {
+                image.setTileSize(options.tileSize);
+            }
+            image.setLazyOrientation(options.lazyOrientation);
+            auto startTime = std::chrono::high_resolution_clock::now();
+            if (!options.mapOutputs) {
+                std::cout << "I/O backend: " << AsyncIO::backendName(image.getAsyncIO()->backend()) << std::endl;
+            }
+            image.processImagePipeline(inputFile, options.useParallel ? options.numThreads : 1, options.mapOutputs);
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::high_resolution_clock::now() - startTime);
+            std::cout << "Pipeline completed in: " << duration.count() << " ms" << std::endl;
+        } else if (options.streaming) {
+            processImageStreaming(inputFile, options);
         } else {
             // Process the image
-            processImageOptimized(inputFile, useParallel, numThreads);
+            processImageOptimized(inputFile, options);
+        }
+        
+        if (!options.tracePath.empty()) {
+            Trace::stop();
+            Trace::writeChromeJson(options.tracePath);
+            auto traceStats = Trace::stats();
+            std::cout << "Trace: " << traceStats.events << " events on " << traceStats.threads << " threads";
+            if (traceStats.dropped > 0) {
+                std::cout << " (" << traceStats.dropped << " oldest overwritten)";
+            }
+            std::cout << " written to " << options.tracePath << std::endl;
         }
         
         std::cout << "\nAll operations completed successfully!" << std::endl;